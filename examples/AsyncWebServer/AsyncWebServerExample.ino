@@ -3,17 +3,27 @@
  * @brief Example using AsyncWebServer with modular OTA
  * 
  * This example demonstrates how to integrate the modular OTA system
- * with AsyncWebServer for high-performance web applications.
+ * with AsyncWebServer for high-performance web applications. The OTA
+ * server itself also runs on AsyncWebServer (build with
+ * -DOTA_ASYNC_WEBSERVER), so uploads are written from the AsyncTCP task
+ * and keep going even while loop() is busy.
  */
 
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <ModularOTA.h>
+#include <OTAJson.h>
 
 // Create AsyncWebServer instance
 AsyncWebServer server(80);
 
+// WebSocket for real-time OTA progress
+AsyncWebSocket ws("/ws");
+const unsigned long WS_PROGRESS_INTERVAL = 500;   // Coalesce progress to 2 messages/s
+
+void broadcastOTAState(bool force);
+
 // Configuration for the modular OTA system
 ModularOTA::Config otaConfig = {
     .ssid = "YourWiFiSSID",
@@ -21,6 +31,7 @@ ModularOTA::Config otaConfig = {
     .autoReconnect = true,
     .reconnectInterval = 30000,
     .enablePersistence = true,
+    .asyncServer = true,             // OTA uploads handled by AsyncWebServer
     .serverPort = 3232,              // Different port for OTA server
     .otaPath = "/update",
     .authUsername = "admin",         // Optional authentication
@@ -45,20 +56,22 @@ void setup() {
                 
             case ModularOTA::Event::OTA_STARTED:
                 Serial.println("🔄 OTA update started: " + message);
-                // You could notify connected WebSocket clients here
+                broadcastOTAState(true);
                 break;
                 
             case ModularOTA::Event::OTA_PROGRESS:
                 Serial.printf("📊 OTA progress: %d%%\n", value);
-                // You could broadcast progress to WebSocket clients here
+                broadcastOTAState(false);
                 break;
                 
             case ModularOTA::Event::OTA_COMPLETED:
                 Serial.println("✅ OTA completed: " + message);
+                broadcastOTAState(true);
                 break;
                 
             case ModularOTA::Event::OTA_FAILED:
                 Serial.println("❌ OTA failed: " + message);
+                broadcastOTAState(true);
                 break;
                 
             default:
@@ -108,11 +121,43 @@ void loop() {
                 Serial.println("⚠️  Low memory warning: " + String(freeHeap) + " bytes free");
             }
         }
+
+        ws.cleanupClients();
     }
     
     delay(10);
 }
 
+/**
+ * @brief Push OTA status/progress to WebSocket clients
+ *
+ * Progress is coalesced to WS_PROGRESS_INTERVAL so a fast upload does not
+ * flood the clients; status changes (force) are sent immediately.
+ */
+void broadcastOTAState(bool force) {
+    static unsigned long lastSent = 0;
+    static int lastProgress = -1;
+
+    if (ws.count() == 0) return;
+
+    int progress = OTACore::getProgress();
+    if (!force && (progress == lastProgress || millis() - lastSent < WS_PROGRESS_INTERVAL)) {
+        return;
+    }
+    lastSent = millis();
+    lastProgress = progress;
+
+    char buffer[128];
+    OTAJson json(buffer, sizeof(buffer));
+    json.beginObject()
+        .addString("type", "ota")
+        .addInt("status", (int)OTACore::getStatus())
+        .addInt("progress", progress)
+        .addBool("active", OTACore::isActive())
+    .endObject();
+    ws.textAll(json.c_str(), json.length());
+}
+
 void setupWebServer() {
     // Serve static main page
     server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
@@ -193,6 +238,17 @@ void setupWebServer() {
         // Update status immediately and then every 5 seconds
         updateStatus();
         setInterval(updateStatus, 5000);
+
+        // OTA progress is pushed over the WebSocket while an update runs
+        const ws = new WebSocket('ws://' + location.host + '/ws');
+        ws.onmessage = function(e) {
+            const data = JSON.parse(e.data);
+            if (data.type !== 'ota') return;
+            document.getElementById('otaStatus').innerHTML = `
+                <div class="metric"><strong>OTA Status:</strong> ${data.status}</div>
+                <div class="metric"><strong>Progress:</strong> ${data.progress}%</div>
+            `;
+        };
     </script>
 </body>
 </html>
@@ -231,8 +287,7 @@ void setupWebServer() {
         request->send(200, "application/json", json);
     });
     
-    // WebSocket handler for real-time updates (optional)
-    AsyncWebSocket ws("/ws");
+    // WebSocket handler for real-time updates
     ws.onEvent([](AsyncWebSocket *server, AsyncWebSocketClient *client, 
                   AwsEventType type, void *arg, uint8_t *data, size_t len) {
         if (type == WS_EVT_CONNECT) {
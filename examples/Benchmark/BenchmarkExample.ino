@@ -0,0 +1,130 @@
+/**
+ * @file BenchmarkExample.ino
+ * @brief On-device side of the OTA benchmark (pio run -e benchmark)
+ *
+ * Runs the OTA server with bench endpoints that tools/ota_bench.py uses to
+ * reconfigure OTACore between runs and to start pull-mode downloads. Every
+ * image is received, written and hashed as usual, then rejected by the
+ * digest verifier, so runs end without switching the boot partition and the
+ * device never reboots. Results come from OTACore::getMetrics() via
+ * GET /update/status.
+ *
+ * Set the credentials with build flags, e.g.
+ *   PLATFORMIO_BUILD_FLAGS='-DBENCH_WIFI_SSID=\"lab\" -DBENCH_WIFI_PASSWORD=\"secret\"'
+ */
+
+#include <OTACore.h>
+#include <NetworkManager.h>
+#include <OTAWebServer.h>
+#include <OTAFetcher.h>
+#include <OTAJson.h>
+
+#ifndef BENCH_WIFI_SSID
+#define BENCH_WIFI_SSID "YourWiFiSSID"
+#endif
+#ifndef BENCH_WIFI_PASSWORD
+#define BENCH_WIFI_PASSWORD "YourWiFiPassword"
+#endif
+
+OTACore::Config coreConfig;
+
+void sendBenchJSON(WebServer* server, int code) {
+    char buffer[256];
+    OTAJson json(buffer, sizeof(buffer));
+    json.beginObject()
+        .addInt("status", (int)OTACore::getStatus())
+        .addBool("active", OTACore::isActive())
+        .addBool("fetching", OTAFetcher::isBusy())
+        .addString("error", OTACore::getLastErrorCStr())
+        .addUInt("bufferSize", OTACore::getBufferSize())
+        .addBool("asyncWrite", OTACore::isAsyncWrite())
+        .addUInt("writeBuffers", coreConfig.writeBufferCount)
+        .addUInt("freeHeap", ESP.getFreeHeap())
+    .endObject();
+    server->send(code, "application/json", json.c_str());
+}
+
+/**
+ * @brief POST /bench/config?buffer=<bytes>&async=<0|1>&writers=<n>
+ *
+ * Reinitializes OTACore for the next run; also clears the rejected state
+ * left by the previous one.
+ */
+void handleBenchConfig() {
+    WebServer* server = OTAWebServer::getServer();
+    if (OTACore::isActive() || OTAFetcher::isBusy()) {
+        sendBenchJSON(server, 409);
+        return;
+    }
+
+    if (server->hasArg("buffer")) coreConfig.bufferSize = server->arg("buffer").toInt();
+    if (server->hasArg("async")) coreConfig.asyncWrite = server->arg("async").toInt() != 0;
+    if (server->hasArg("writers")) coreConfig.writeBufferCount = server->arg("writers").toInt();
+
+    if (!OTACore::begin(coreConfig)) {
+        sendBenchJSON(server, 500);
+        return;
+    }
+    sendBenchJSON(server, 200);
+}
+
+/**
+ * @brief POST /bench/fetch?url=<image url>&chunk=<bytes>
+ */
+void handleBenchFetch() {
+    WebServer* server = OTAWebServer::getServer();
+    OTAFetcher::Config fetchConfig;
+    fetchConfig.url = server->arg("url");
+    if (server->hasArg("chunk")) fetchConfig.chunkSize = server->arg("chunk").toInt();
+
+    if (!OTAFetcher::begin(fetchConfig) || !OTAFetcher::fetchNow()) {
+        sendBenchJSON(server, 409);
+        return;
+    }
+    sendBenchJSON(server, 202);
+}
+
+void setup() {
+    Serial.begin(115200);
+    Serial.println("\n=== OTA Benchmark ===");
+
+    coreConfig.enablePersistence = false;
+    coreConfig.enableCompression = true;
+    if (!OTACore::begin(coreConfig)) {
+        Serial.println("❌ Failed to initialize OTA Core");
+        return;
+    }
+
+    // Measure the full write path, then discard the image
+    OTACore::setDigestVerifier([](const uint8_t digest[32]) {
+        return false;
+    });
+
+    NetworkManager::begin(BENCH_WIFI_SSID, BENCH_WIFI_PASSWORD, true);
+    if (!NetworkManager::connect(15000)) {
+        Serial.println("⚠️  WiFi connection failed, will auto-retry...");
+    }
+
+    OTAWebServer::Config serverConfig;
+    serverConfig.maxUploadSize = OTACore::getAvailableSize();
+    serverConfig.enableEvents = false;
+    if (!OTAWebServer::begin(serverConfig)) {
+        Serial.println("❌ Failed to initialize OTA Web Server");
+        return;
+    }
+
+    OTAWebServer::addCustomEndpoint("/bench/config", handleBenchConfig);
+    OTAWebServer::addCustomEndpoint("/bench/fetch", handleBenchFetch);
+    OTAWebServer::addCustomEndpoint("/bench/state", []() {
+        sendBenchJSON(OTAWebServer::getServer(), 200);
+    });
+
+    Serial.println("📡 Benchmark target: http://" + NetworkManager::getIPAddress() + ":" +
+                   String(serverConfig.port));
+}
+
+void loop() {
+    NetworkManager::handle();
+    OTAWebServer::handle();
+    delay(1);
+}
@@ -9,6 +9,10 @@ std::function<void()> ElegantOTACompat::_onStartCallback = nullptr;
 std::function<void()> ElegantOTACompat::_onEndCallback = nullptr;
 std::function<void(unsigned int, unsigned int)> ElegantOTACompat::_onProgressCallback = nullptr;
 std::function<void(String)> ElegantOTACompat::_onErrorCallback = nullptr;
+int ElegantOTACompat::_uploadStatusCode = 200;
+String ElegantOTACompat::_uploadMessage = "";
+size_t ElegantOTACompat::_uploadReceived = 0;
+bool ElegantOTACompat::_uploadStarted = false;
 
 bool ElegantOTACompat::begin(WebServer* server, const String& path, 
                             const String& username, const String& password) {
@@ -28,7 +32,7 @@ bool ElegantOTACompat::begin(WebServer* server, const String& path,
     }
 
     // Set OTA Core callback
-    OTACore::setCallback(onOTAEvent);
+    OTACore::setEventHandler(onOTAEvent);
 
     if (_useExternalServer) {
         // Setup routes on external server
@@ -145,29 +149,32 @@ void ElegantOTACompat::restart() {
     OTACore::restart();
 }
 
-void ElegantOTACompat::onOTAEvent(OTACore::Status status, int progress, const String& message) {
-    switch (status) {
-        case OTACore::Status::RECEIVING:
-            if (progress == 0 && _onStartCallback) {
+void ElegantOTACompat::onOTAEvent(const OTACore::Event& event) {
+    switch (event.code) {
+        case OTACore::EventCode::STARTED:
+            if (_onStartCallback) {
                 _onStartCallback();
             }
+            break;
+
+        case OTACore::EventCode::PROGRESS:
             if (_onProgressCallback) {
                 // Calculate total from available size for compatibility
                 size_t total = OTACore::getAvailableSize();
-                unsigned int received = (progress * total) / 100;
+                unsigned int received = (event.progress * total) / 100;
                 _onProgressCallback(received, total);
             }
             break;
             
-        case OTACore::Status::COMPLETE:
+        case OTACore::EventCode::COMPLETED:
             if (_onEndCallback) {
                 _onEndCallback();
             }
             break;
             
-        case OTACore::Status::ERROR:
+        case OTACore::EventCode::FAILED:
             if (_onErrorCallback) {
-                _onErrorCallback(message);
+                _onErrorCallback(String(event.message));
             }
             break;
             
@@ -178,18 +185,7 @@ void ElegantOTACompat::onOTAEvent(OTACore::Status status, int progress, const St
 
 void ElegantOTACompat::onServerEvent(OTAWebServer::Event event, const String& message, int value) {
     switch (event) {
-        case OTAWebServer::Event::UPLOAD_START:
-            if (_onStartCallback) {
-                _onStartCallback();
-            }
-            break;
-            
-        case OTAWebServer::Event::UPLOAD_COMPLETE:
-            if (_onEndCallback) {
-                _onEndCallback();
-            }
-            break;
-            
+        // Start and end are reported once, by OTACore
         case OTAWebServer::Event::UPLOAD_ERROR:
             if (_onErrorCallback) {
                 _onErrorCallback(message);
@@ -204,147 +200,106 @@ void ElegantOTACompat::onServerEvent(OTAWebServer::Event event, const String& me
 void ElegantOTACompat::setupExternalServerRoutes() {
     if (!_externalServer) return;
 
-    // Add OTA upload page route
+    // Add OTA upload page route; 304s need If-None-Match collected by the app
     _externalServer->on(_path, HTTP_GET, []() {
-        // Serve the same HTML page as OTAWebServer
-        String html = R"HTML(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>ESP32 OTA Update</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body { font-family: Arial, sans-serif; margin: 40px; background-color: #f0f0f0; }
-        .container { max-width: 600px; margin: 0 auto; background: white; padding: 30px; border-radius: 10px; box-shadow: 0 4px 6px rgba(0,0,0,0.1); }
-        h1 { color: #333; text-align: center; }
-        .upload-area { border: 2px dashed #ccc; border-radius: 10px; padding: 40px; text-align: center; margin: 20px 0; }
-        .upload-area:hover { border-color: #007bff; }
-        input[type="file"] { margin: 20px 0; }
-        button { background-color: #007bff; color: white; padding: 10px 20px; border: none; border-radius: 5px; cursor: pointer; font-size: 16px; }
-        button:hover { background-color: #0056b3; }
-        button:disabled { background-color: #ccc; cursor: not-allowed; }
-        .progress { width: 100%; background-color: #f0f0f0; border-radius: 10px; margin: 20px 0; height: 20px; overflow: hidden; }
-        .progress-bar { height: 100%; background-color: #007bff; width: 0%; transition: width 0.3s; }
-        .status { margin: 20px 0; padding: 10px; border-radius: 5px; }
-        .status.success { background-color: #d4edda; color: #155724; border: 1px solid #c3e6cb; }
-        .status.error { background-color: #f8d7da; color: #721c24; border: 1px solid #f5c6cb; }
-        .status.info { background-color: #d1ecf1; color: #0c5460; border: 1px solid #bee5eb; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>ESP32 OTA Update</h1>
-        <div class="upload-area">
-            <p>Select firmware file (.bin) to upload</p>
-            <form method="POST" action="#" enctype="multipart/form-data" id="uploadForm">
-                <input type="file" name="update" accept=".bin" id="fileInput" required>
-                <br>
-                <button type="submit" id="uploadBtn">Upload Firmware</button>
-            </form>
-        </div>
-        <div class="progress" id="progressContainer" style="display: none;">
-            <div class="progress-bar" id="progressBar"></div>
-        </div>
-        <div id="status"></div>
-    </div>
-    <script>
-        // Same JavaScript as in OTAWebServer
-        document.getElementById('uploadForm').addEventListener('submit', function(e) {
-            e.preventDefault();
-            uploadFile();
-        });
-        
-        function uploadFile() {
-            const fileInput = document.getElementById('fileInput');
-            const file = fileInput.files[0];
-            
-            if (!file) {
-                showStatus('Please select a file', 'error');
-                return;
-            }
-            
-            const formData = new FormData();
-            formData.append('update', file);
-            
-            const uploadBtn = document.getElementById('uploadBtn');
-            const progressContainer = document.getElementById('progressContainer');
-            const progressBar = document.getElementById('progressBar');
-            
-            uploadBtn.disabled = true;
-            uploadBtn.textContent = 'Uploading...';
-            progressContainer.style.display = 'block';
-            progressBar.style.width = '0%';
-            
-            const xhr = new XMLHttpRequest();
-            
-            xhr.upload.addEventListener('progress', function(e) {
-                if (e.lengthComputable) {
-                    const percentComplete = (e.loaded / e.total) * 100;
-                    progressBar.style.width = percentComplete + '%';
-                }
-            });
-            
-            xhr.addEventListener('load', function() {
-                if (xhr.status === 200) {
-                    progressBar.style.width = '100%';
-                    showStatus('Upload successful! Device will reboot...', 'success');
-                    setTimeout(function() {
-                        window.location.reload();
-                    }, 3000);
-                } else {
-                    showStatus('Upload failed: ' + xhr.responseText, 'error');
-                }
-                uploadBtn.disabled = false;
-                uploadBtn.textContent = 'Upload Firmware';
-            });
-            
-            xhr.addEventListener('error', function() {
-                showStatus('Upload failed: Network error', 'error');
-                uploadBtn.disabled = false;
-                uploadBtn.textContent = 'Upload Firmware';
-            });
-            
-            xhr.open('POST', '');
-            xhr.send(formData);
-        }
-        
-        function showStatus(message, type) {
-            const status = document.getElementById('status');
-            status.innerHTML = '<div class="status ' + type + '">' + message + '</div>';
-        }
-    </script>
-</body>
-</html>
-        )HTML";
-        
-        _externalServer->send(200, "text/html", html);
+        OTAWebServer::sendUI(*_externalServer);
     });
 
-    // Add POST handler for file upload
+    // Add POST handler for file upload; the result carries the upload's real status
     _externalServer->on(_path, HTTP_POST, 
         []() {
+            if (_uploadStatusCode != 200) {
+                _externalServer->send(_uploadStatusCode, "text/plain", _uploadMessage);
+                return;
+            }
             _externalServer->send(200, "text/plain", "Upload completed");
         },
-        []() {
-            HTTPUpload& upload = _externalServer->upload();
-            
-            if (upload.status == UPLOAD_FILE_START) {
-                Serial.println("[ElegantOTACompat] External server upload started: " + upload.filename);
-                
-                if (!OTACore::startUpdate(upload.totalSize)) {
-                    return;
-                }
-            } else if (upload.status == UPLOAD_FILE_WRITE) {
-                if (OTACore::writeData(upload.buf, upload.currentSize) != upload.currentSize) {
-                    return;
-                }
-            } else if (upload.status == UPLOAD_FILE_END) {
-                if (OTACore::finishUpdate()) {
-                    Serial.println("[ElegantOTACompat] External server upload completed");
-                } else {
-                    Serial.println("[ElegantOTACompat] External server upload failed");
-                }
-            }
-        }
+        handleExternalUpload
     );
 }
+
+void ElegantOTACompat::handleExternalUpload() {
+    HTTPUpload& upload = _externalServer->upload();
+
+    if (upload.status == UPLOAD_FILE_START) {
+        _uploadStatusCode = 200;
+        _uploadMessage = "";
+        _uploadReceived = 0;
+        _uploadStarted = false;
+        Serial.println("[ElegantOTACompat] External server upload started: " + upload.filename);
+
+        // totalSize is not known yet for multipart bodies; the request
+        // length is a close upper bound (file plus multipart framing)
+        size_t size = upload.totalSize > 0 ? upload.totalSize : (size_t)_externalServer->clientContentLength();
+        size_t declared = size > OTAWebServer::MULTIPART_OVERHEAD ? size - OTAWebServer::MULTIPART_OVERHEAD : 0;
+        if (OTACore::isActive()) {
+            failUpload(409, "Another update is in progress");
+            return;
+        }
+        if (!enforceUploadLimit(declared)) {
+            return;
+        }
+
+        if (!OTACore::startUpdate(size)) {
+            failUpload(500, "Failed to start OTA update: " + OTACore::getLastError());
+            return;
+        }
+        _uploadStarted = true;
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+        if (_uploadStatusCode != 200) return;
+
+        // Checked before the chunk reaches flash
+        if (!enforceUploadLimit(_uploadReceived + upload.currentSize)) {
+            return;
+        }
+        _uploadReceived += upload.currentSize;
+
+        if (OTACore::writeData(upload.buf, upload.currentSize) != (int)upload.currentSize) {
+            failUpload(500, "Write error: " + OTACore::getLastError());
+        }
+    } else if (upload.status == UPLOAD_FILE_END) {
+        if (_uploadStatusCode != 200) return;
+
+        _uploadStarted = false;
+        if (OTACore::finishUpdate()) {
+            Serial.println("[ElegantOTACompat] External server upload completed");
+        } else {
+            failUpload(500, "Upload failed: " + OTACore::getLastError());
+        }
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        // A refused upload must not suspend another transport's session
+        if (!_uploadStarted || _uploadStatusCode != 200) return;
+
+        _uploadStarted = false;
+        OTACore::suspendUpdate();
+        Serial.println("[ElegantOTACompat] External server upload interrupted");
+    }
+}
+
+void ElegantOTACompat::failUpload(int code, const String& message) {
+    _uploadStatusCode = code;
+    _uploadMessage = message;
+    Serial.println("[ElegantOTACompat] " + message);
+
+    // OTACore reports its own failures through onOTAEvent()
+    if (code == 409 || code == 413) {
+        if (_onErrorCallback) {
+            _onErrorCallback(message);
+        }
+    }
+}
+
+bool ElegantOTACompat::enforceUploadLimit(size_t size) {
+    size_t limit = OTAWebServer::getUploadLimit();
+    if (size <= limit) {
+        return true;
+    }
+
+    // Oversized images are never resumable
+    if (_uploadStarted) {
+        OTACore::abortUpdate();
+        _uploadStarted = false;
+    }
+    failUpload(413, "Upload exceeds the " + String(limit) + " byte limit");
+    return false;
+}
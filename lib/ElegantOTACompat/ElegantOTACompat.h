@@ -16,6 +16,18 @@ class ElegantOTACompat {
 public:
     /**
      * @brief Initialize ElegantOTA compatibility layer
+     *
+     * With an external @p server the upload page is always sent in full
+     * unless the application adds "If-None-Match" to the server's own
+     * collectHeaders() list; WebServer keeps a single list, so the layer
+     * does not replace it:
+     *
+     *     const char* headers[] = {"If-None-Match"};
+     *     server.collectHeaders(headers, 1);
+     *
+     * Uploads there are capped at OTAWebServer::getUploadLimit() and answered
+     * with the update's real status (409, 413 or 500 on failure).
+     *
      * @param server WebServer instance (optional, will create internal if not provided)
      * @param path OTA endpoint path
      * @param username HTTP auth username (optional)
@@ -95,7 +107,16 @@ private:
     static std::function<void(unsigned int, unsigned int)> _onProgressCallback;
     static std::function<void(String)> _onErrorCallback;
 
-    static void onOTAEvent(OTACore::Status status, int progress, const String& message);
+    // Upload state for the external server route
+    static int _uploadStatusCode;
+    static String _uploadMessage;
+    static size_t _uploadReceived;
+    static bool _uploadStarted;
+
+    static void onOTAEvent(const OTACore::Event& event);
     static void onServerEvent(OTAWebServer::Event event, const String& message, int value);
     static void setupExternalServerRoutes();
+    static void handleExternalUpload();
+    static void failUpload(int code, const String& message);
+    static bool enforceUploadLimit(size_t size);
 };
@@ -1,4 +1,6 @@
 #include "ModularOTA.h"
+#include "OTAJson.h"
+#include "OTAUtil.h"
 
 // Static member definitions
 ModularOTA::Config ModularOTA::_config;
@@ -7,6 +9,12 @@ bool ModularOTA::_initialized = false;
 bool ModularOTA::_networkEnabled = true;
 bool ModularOTA::_otaEnabled = true;
 bool ModularOTA::_serverEnabled = true;
+bool ModularOTA::_fetcherEnabled = false;
+TaskHandle_t ModularOTA::_task = nullptr;
+volatile bool ModularOTA::_taskStop = false;
+volatile bool ModularOTA::_restartPending = false;
+ModularOTA::State ModularOTA::_state = {};
+portMUX_TYPE ModularOTA::_stateLock = portMUX_INITIALIZER_UNLOCKED;
 
 bool ModularOTA::begin(const Config& config) {
     if (_initialized) {
@@ -32,6 +40,21 @@ bool ModularOTA::begin(const Config& config) {
     }
 
     _initialized = true;
+    updateState();
+
+    if (_config.runInTask && !startTask()) {
+        Serial.println("[ModularOTA] ERROR: Failed to start service task");
+        stop();
+        return false;
+    }
+
+#if OTA_STATIC_MEMORY
+    // Everything an update needs is in place; later begin() cycles reuse it
+    OTAArena::Stats arena = OTAArena::getStats();
+    Serial.println("[ModularOTA] Static arena: " + String(arena.used) + " of " +
+                   String(arena.capacity) + " bytes in " + String(arena.regions) + " regions");
+#endif
+
     Serial.println("[ModularOTA] System initialized successfully");
     Serial.println("==========================================\n");
 
@@ -44,8 +67,13 @@ void ModularOTA::setCallback(CallbackFunction callback) {
 }
 
 void ModularOTA::handle() {
-    if (!_initialized) return;
+    if (!_initialized || _task) return;
 
+    handleComponents();
+    updateState();
+}
+
+void ModularOTA::handleComponents() {
     // Handle network manager
     if (_networkEnabled) {
         NetworkManager::handle();
@@ -60,25 +88,42 @@ void ModularOTA::handle() {
     if (_serverEnabled) {
         OTAWebServer::handle();
     }
+
+    // Schedule pull-mode checks; downloads run in their own task
+    if (_fetcherEnabled) {
+        OTAFetcher::handle();
+    }
 }
 
 void ModularOTA::stop() {
     if (!_initialized) return;
 
     Serial.println("[ModularOTA] Stopping system...");
+    stopTask();
+    stopComponents();
 
+    _initialized = false;
+    sendEvent(Event::SERVER_STOPPED, "Modular OTA system stopped");
+    
+    Serial.println("[ModularOTA] System stopped");
+}
+
+void ModularOTA::stopComponents() {
     if (_serverEnabled) {
         OTAWebServer::stop();
     }
 
+    if (_fetcherEnabled) {
+        OTAFetcher::stop();
+        _fetcherEnabled = false;
+    }
+
+    OTAMulticast::stop();
+    OTAEspNow::stop();
+
     if (_networkEnabled) {
         NetworkManager::disconnect();
     }
-
-    _initialized = false;
-    sendEvent(Event::SERVER_STOPPED, "Modular OTA system stopped");
-    
-    Serial.println("[ModularOTA] System stopped");
 }
 
 bool ModularOTA::isReady() {
@@ -111,6 +156,14 @@ bool ModularOTA::updateConfig(const Config& config) {
     _config = config;
 
     if (needsRestart && _initialized) {
+        // A handler on the service task can neither stop the task it runs on
+        // nor the server that called it; the task restarts after this request
+        if (_task && xTaskGetCurrentTaskHandle() == _task) {
+            Serial.println("[ModularOTA] Configuration changed, restart deferred to the service task");
+            _restartPending = true;
+            return true;
+        }
+
         Serial.println("[ModularOTA] Configuration changed, restarting system...");
         stop();
         return begin(_config);
@@ -124,65 +177,202 @@ bool ModularOTA::getSystemStatus(NetworkManager::Status& networkStatus,
                                 bool& serverStatus) {
     if (!_initialized) return false;
 
-    networkStatus = NetworkManager::getStatus();
-    otaStatus = OTACore::getStatus();
-    serverStatus = OTAWebServer::isRunning();
+    State state = getState();
+    networkStatus = state.network;
+    otaStatus = state.ota;
+    serverStatus = state.serverRunning;
 
     return true;
 }
 
+ModularOTA::State ModularOTA::getState() {
+    portENTER_CRITICAL(&_stateLock);
+    State state = _state;
+    portEXIT_CRITICAL(&_stateLock);
+    return state;
+}
+
+bool ModularOTA::isTaskRunning() {
+    return _task != nullptr;
+}
+
+void ModularOTA::updateState() {
+    State state;
+    state.network = NetworkManager::getStatus();
+    state.ota = OTACore::getStatus();
+    state.progress = OTACore::getProgress();
+    state.otaActive = OTACore::isActive();
+    state.serverRunning = OTAWebServer::isRunning();
+    strlcpy(state.lastError, OTACore::getLastErrorCStr(), sizeof(state.lastError));
+
+    portENTER_CRITICAL(&_stateLock);
+    _state = state;
+    portEXIT_CRITICAL(&_stateLock);
+}
+
+bool ModularOTA::startTask() {
+    if (_task) {
+        Serial.println("[ModularOTA] Service task still running, not starting another");
+        return false;
+    }
+
+    _taskStop = false;
+    _restartPending = false;
+    if (!OTAUtil::startTask(serviceTask, "ota_service", _config.taskStackSize, _config.taskPriority,
+                            &_task, _config.taskCore)) {
+        return false;
+    }
+
+    Serial.println("[ModularOTA] Service task started on core " + String(_config.taskCore) +
+                   ", priority " + String(_config.taskPriority));
+    return true;
+}
+
+void ModularOTA::stopTask() {
+    if (!_task) {
+        return;
+    }
+
+    // Let the current iteration finish, a request may be mid-flight
+    _taskStop = true;
+    if (xTaskGetCurrentTaskHandle() == _task) {
+        return; // Called from a handler; the task ends after this iteration
+    }
+    // Never delete it from outside: it may be mid-write to flash or a socket
+    unsigned long start = millis();
+    bool warned = false;
+    while (_task) {
+        if (!warned && millis() - start > 5000) {
+            Serial.println("[ModularOTA] Waiting for the service task to finish its iteration...");
+            warned = true;
+        }
+        delay(10);
+    }
+    Serial.println("[ModularOTA] Service task stopped");
+}
+
+void ModularOTA::serviceTask(void* param) {
+    TickType_t interval = pdMS_TO_TICKS(_config.taskInterval);
+    if (interval == 0) interval = 1;
+
+    while (!_taskStop) {
+        if (_restartPending) {
+            _restartPending = false;
+            restartComponents();
+            continue;
+        }
+        handleComponents();
+        updateState();
+        vTaskDelay(interval);
+    }
+
+    _task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void ModularOTA::restartComponents() {
+    // Runs on the service task between iterations, outside any handler
+    Serial.println("[ModularOTA] Configuration changed, restarting system...");
+    stopComponents();
+
+    if (!initializeComponents()) {
+        Serial.println("[ModularOTA] ERROR: Failed to initialize components");
+        _initialized = false;
+        _taskStop = true;
+        sendEvent(Event::SERVER_STOPPED, "Modular OTA system stopped");
+        return;
+    }
+
+    updateState();
+    if (!_config.runInTask) {
+        _taskStop = true; // handle() takes over once the task has exited
+    }
+    Serial.println("[ModularOTA] System restarted");
+}
+
 String ModularOTA::getSystemInfoJSON() {
-    String json = "{";
-    
-    // System info
-    json += "\"system\":{";
-    json += "\"initialized\":" + String(_initialized ? "true" : "false") + ",";
-    json += "\"ready\":" + String(isReady() ? "true" : "false") + ",";
-    json += "\"uptime\":" + String(millis()) + ",";
-    json += "\"freeHeap\":" + String(ESP.getFreeHeap()) + ",";
-    json += "\"minFreeHeap\":" + String(ESP.getMinFreeHeap()) + ",";
-    json += "\"chipModel\":\"" + String(ESP.getChipModel()) + "\",";
-    json += "\"chipRevision\":" + String(ESP.getChipRevision()) + ",";
-    json += "\"flashSize\":" + String(ESP.getFlashChipSize()) + ",";
-    json += "\"sketchSize\":" + String(ESP.getSketchSize()) + ",";
-    json += "\"freeSketchSpace\":" + String(ESP.getFreeSketchSpace());
-    json += "},";
-
-    // Network info
-    json += "\"network\":{";
-    json += "\"enabled\":" + String(_networkEnabled ? "true" : "false") + ",";
-    json += "\"connected\":" + String(NetworkManager::isConnected() ? "true" : "false") + ",";
-    json += "\"status\":" + String((int)NetworkManager::getStatus()) + ",";
-    json += "\"ssid\":\"" + NetworkManager::getSSID() + "\",";
-    json += "\"ip\":\"" + NetworkManager::getIPAddress() + "\",";
-    json += "\"rssi\":" + String(NetworkManager::getRSSI()) + ",";
-    json += "\"autoReconnect\":" + String(NetworkManager::isAutoReconnectEnabled() ? "true" : "false");
-    json += "},";
-
-    // OTA info
-    json += "\"ota\":{";
-    json += "\"enabled\":" + String(_otaEnabled ? "true" : "false") + ",";
-    json += "\"status\":" + String((int)OTACore::getStatus()) + ",";
-    json += "\"progress\":" + String(OTACore::getProgress()) + ",";
-    json += "\"active\":" + String(OTACore::isActive() ? "true" : "false") + ",";
-    json += "\"persistent\":" + String(OTACore::isPersistent() ? "true" : "false") + ",";
-    json += "\"availableSize\":" + String(OTACore::getAvailableSize()) + ",";
-    json += "\"lastError\":\"" + OTACore::getLastError() + "\"";
-    json += "},";
-
-    // Server info
-    json += "\"server\":{";
-    json += "\"enabled\":" + String(_serverEnabled ? "true" : "false") + ",";
-    json += "\"running\":" + String(OTAWebServer::isRunning() ? "true" : "false") + ",";
-    json += "\"port\":" + String(_config.serverPort) + ",";
-    json += "\"path\":\"" + _config.otaPath + "\",";
-    json += "\"otaUrl\":\"" + getOTAUrl() + "\",";
-    json += "\"clientCount\":" + String(OTAWebServer::getClientCount()) + ",";
-    json += "\"authEnabled\":" + String(_config.authUsername.length() > 0 ? "true" : "false");
-    json += "}";
-
-    json += "}";
-    return json;
+    char json[OTA_SYSTEM_JSON_SIZE];
+    writeSystemInfoJSON(json, sizeof(json));
+    return String(json);
+}
+
+size_t ModularOTA::writeSystemInfoJSON(char* buffer, size_t size) {
+    char otaUrl[96] = "";
+    if (NetworkManager::isConnected()) {
+        IPAddress ip = NetworkManager::getLocalIP();
+        snprintf(otaUrl, sizeof(otaUrl), "http://%u.%u.%u.%u:%d%s",
+                 ip[0], ip[1], ip[2], ip[3], _config.serverPort, _config.otaPath.c_str());
+    }
+
+    NetworkManager::ConnectMetrics connectMetrics = NetworkManager::getConnectMetrics();
+
+    OTAArena::Stats arena = OTAArena::getStats();
+
+    OTAJson json(buffer, size);
+    json.beginObject()
+        // System info
+        .beginObject("system")
+            .addBool("initialized", _initialized)
+            .addBool("ready", isReady())
+            .addUInt("uptime", millis())
+            .addUInt("freeHeap", ESP.getFreeHeap())
+            .addUInt("minFreeHeap", ESP.getMinFreeHeap())
+            .addUInt("arenaSize", arena.capacity)
+            .addUInt("arenaUsed", arena.used)
+            .addString("chipModel", ESP.getChipModel())
+            .addUInt("chipRevision", ESP.getChipRevision())
+            .addUInt("flashSize", ESP.getFlashChipSize())
+            .addUInt("sketchSize", ESP.getSketchSize())
+            .addUInt("freeSketchSpace", ESP.getFreeSketchSpace())
+        .endObject()
+
+        // Network info
+        .beginObject("network")
+            .addBool("enabled", _networkEnabled)
+            .addBool("connected", NetworkManager::isConnected())
+            .addInt("status", (int)NetworkManager::getStatus())
+            .addString("ssid", NetworkManager::getSSIDCStr())
+            .addIP("ip", NetworkManager::getLocalIP())
+            .addInt("rssi", NetworkManager::getRSSI())
+            .addBool("autoReconnect", NetworkManager::isAutoReconnectEnabled())
+            .addUInt("connectAttempts", connectMetrics.attempts)
+            .addUInt("connectFailures", connectMetrics.failures)
+            .addUInt("connectLatency", connectMetrics.lastLatency)
+            .addUInt("nextRetryIn", connectMetrics.nextRetryIn)
+            .addBool("performanceMode", NetworkManager::isPerformanceMode())
+        .endObject()
+
+        // OTA info
+        .beginObject("ota")
+            .addBool("enabled", _otaEnabled)
+            .addInt("status", (int)OTACore::getStatus())
+            .addInt("progress", OTACore::getProgress())
+            .addBool("active", OTACore::isActive())
+            .addBool("rebootPending", OTACore::isRebootPending())
+            .addBool("persistent", OTACore::isPersistent())
+            .addUInt("availableSize", OTACore::getAvailableSize())
+            .addString("lastError", OTACore::getLastErrorCStr())
+        .endObject()
+
+        // Server info
+        .beginObject("server")
+            .addBool("enabled", _serverEnabled)
+            .addBool("running", OTAWebServer::isRunning())
+            .addUInt("port", _config.serverPort)
+            .addString("path", _config.otaPath.c_str())
+            .addString("otaUrl", otaUrl)
+            .addInt("clientCount", OTAWebServer::getClientCount())
+            .addBool("authEnabled", _config.authUsername.length() > 0)
+        .endObject()
+    .endObject();
+
+    // A truncated document is not valid JSON; hand back an empty one instead
+    if (json.overflow()) {
+        Serial.println("[ModularOTA] System info JSON exceeds its " + String(size) + " byte buffer");
+        buffer[0] = '\0';
+        return 0;
+    }
+    return json.length();
 }
 
 bool ModularOTA::setComponentsEnabled(bool enableNetwork, bool enableOTA, bool enableServer) {
@@ -201,7 +391,7 @@ void ModularOTA::restart() {
     sendEvent(Event::OTA_COMPLETED, "System restarting...");
     
     delay(1000);
-    ESP.restart();
+    OTACore::restart();
 }
 
 String ModularOTA::getOTAUrl() {
@@ -227,15 +417,25 @@ bool ModularOTA::getMemoryInfo(size_t& freeHeap, size_t& totalHeap, size_t& minF
     return true;
 }
 
+bool ModularOTA::checkForUpdate() {
+    if (!_fetcherEnabled) {
+        return false;
+    }
+    return OTAFetcher::fetchNow();
+}
+
 void ModularOTA::onNetworkEvent(NetworkManager::Status status, const String& message) {
     switch (status) {
         case NetworkManager::Status::CONNECTED:
             Serial.println("[ModularOTA] Network connected: " + message);
+            startMulticast();
             sendEvent(Event::NETWORK_CONNECTED, message);
             break;
             
         case NetworkManager::Status::DISCONNECTED:
             Serial.println("[ModularOTA] Network disconnected: " + message);
+            // Group membership does not survive a reconnect; rejoin on CONNECTED
+            OTAMulticast::stop();
             sendEvent(Event::NETWORK_DISCONNECTED, message);
             break;
             
@@ -244,25 +444,44 @@ void ModularOTA::onNetworkEvent(NetworkManager::Status status, const String& mes
     }
 }
 
-void ModularOTA::onOTAEvent(OTACore::Status status, int progress, const String& message) {
-    switch (status) {
-        case OTACore::Status::RECEIVING:
-            if (progress == 0) {
-                Serial.println("[ModularOTA] OTA started: " + message);
-                sendEvent(Event::OTA_STARTED, message);
-            } else {
-                sendEvent(Event::OTA_PROGRESS, message, progress);
+void ModularOTA::onOTAEvent(const OTACore::Event& event) {
+    // Keeps getState() current while an upload holds the service loop
+    updateState();
+
+    switch (event.code) {
+        case OTACore::EventCode::STARTED:
+        case OTACore::EventCode::RESUMED:
+            if (_networkEnabled && _config.performanceMode) {
+                NetworkManager::enterPerformanceMode();
             }
+            Serial.printf("[ModularOTA] OTA started: %s\n", event.message);
+            sendEvent(Event::OTA_STARTED, event.message, event.progress);
+            break;
+
+        case OTACore::EventCode::PROGRESS:
+            sendEvent(Event::OTA_PROGRESS, event.message, event.progress);
             break;
             
-        case OTACore::Status::COMPLETE:
-            Serial.println("[ModularOTA] OTA completed: " + message);
-            sendEvent(Event::OTA_COMPLETED, message, 100);
+        case OTACore::EventCode::COMPLETED:
+            NetworkManager::exitPerformanceMode();
+            Serial.printf("[ModularOTA] OTA completed: %s\n", event.message);
+            sendEvent(Event::OTA_COMPLETED, event.message, 100);
             break;
             
-        case OTACore::Status::ERROR:
-            Serial.println("[ModularOTA] OTA failed: " + message);
-            sendEvent(Event::OTA_FAILED, message);
+        case OTACore::EventCode::FAILED:
+            NetworkManager::exitPerformanceMode();
+            Serial.printf("[ModularOTA] OTA failed: %s\n", event.message);
+            sendEvent(Event::OTA_FAILED, event.message);
+            break;
+
+        case OTACore::EventCode::ABORTED:
+        case OTACore::EventCode::SUSPENDED:
+            NetworkManager::exitPerformanceMode();
+            break;
+
+        case OTACore::EventCode::VALIDATED:
+        case OTACore::EventCode::ROLLED_BACK:
+            Serial.printf("[ModularOTA] %s\n", event.message);
             break;
             
         default:
@@ -287,6 +506,38 @@ void ModularOTA::onServerEvent(OTAWebServer::Event event, const String& message,
     }
 }
 
+void ModularOTA::onFetcherEvent(OTAFetcher::Event event, const String& message, int value) {
+    switch (event) {
+        case OTAFetcher::Event::UP_TO_DATE:
+            Serial.println("[ModularOTA] Fetcher: " + message);
+            break;
+
+        case OTAFetcher::Event::DOWNLOAD_FAILED:
+            // Failures after startUpdate are already reported by OTACore
+            if (OTACore::getStatus() != OTACore::Status::ERROR) {
+                Serial.println("[ModularOTA] Fetch failed: " + message);
+                sendEvent(Event::OTA_FAILED, message);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ModularOTA::startMulticast() {
+    if (!_otaEnabled || !_config.enableMulticast || OTAMulticast::isRunning()) {
+        return;
+    }
+
+    OTAMulticast::Config multicastConfig;
+    multicastConfig.port = _config.multicastPort;
+    multicastConfig.sharedKey = _config.multicastKey;
+    if (OTAMulticast::begin(multicastConfig)) {
+        Serial.println("[ModularOTA] Multicast receiver started");
+    }
+}
+
 void ModularOTA::sendEvent(Event event, const String& message, int value) {
     if (_callback) {
         _callback(event, message, value);
@@ -296,11 +547,21 @@ void ModularOTA::sendEvent(Event event, const String& message, int value) {
 bool ModularOTA::initializeComponents() {
     // Initialize OTA Core
     if (_otaEnabled) {
-        if (!OTACore::begin(_config.enablePersistence)) {
+        OTACore::Config coreConfig;
+        coreConfig.enablePersistence = _config.enablePersistence;
+        coreConfig.asyncWrite = _config.asyncFlashWrite;
+        coreConfig.validation.validationTimeout = _config.validationTimeout;
+        coreConfig.reboot = _config.reboot;
+        coreConfig.prepareSize = _config.prepareSize;
+        coreConfig.enableCompression = _config.enableCompression;
+        coreConfig.dispatch.progressStep = _config.progressStep;
+        coreConfig.dispatch.useTask = _config.eventTask;
+
+        if (!OTACore::begin(coreConfig)) {
             Serial.println("[ModularOTA] Failed to initialize OTA Core");
             return false;
         }
-        OTACore::setCallback(onOTAEvent);
+        OTACore::setEventHandler(onOTAEvent);
         Serial.println("[ModularOTA] OTA Core initialized");
     }
 
@@ -311,18 +572,27 @@ bool ModularOTA::initializeComponents() {
             return false;
         }
         NetworkManager::setCallback(onNetworkEvent);
-        NetworkManager::setReconnectInterval(_config.reconnectInterval);
-        Serial.println("[ModularOTA] Network Manager initialized");
 
-        // Connect to WiFi
-        if (!NetworkManager::connect()) {
-            Serial.println("[ModularOTA] Warning: Failed to connect to WiFi initially");
+        NetworkManager::ConnectPolicy connectPolicy;
+        connectPolicy.fastReconnect = _config.fastReconnect;
+        connectPolicy.backoffMax = _config.reconnectInterval;
+        NetworkManager::setConnectPolicy(connectPolicy);
+        NetworkManager::PerformanceProfile profile;
+        profile.cpuFrequency = _config.otaCpuFrequency;
+        NetworkManager::setPerformanceProfile(profile);
+        if ((uint32_t)_config.staticIP != 0) {
+            NetworkManager::setStaticIP(_config.staticIP, _config.staticGateway, _config.staticSubnet);
         }
+        Serial.println("[ModularOTA] Network Manager initialized");
+
+        // Connect in the background; CONNECTED starts the network services
+        NetworkManager::startConnect();
     }
 
     // Initialize OTA Web Server
     if (_serverEnabled) {
         OTAWebServer::Config serverConfig;
+        serverConfig.backend = _config.asyncServer ? OTAWebServer::Backend::ASYNC : OTAWebServer::Backend::SYNC;
         serverConfig.port = _config.serverPort;
         serverConfig.path = _config.otaPath;
         serverConfig.username = _config.authUsername;
@@ -339,6 +609,41 @@ bool ModularOTA::initializeComponents() {
         Serial.println("[ModularOTA] OTA Web Server initialized");
     }
 
+    // Initialize pull-mode fetcher
+    if (_otaEnabled && _config.fetchUrl.length() > 0) {
+        OTAFetcher::Config fetchConfig;
+        fetchConfig.url = _config.fetchUrl;
+        fetchConfig.currentVersion = _config.firmwareVersion;
+        fetchConfig.checkInterval = _config.fetchInterval;
+
+        if (!OTAFetcher::begin(fetchConfig)) {
+            Serial.println("[ModularOTA] Failed to initialize OTA Fetcher");
+            return false;
+        }
+        OTAFetcher::setCallback(onFetcherEvent);
+        _fetcherEnabled = true;
+        Serial.println("[ModularOTA] OTA Fetcher initialized");
+    }
+
+    // Joins now if connected, otherwise on the first CONNECTED event
+    if (_networkEnabled) {
+        startMulticast();
+    }
+
+    // Peer-to-peer propagation works with or without the AP
+    if (_otaEnabled && _config.enableEspNow) {
+        OTAEspNow::Config espNowConfig;
+        espNowConfig.firmwareBuild = _config.firmwareBuild;
+        espNowConfig.accept = _config.espNowAccept;
+        espNowConfig.sharedKey = _config.espNowKey;
+
+        if (!OTAEspNow::begin(espNowConfig)) {
+            Serial.println("[ModularOTA] Failed to initialize ESP-NOW transport");
+            return false;
+        }
+        Serial.println("[ModularOTA] ESP-NOW transport initialized");
+    }
+
     return true;
 }
 
@@ -354,6 +659,10 @@ void ModularOTA::logSystemInfo() {
     Serial.println("SSID: " + _config.ssid);
     Serial.println("OTA Port: " + String(_config.serverPort));
     Serial.println("OTA Path: " + _config.otaPath);
+    Serial.println("OTA Server backend: " + String(_config.asyncServer ? "async" : "sync"));
+    Serial.println("Service task: " + String(_config.runInTask ? "enabled" : "disabled"));
     Serial.println("Persistence: " + String(_config.enablePersistence ? "enabled" : "disabled"));
+    Serial.println("Async flash write: " + String(_config.asyncFlashWrite ? "enabled" : "disabled"));
+    Serial.println("Compressed images: " + String(_config.enableCompression ? "enabled" : "disabled"));
     Serial.println("Auto-reconnect: " + String(_config.autoReconnect ? "enabled" : "disabled"));
 }
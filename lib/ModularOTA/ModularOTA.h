@@ -1,9 +1,17 @@
 #pragma once
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "OTACore.h"
 #include "NetworkManager.h"
 #include "OTAWebServer.h"
+#include "OTAFetcher.h"
+#include "OTAMulticast.h"
+#include "OTAEspNow.h"
+
+// Buffer size that fits the full getSystemInfoJSON() document
+#define OTA_SYSTEM_JSON_SIZE 1344
 
 /**
  * @brief Main orchestrator for modular OTA system
@@ -22,24 +30,83 @@ public:
         String password;
         bool autoReconnect;
         unsigned long reconnectInterval;
+        bool fastReconnect;                // Reconnect to the cached AP without scanning
+        IPAddress staticIP;                // Fixed address (0.0.0.0 = DHCP)
+        IPAddress staticGateway;
+        IPAddress staticSubnet;
+        bool performanceMode;              // Radio awake at full power while an update runs (opt-in)
+        uint32_t otaCpuFrequency;          // CPU clock in MHz during an update (0 = unchanged)
         
         // OTA Core configuration
         bool enablePersistence;
+        bool asyncFlashWrite;              // Program flash from a writer task on the other core
+        unsigned long validationTimeout;   // Roll back a new image not validated by then (0 = never)
+        OTACore::RebootPolicy reboot;      // When to restart into a completed update
+        size_t prepareSize;                // Pre-erase the inactive slot after validation (0 = off)
+        bool enableCompression;            // Accept gzip-compressed images (~43KB preallocated)
+        uint8_t progressStep;              // Report OTA progress every N percent
+        bool eventTask;                    // Deliver OTA events from a low-priority task
         
         // Web Server configuration
+        bool asyncServer;                  // Serve OTA on AsyncWebServer (needs OTA_ASYNC_WEBSERVER)
         int serverPort;
         String otaPath;
         String authUsername;
         String authPassword;
         bool enableCORS;
         bool enableProgress;
-        size_t maxUploadSize;
+        size_t maxUploadSize;              // Largest accepted upload body (0 = update partition size)
+
+        // Pull-mode fetcher configuration (disabled when fetchUrl is empty)
+        String fetchUrl;
+        String firmwareVersion;
+        unsigned long fetchInterval;
+
+        // Fleet multicast receiver (joins the group whenever WiFi is connected)
+        bool enableMulticast;
+        uint16_t multicastPort;
+        String multicastKey;               // Pre-shared key authenticating announces (required)
+
+        // ESP-NOW peer-to-peer propagation between nodes
+        bool enableEspNow;
+        uint32_t firmwareBuild;            // Build number; neighbours offer only higher builds
+        bool espNowAccept;                 // Install images offered by neighbours
+        String espNowKey;                  // Pre-shared key authenticating offers (required)
+
+        // Service task configuration (handle() becomes a no-op when enabled)
+        bool runInTask;                    // Service the OTA stack from a dedicated task
+        uint32_t taskStackSize;            // Service task stack size in bytes
+        UBaseType_t taskPriority;          // Service task priority
+        int taskCore;                      // Core the service task is pinned to
+        unsigned long taskInterval;        // Delay between service iterations in ms
         
         // Constructor with default values
         Config() : ssid(""), password(""), autoReconnect(true), reconnectInterval(30000),
-                   enablePersistence(true), serverPort(3232), otaPath("/update"),
+                   fastReconnect(true), staticIP(0, 0, 0, 0), staticGateway(0, 0, 0, 0),
+                   staticSubnet(0, 0, 0, 0), performanceMode(false), otaCpuFrequency(0),
+                   enablePersistence(true), asyncFlashWrite(false), validationTimeout(60000),
+                   prepareSize(0), enableCompression(false),
+                   progressStep(1), eventTask(false),
+                   asyncServer(false), serverPort(3232), otaPath("/update"),
                    authUsername(""), authPassword(""), enableCORS(true), 
-                   enableProgress(true), maxUploadSize(1048576) {}
+                   enableProgress(true), maxUploadSize(0),
+                   fetchUrl(""), firmwareVersion(""), fetchInterval(0),
+                   enableMulticast(false), multicastPort(45454), multicastKey(""),
+                   enableEspNow(false), firmwareBuild(0), espNowAccept(false), espNowKey(""),
+                   runInTask(false), taskStackSize(8192), taskPriority(2),
+                   taskCore(ARDUINO_RUNNING_CORE == 0 ? 1 : 0), taskInterval(2) {}
+    };
+
+    /**
+     * @brief Snapshot of the system state, safe to read from any task
+     */
+    struct State {
+        NetworkManager::Status network;
+        OTACore::Status ota;
+        int progress;
+        bool otaActive;
+        bool serverRunning;
+        char lastError[64];
     };
 
     /**
@@ -76,9 +143,28 @@ public:
 
     /**
      * @brief Handle all system tasks (call from loop)
+     *
+     * Does nothing when Config::runInTask is set; the service task
+     * drives the components instead.
      */
     static void handle();
 
+    /**
+     * @brief Get a consistent snapshot of the system state
+     *
+     * Refreshed after every service iteration and on each OTA event, so it
+     * can be polled from loop() or another task while an upload runs.
+     *
+     * @return Current state
+     */
+    static State getState();
+
+    /**
+     * @brief Check if the OTA stack runs in its own task
+     * @return true while the service task is running
+     */
+    static bool isTaskRunning();
+
     /**
      * @brief Stop OTA system
      */
@@ -116,10 +202,18 @@ public:
 
     /**
      * @brief Get complete system information as JSON
-     * @return JSON string with system information
+     * @return JSON string with system information (empty if it did not fit)
      */
     static String getSystemInfoJSON();
 
+    /**
+     * @brief Render system information JSON into a caller buffer
+     * @param buffer Destination buffer
+     * @param size Buffer size (OTA_SYSTEM_JSON_SIZE fits the full document)
+     * @return Length of the rendered JSON, 0 (and an empty buffer) if it did not fit
+     */
+    static size_t writeSystemInfoJSON(char* buffer, size_t size);
+
     /**
      * @brief Enable/disable system components
      * @param enableNetwork Enable network manager
@@ -157,6 +251,12 @@ public:
      */
     static bool getMemoryInfo(size_t& freeHeap, size_t& totalHeap, size_t& minFreeHeap);
 
+    /**
+     * @brief Fetch firmware from the configured URL now
+     * @return true if the background download was started
+     */
+    static bool checkForUpdate();
+
 private:
     static Config _config;
     static CallbackFunction _callback;
@@ -164,10 +264,26 @@ private:
     static bool _networkEnabled;
     static bool _otaEnabled;
     static bool _serverEnabled;
+    static bool _fetcherEnabled;
+    static TaskHandle_t _task;
+    static volatile bool _taskStop;
+    static volatile bool _restartPending;
+    static State _state;
+    static portMUX_TYPE _stateLock;
+
+    static bool startTask();
+    static void stopTask();
+    static void serviceTask(void* param);
+    static void restartComponents();
+    static void stopComponents();
+    static void handleComponents();
+    static void updateState();
 
     static void onNetworkEvent(NetworkManager::Status status, const String& message);
-    static void onOTAEvent(OTACore::Status status, int progress, const String& message);
+    static void onOTAEvent(const OTACore::Event& event);
     static void onServerEvent(OTAWebServer::Event event, const String& message, int value);
+    static void onFetcherEvent(OTAFetcher::Event event, const String& message, int value);
+    static void startMulticast();
     static void sendEvent(Event event, const String& message = "", int value = 0);
     static bool initializeComponents();
     static void logSystemInfo();
@@ -1,14 +1,51 @@
 #include "NetworkManager.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <esp_wifi.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/dhcp.h>
+#include <time.h>
 
 // Static member definitions
 NetworkManager::Status NetworkManager::_status = Status::DISCONNECTED;
 String NetworkManager::_ssid = "";
 String NetworkManager::_password = "";
 bool NetworkManager::_autoReconnect = true;
-unsigned long NetworkManager::_reconnectInterval = 30000; // 30 seconds
-unsigned long NetworkManager::_lastReconnectAttempt = 0;
 NetworkManager::CallbackFunction NetworkManager::_callback = nullptr;
-int NetworkManager::_reconnectAttempts = 0;
+NetworkManager::Phase NetworkManager::_phase = NetworkManager::Phase::IDLE;
+unsigned long NetworkManager::_attemptStart = 0;
+unsigned long NetworkManager::_nextAttempt = 0;
+uint32_t NetworkManager::_failures = 0;
+volatile bool NetworkManager::_gotIP = false;
+volatile bool NetworkManager::_linkLost = false;
+volatile uint8_t NetworkManager::_disconnectReason = 0;
+NetworkManager::ConnectMetrics NetworkManager::_metrics = {};
+NetworkManager::PerformanceProfile NetworkManager::_profile;
+bool NetworkManager::_performanceMode = false;
+wifi_ps_type_t NetworkManager::_savedSleep = WIFI_PS_MIN_MODEM;
+wifi_power_t NetworkManager::_savedTxPower = WIFI_POWER_19_5dBm;
+uint32_t NetworkManager::_savedCpuFrequency = 0;
+NetworkManager::ConnectPolicy NetworkManager::_policy;
+IPAddress NetworkManager::_staticIP(0, 0, 0, 0);
+IPAddress NetworkManager::_staticGateway(0, 0, 0, 0);
+IPAddress NetworkManager::_staticSubnet(0, 0, 0, 0);
+IPAddress NetworkManager::_staticDNS(0, 0, 0, 0);
+NetworkManager::RTCData NetworkManager::_cache = {0};
+bool NetworkManager::_cacheValid = false;
+bool NetworkManager::_leaseValid = false;
+bool NetworkManager::_fastAttempt = false;
+bool NetworkManager::_leaseReused = false;
+bool NetworkManager::_leaseRenewing = false;
+uint32_t NetworkManager::_leaseRenewAt = 0;
+bool NetworkManager::_fastConnect = false;
+unsigned long NetworkManager::_lastConnectTime = 0;
+
+// Survives software resets (OTA reboots) but not power loss
+RTC_DATA_ATTR NetworkManager::RTCData rtc_net_data = {0};
+
+static const char* PREFS_NAMESPACE = "net_mgr";
+static const char* PREFS_AP = "ap";
 
 bool NetworkManager::begin(const char* ssid, const char* password, bool autoReconnect) {
     if (!ssid || strlen(ssid) == 0) {
@@ -20,10 +57,17 @@ bool NetworkManager::begin(const char* ssid, const char* password, bool autoReco
     _password = String(password);
     _autoReconnect = autoReconnect;
     _status = Status::DISCONNECTED;
-    _reconnectAttempts = 0;
+    _failures = 0;
+    // With auto-reconnect, the first handle() connects even without connect()
+    _phase = autoReconnect ? Phase::BACKOFF : Phase::IDLE;
+    _nextAttempt = millis();
 
-    // Set WiFi mode to station
+    // Set WiFi mode to station; credentials stay in RAM, not in the IDF's NVS copy.
+    // Reconnects are scheduled here, so the core's own retry loop is off.
+    WiFi.persistent(false);
     WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);
+    loadCache();
     
     // Register WiFi event handler
     WiFi.onEvent(onWiFiEvent);
@@ -39,32 +83,124 @@ void NetworkManager::setCallback(CallbackFunction callback) {
     _callback = callback;
 }
 
+void NetworkManager::startConnect() {
+    if (_phase == Phase::FAST || _phase == Phase::SCAN || _phase == Phase::ONLINE) {
+        return;
+    }
+
+    _failures = 0;
+    startAttempt(Status::CONNECTING);
+}
+
 bool NetworkManager::connect(unsigned long timeout) {
-    if (_status == Status::CONNECTED) {
+    if (isConnected()) {
         return true;
     }
 
-    updateStatus(Status::CONNECTING, "Connecting to WiFi...");
-    
-    WiFi.begin(_ssid.c_str(), _password.c_str());
-    
+    startConnect();
     unsigned long startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && (millis() - startTime) < timeout) {
-        delay(100);
-        Serial.print(".");
+    while (_phase != Phase::ONLINE && _phase != Phase::IDLE && (millis() - startTime) < timeout) {
+        handle();
+        delay(10);
     }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-        updateStatus(Status::CONNECTED, "Connected to " + _ssid + " (IP: " + WiFi.localIP().toString() + ")");
-        _reconnectAttempts = 0;
-        return true;
-    } else {
-        updateStatus(Status::FAILED, "Failed to connect to " + _ssid);
-        return false;
+    return isConnected();
+}
+
+void NetworkManager::setConnectPolicy(const ConnectPolicy& policy) {
+    _policy = policy;
+}
+
+NetworkManager::ConnectPolicy NetworkManager::getConnectPolicy() {
+    return _policy;
+}
+
+void NetworkManager::setStaticIP(const IPAddress& ip, const IPAddress& gateway, const IPAddress& subnet,
+                                 const IPAddress& dns) {
+    _staticIP = ip;
+    _staticGateway = gateway;
+    _staticSubnet = subnet;
+    _staticDNS = (uint32_t)dns != 0 ? dns : gateway;
+    Serial.println("[NetworkManager] " + ((uint32_t)ip != 0 ? "Static IP " + ip.toString() : String("DHCP")));
+}
+
+void NetworkManager::clearCache() {
+    invalidateCache();
+    _cache.magic = 0;
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, false)) {
+        prefs.remove(PREFS_AP);
+        prefs.end();
+    }
+}
+
+unsigned long NetworkManager::getLastConnectTime() {
+    return _lastConnectTime;
+}
+
+bool NetworkManager::wasFastConnect() {
+    return _fastConnect;
+}
+
+NetworkManager::ConnectMetrics NetworkManager::getConnectMetrics() {
+    ConnectMetrics metrics = _metrics;
+    long remaining = (long)(_nextAttempt - millis());
+    metrics.nextRetryIn = _phase == Phase::BACKOFF && remaining > 0 ? remaining : 0;
+    return metrics;
+}
+
+void NetworkManager::setPerformanceProfile(const PerformanceProfile& profile) {
+    _profile = profile;
+}
+
+void NetworkManager::enterPerformanceMode() {
+    if (_performanceMode) {
+        return;
+    }
+
+    esp_wifi_get_ps(&_savedSleep);
+    _savedTxPower = WiFi.getTxPower();
+    _savedCpuFrequency = getCpuFrequencyMhz();
+
+    if (_profile.disableSleep) {
+        esp_wifi_set_ps(WIFI_PS_NONE);
+    }
+    if (_profile.txPower != 0) {
+        WiFi.setTxPower(_profile.txPower);
+    }
+    if (_profile.cpuFrequency != 0 && _profile.cpuFrequency != _savedCpuFrequency) {
+        setCpuFrequencyMhz(_profile.cpuFrequency);
     }
+    _performanceMode = true;
+
+    Serial.println("[NetworkManager] Performance mode on (CPU " + String(getCpuFrequencyMhz()) + " MHz)");
+}
+
+void NetworkManager::exitPerformanceMode() {
+    if (!_performanceMode) {
+        return;
+    }
+
+    if (_profile.cpuFrequency != 0 && getCpuFrequencyMhz() != _savedCpuFrequency) {
+        setCpuFrequencyMhz(_savedCpuFrequency);
+    }
+    if (_profile.txPower != 0) {
+        WiFi.setTxPower(_savedTxPower);
+    }
+    if (_profile.disableSleep) {
+        esp_wifi_set_ps(_savedSleep);
+    }
+    _performanceMode = false;
+
+    Serial.println("[NetworkManager] Performance mode off");
+}
+
+bool NetworkManager::isPerformanceMode() {
+    return _performanceMode;
 }
 
 void NetworkManager::disconnect() {
+    _phase = Phase::IDLE;
     WiFi.disconnect(true);
     updateStatus(Status::DISCONNECTED, "Disconnected from WiFi");
 }
@@ -84,6 +220,13 @@ String NetworkManager::getIPAddress() {
     return "0.0.0.0";
 }
 
+IPAddress NetworkManager::getLocalIP() {
+    if (isConnected()) {
+        return WiFi.localIP();
+    }
+    return IPAddress(0, 0, 0, 0);
+}
+
 int NetworkManager::getRSSI() {
     if (isConnected()) {
         return WiFi.RSSI();
@@ -98,22 +241,67 @@ String NetworkManager::getSSID() {
     return _ssid;
 }
 
+const char* NetworkManager::getSSIDCStr() {
+    return _ssid.c_str();
+}
+
 void NetworkManager::handle() {
-    // Handle auto-reconnection
-    if (_autoReconnect && !isConnected() && _status != Status::CONNECTING) {
-        unsigned long currentTime = millis();
-        
-        if (currentTime - _lastReconnectAttempt >= _reconnectInterval) {
-            if (_reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
-                attemptReconnect();
-            } else {
-                // Reset attempts after extended wait
-                if (currentTime - _lastReconnectAttempt >= (_reconnectInterval * 10)) {
-                    _reconnectAttempts = 0;
-                }
-            }
+    // Events are flagged on the WiFi task and acted on here
+    if (_gotIP) {
+        _gotIP = false;
+        if (_phase != Phase::IDLE && _phase != Phase::ONLINE) {
+            onConnected();
+        } else if (_phase == Phase::ONLINE && _leaseRenewing) {
+            // The lease DHCP handed out replaces the reused one
+            _leaseRenewing = false;
+            saveCache();
+            Serial.println("[NetworkManager] DHCP lease obtained: " + WiFi.localIP().toString());
         }
     }
+
+    // DHCP never renews a reused lease; give it back before it runs out
+    if (_phase == Phase::ONLINE && _leaseReused && (int32_t)((uint32_t)time(nullptr) - _leaseRenewAt) >= 0) {
+        _leaseReused = false;
+        _leaseRenewing = true;
+        Serial.println("[NetworkManager] Handing the reused lease back to DHCP");
+        WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+    }
+
+    if (_linkLost) {
+        _linkLost = false;
+        onLinkLost(_disconnectReason);
+    } else if (_phase == Phase::ONLINE && WiFi.status() != WL_CONNECTED) {
+        // Link dropped without an event we act on, e.g. WiFi.disconnect() elsewhere
+        onLinkLost(0);
+    }
+
+    unsigned long now = millis();
+    switch (_phase) {
+        case Phase::FAST:
+            if (now - _attemptStart >= _policy.fastTimeout) {
+                Serial.println("[NetworkManager] Cached AP not reachable, scanning");
+                invalidateCache();
+                WiFi.disconnect();
+                beginScan();
+                _phase = Phase::SCAN;
+            }
+            break;
+
+        case Phase::SCAN:
+            if (now - _attemptStart >= _policy.attemptTimeout) {
+                failAttempt("Timed out connecting to " + _ssid);
+            }
+            break;
+
+        case Phase::BACKOFF:
+            if ((long)(now - _nextAttempt) >= 0) {
+                startAttempt(_metrics.attempts == 0 ? Status::CONNECTING : Status::RECONNECTING);
+            }
+            break;
+
+        default:
+            break;
+    }
 }
 
 void NetworkManager::setAutoReconnect(bool enable) {
@@ -126,8 +314,8 @@ bool NetworkManager::isAutoReconnectEnabled() {
 }
 
 void NetworkManager::setReconnectInterval(unsigned long interval) {
-    _reconnectInterval = interval;
-    Serial.println("[NetworkManager] Reconnect interval set to " + String(interval) + "ms");
+    _policy.backoffMax = interval;
+    Serial.println("[NetworkManager] Reconnect backoff capped at " + String(interval) + "ms");
 }
 
 bool NetworkManager::getNetworkInfo(IPAddress& ip, IPAddress& gateway, IPAddress& subnet) {
@@ -142,7 +330,7 @@ bool NetworkManager::getNetworkInfo(IPAddress& ip, IPAddress& gateway, IPAddress
     return true;
 }
 
-void NetworkManager::onWiFiEvent(WiFiEvent_t event) {
+void NetworkManager::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
     switch (event) {
         case ARDUINO_EVENT_WIFI_STA_START:
             Serial.println("[NetworkManager] WiFi started");
@@ -153,13 +341,16 @@ void NetworkManager::onWiFiEvent(WiFiEvent_t event) {
             break;
             
         case ARDUINO_EVENT_WIFI_STA_GOT_IP:
-            updateStatus(Status::CONNECTED, "Got IP: " + WiFi.localIP().toString());
+            _gotIP = true;
             break;
             
         case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
-            if (_status == Status::CONNECTED) {
-                updateStatus(Status::DISCONNECTED, "WiFi disconnected");
+            // Our own disconnect ahead of a new attempt
+            if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) {
+                break;
             }
+            _disconnectReason = info.wifi_sta_disconnected.reason;
+            _linkLost = true;
             break;
             
         default:
@@ -188,13 +379,254 @@ void NetworkManager::updateStatus(Status newStatus, const String& message) {
     }
 }
 
-void NetworkManager::attemptReconnect() {
-    _reconnectAttempts++;
-    _lastReconnectAttempt = millis();
-    
-    updateStatus(Status::RECONNECTING, "Reconnect attempt " + String(_reconnectAttempts) + "/" + String(MAX_RECONNECT_ATTEMPTS));
-    
-    WiFi.disconnect();
-    delay(1000);
+void NetworkManager::startAttempt(Status status) {
+    _metrics.attempts++;
+    _attemptStart = millis();
+    _gotIP = false;
+    _linkLost = false;
+
+    updateStatus(status, status == Status::RECONNECTING
+                         ? "Reconnect attempt " + String(_failures + 1)
+                         : String("Connecting to WiFi..."));
+
+    // Direct association with the cached AP, then a full scan
+    if (beginFast()) {
+        _phase = Phase::FAST;
+    } else {
+        beginScan();
+        _phase = Phase::SCAN;
+    }
+}
+
+bool NetworkManager::beginFast() {
+    if (!_policy.fastReconnect || !_cacheValid) {
+        return false;
+    }
+
+    _leaseReused = false;
+    if ((uint32_t)_staticIP != 0) {
+        WiFi.config(_staticIP, _staticGateway, _staticSubnet, _staticDNS);
+    } else if (_policy.reuseLease && _leaseValid && leaseRemaining() >= LEASE_MIN_REMAINING_S) {
+        _leaseReused = true;
+        WiFi.config(IPAddress(_cache.ip), IPAddress(_cache.gateway), IPAddress(_cache.subnet),
+                    IPAddress(_cache.dns));
+    } else {
+        WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+    }
+
+    _fastAttempt = true;
+    WiFi.begin(_ssid.c_str(), _password.c_str(), _cache.channel, _cache.bssid);
+    return true;
+}
+
+void NetworkManager::beginScan() {
+    if ((uint32_t)_staticIP != 0) {
+        WiFi.config(_staticIP, _staticGateway, _staticSubnet, _staticDNS);
+    } else {
+        WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+    }
+
+    _fastAttempt = false;
+    _leaseReused = false;
     WiFi.begin(_ssid.c_str(), _password.c_str());
 }
+
+void NetworkManager::onConnected() {
+    uint32_t latency = millis() - _attemptStart;
+    _lastConnectTime = latency;
+    _fastConnect = _fastAttempt;
+    _fastAttempt = false;
+    _failures = 0;
+    _phase = Phase::ONLINE;
+
+    _metrics.successes++;
+    _metrics.lastLatency = latency;
+    _metrics.lastSuccess = true;
+    _metrics.totalLatency += latency;
+    if (_metrics.successes == 1 || latency < _metrics.minLatency) {
+        _metrics.minLatency = latency;
+    }
+    if (latency > _metrics.maxLatency) {
+        _metrics.maxLatency = latency;
+    }
+    if (_fastConnect) {
+        _metrics.fastConnects++;
+    }
+
+    Serial.println("[NetworkManager] Online in " + String(latency) + "ms" +
+                   (_fastConnect ? " (cached AP)" : ""));
+    _leaseRenewing = false;
+    if (_leaseReused) {
+        // Like a DHCP client's T1: renew at half the time the lease has left
+        uint32_t remaining = leaseRemaining();
+        _leaseRenewAt = (uint32_t)time(nullptr) + remaining / 2;
+        Serial.println("[NetworkManager] Reused lease, DHCP takes over in " + String(remaining / 2) + "s");
+    }
+    saveCache();
+    updateStatus(Status::CONNECTED, "Connected to " + _ssid + " (IP: " + WiFi.localIP().toString() + ")");
+}
+
+void NetworkManager::onLinkLost(uint8_t reason) {
+    _metrics.lastReason = reason;
+
+    switch (_phase) {
+        case Phase::ONLINE:
+            _metrics.disconnects++;
+            updateStatus(Status::DISCONNECTED, "WiFi disconnected (reason " + String(reason) + ")");
+            _failures = 0;
+            if (_autoReconnect) {
+                // First retry straight away, most drops are brief
+                _nextAttempt = millis();
+                _phase = Phase::BACKOFF;
+            } else {
+                _phase = Phase::IDLE;
+            }
+            break;
+
+        case Phase::FAST:
+            // The cached AP refused us or is gone; no need to wait out fastTimeout
+            Serial.println("[NetworkManager] Cached AP refused (reason " + String(reason) + "), scanning");
+            invalidateCache();
+            beginScan();
+            _phase = Phase::SCAN;
+            break;
+
+        case Phase::SCAN:
+            failAttempt("Failed to connect to " + _ssid + " (reason " + String(reason) + ")");
+            break;
+
+        default:
+            break;
+    }
+}
+
+void NetworkManager::failAttempt(const String& message) {
+    uint32_t latency = millis() - _attemptStart;
+    _failures++;
+    _metrics.failures++;
+    _metrics.lastLatency = latency;
+    _metrics.lastSuccess = false;
+
+    // Stop the driver from carrying on with this attempt
+    WiFi.disconnect();
+    Serial.println("[NetworkManager] Attempt failed after " + String(latency) + "ms");
+    updateStatus(Status::FAILED, message);
+
+    if (_autoReconnect) {
+        scheduleRetry();
+    } else {
+        _phase = Phase::IDLE;
+    }
+}
+
+void NetworkManager::scheduleRetry() {
+    // Doubling from backoffBase, capped, minus a random share
+    unsigned long delayMs = _policy.backoffBase;
+    for (uint32_t i = 1; i < _failures && delayMs < _policy.backoffMax; i++) {
+        delayMs *= 2;
+    }
+    if (delayMs > _policy.backoffMax) {
+        delayMs = _policy.backoffMax;
+    }
+    uint8_t jitter = _policy.jitterPercent > 100 ? 100 : _policy.jitterPercent;
+    delayMs -= random((long)(delayMs * jitter / 100) + 1);
+
+    _nextAttempt = millis() + delayMs;
+    _phase = Phase::BACKOFF;
+    Serial.println("[NetworkManager] Next attempt in " + String(delayMs) + "ms");
+}
+
+void NetworkManager::loadCache() {
+    _cacheValid = false;
+    _leaseValid = false;
+
+    // Warm reset: AP and lease from RTC memory
+    RTCData data = rtc_net_data;
+    if (data.magic == RTC_MAGIC && data.crc == calculateCRC(data) && data.ssidHash == hashSSID()) {
+        _cache = data;
+        _cacheValid = data.channel > 0;
+        _leaseValid = data.ip != 0;
+        Serial.println("[NetworkManager] Restored AP and lease from RTC memory");
+        return;
+    }
+
+    // Cold boot: only the AP, a stored lease may long have expired
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, true)) {
+        return;
+    }
+    if (prefs.getBytes(PREFS_AP, &data, sizeof(data)) == sizeof(data) && data.magic == RTC_MAGIC &&
+        data.crc == calculateCRC(data) && data.ssidHash == hashSSID()) {
+        _cache = data;
+        _cacheValid = data.channel > 0;
+        Serial.println("[NetworkManager] Restored AP from NVS");
+    }
+    prefs.end();
+}
+
+void NetworkManager::saveCache() {
+    RTCData data = {0};
+    data.magic = RTC_MAGIC;
+    data.ssidHash = hashSSID();
+    uint8_t* bssid = WiFi.BSSID();
+    if (bssid) {
+        memcpy(data.bssid, bssid, sizeof(data.bssid));
+    }
+    data.channel = WiFi.channel();
+
+    // NVS only when the AP changed, to spare the flash; an invalidated cache
+    // still holds the AP it was loaded with
+    bool apChanged = _cache.magic != RTC_MAGIC || data.channel != _cache.channel ||
+                     memcmp(data.bssid, _cache.bssid, sizeof(data.bssid)) != 0;
+    if (apChanged) {
+        data.crc = calculateCRC(data);
+        Preferences prefs;
+        if (prefs.begin(PREFS_NAMESPACE, false)) {
+            prefs.putBytes(PREFS_AP, &data, sizeof(data));
+            prefs.end();
+        }
+    }
+
+    // Only a lease from DHCP with a known lifetime is kept; a reused lease
+    // was never renewed, so the next warm reset asks DHCP again
+    uint32_t lease = _leaseReused ? 0 : dhcpLeaseTime();
+    data.ip = lease > 0 ? (uint32_t)WiFi.localIP() : 0;
+    data.gateway = (uint32_t)WiFi.gatewayIP();
+    data.subnet = (uint32_t)WiFi.subnetMask();
+    data.dns = (uint32_t)WiFi.dnsIP(0);
+    data.leaseExpiry = lease > 0 ? (uint32_t)time(nullptr) + lease : 0;
+    data.crc = calculateCRC(data);
+    rtc_net_data = data;
+
+    _cache = data;
+    _cacheValid = data.channel > 0;
+    _leaseValid = data.ip != 0;
+}
+
+void NetworkManager::invalidateCache() {
+    // RTC only: a fast-path failure must not cost a flash write
+    _cacheValid = false;
+    _leaseValid = false;
+    rtc_net_data.magic = 0;
+}
+
+uint32_t NetworkManager::leaseRemaining() {
+    // time() keeps counting across software resets, so the expiry stays meaningful
+    uint32_t now = (uint32_t)time(nullptr);
+    return _cache.leaseExpiry > now ? _cache.leaseExpiry - now : 0;
+}
+
+uint32_t NetworkManager::dhcpLeaseTime() {
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    struct netif* lwip = netif ? (struct netif*)esp_netif_get_netif_impl(netif) : nullptr;
+    struct dhcp* dhcp = lwip ? netif_dhcp_data(lwip) : nullptr;
+    return dhcp && dhcp->state == DHCP_STATE_BOUND ? dhcp->offered_t0_lease : 0;
+}
+
+uint32_t NetworkManager::calculateCRC(const RTCData& data) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&data, offsetof(RTCData, crc));
+}
+
+uint32_t NetworkManager::hashSSID() {
+    return esp_rom_crc32_le(0, (const uint8_t*)_ssid.c_str(), _ssid.length());
+}
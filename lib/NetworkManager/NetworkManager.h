@@ -8,7 +8,9 @@
  * @brief Network management for OTA functionality
  * 
  * Handles WiFi connectivity, reconnection, and network status monitoring
- * for reliable OTA operations.
+ * for reliable OTA operations. Connecting is a state machine advanced by
+ * WiFi events and handle(); no call waits for the access point except the
+ * connect() convenience wrapper.
  */
 class NetworkManager {
 public:
@@ -23,6 +25,88 @@ public:
         RECONNECTING
     };
 
+    /**
+     * @brief How connect() and reconnects reach the access point
+     *
+     * The BSSID, channel and DHCP lease of the last good connection are kept
+     * in RTC memory, and BSSID and channel also in NVS. With fastReconnect
+     * the next connection associates directly with that AP on that channel,
+     * skipping the scan; after a warm reset (an OTA reboot) an unexpired lease
+     * is reused once as well, skipping DHCP, and handed back to the DHCP
+     * client at half its remaining time. If the fast path does not connect
+     * within fastTimeout, the RTC cache is dropped and a full scan follows.
+     *
+     * A failed attempt is retried after an exponential backoff, doubling from
+     * backoffBase up to backoffMax, of which a random share of up to
+     * jitterPercent is taken off so a site full of devices does not retry in
+     * lockstep after an AP restart.
+     */
+    struct ConnectPolicy {
+        bool fastReconnect;                // Try the cached BSSID/channel first
+        bool reuseLease;                   // Reuse the cached lease after a warm reset
+        unsigned long fastTimeout;         // Give the fast path this long before scanning
+        unsigned long attemptTimeout;      // Give up an attempt after this long
+        unsigned long backoffBase;         // Delay before the second retry
+        unsigned long backoffMax;          // Upper bound of the retry delay
+        uint8_t jitterPercent;             // Random reduction of each delay, 0-100
+
+        ConnectPolicy() : fastReconnect(true), reuseLease(true), fastTimeout(1500),
+                          attemptTimeout(10000), backoffBase(1000), backoffMax(30000),
+                          jitterPercent(50) {}
+    };
+
+    /**
+     * @brief Connection attempt metrics
+     */
+    struct ConnectMetrics {
+        uint32_t attempts;                 // Attempts started
+        uint32_t successes;                // Attempts that got an address
+        uint32_t failures;                 // Attempts that timed out or were refused
+        uint32_t fastConnects;             // Successes via the cached AP
+        uint32_t disconnects;              // Links lost after connecting
+        uint32_t lastLatency;              // Duration of the last attempt in ms
+        uint32_t minLatency;               // Fastest successful attempt in ms
+        uint32_t maxLatency;               // Slowest successful attempt in ms
+        uint32_t totalLatency;             // Sum over successful attempts in ms
+        uint8_t lastReason;                // Last disconnect reason (wifi_err_reason_t)
+        bool lastSuccess;                  // Outcome of the last attempt
+        uint32_t nextRetryIn;              // ms until the next attempt (0 if none pending)
+    };
+
+    /**
+     * @brief Radio and CPU settings applied while an update is transferred
+     *
+     * Modem sleep holds received frames until the next DTIM beacon, which
+     * stalls every TCP window of an upload. The profile keeps the radio
+     * awake at full transmit power, and optionally the CPU at a higher clock,
+     * only for the duration of an update; the previous settings are restored
+     * afterwards.
+     */
+    struct PerformanceProfile {
+        bool disableSleep;                 // WIFI_PS_NONE instead of modem sleep
+        wifi_power_t txPower;              // Transmit power (0 = unchanged)
+        uint32_t cpuFrequency;             // CPU clock in MHz (0 = unchanged)
+
+        PerformanceProfile() : disableSleep(true), txPower(WIFI_POWER_19_5dBm), cpuFrequency(240) {}
+    };
+
+    /**
+     * @brief Network state kept in RTC memory across resets
+     */
+    struct RTCData {
+        uint32_t magic;
+        uint32_t ssidHash;                 // Cache only applies to the same network
+        uint8_t bssid[6];
+        uint8_t channel;
+        uint8_t reserved;
+        uint32_t ip;
+        uint32_t gateway;
+        uint32_t subnet;
+        uint32_t dns;
+        uint32_t leaseExpiry;              // time() at which the lease runs out (0 if none)
+        uint32_t crc;
+    };
+
     /**
      * @brief Network event callback function type
      */
@@ -44,12 +128,96 @@ public:
     static void setCallback(CallbackFunction callback);
 
     /**
-     * @brief Connect to WiFi network
+     * @brief Start connecting without waiting
+     *
+     * Progress is reported through the callback from handle(); with
+     * auto-reconnect enabled, failed attempts are retried with backoff.
+     */
+    static void startConnect();
+
+    /**
+     * @brief Connect and wait for the result (for setup code)
+     *
+     * Runs startConnect() and services handle() until connected or timed
+     * out. An attempt still running at the timeout carries on in the
+     * background.
+     *
      * @param timeout Connection timeout in milliseconds
      * @return true if connection successful
      */
     static bool connect(unsigned long timeout = 10000);
 
+    /**
+     * @brief Set how connections are established
+     * @param policy Fast-reconnect policy
+     */
+    static void setConnectPolicy(const ConnectPolicy& policy);
+
+    /**
+     * @brief Get the connect policy
+     * @return Current policy
+     */
+    static ConnectPolicy getConnectPolicy();
+
+    /**
+     * @brief Use a fixed address instead of DHCP
+     * @param ip Local IP address (0.0.0.0 returns to DHCP)
+     * @param gateway Gateway IP address
+     * @param subnet Subnet mask
+     * @param dns DNS server (defaults to the gateway)
+     */
+    static void setStaticIP(const IPAddress& ip, const IPAddress& gateway, const IPAddress& subnet,
+                            const IPAddress& dns = IPAddress(0, 0, 0, 0));
+
+    /**
+     * @brief Forget the cached BSSID, channel and lease
+     */
+    static void clearCache();
+
+    /**
+     * @brief Get the duration of the last successful connect
+     * @return Milliseconds from WiFi.begin() to an IP address (0 if none yet)
+     */
+    static unsigned long getLastConnectTime();
+
+    /**
+     * @brief Check if the last connection used the cached AP
+     * @return true if the scan was skipped
+     */
+    static bool wasFastConnect();
+
+    /**
+     * @brief Get connection attempt metrics
+     * @return Metrics snapshot
+     */
+    static ConnectMetrics getConnectMetrics();
+
+    /**
+     * @brief Set the settings applied by enterPerformanceMode()
+     * @param profile Performance profile
+     */
+    static void setPerformanceProfile(const PerformanceProfile& profile);
+
+    /**
+     * @brief Apply the performance profile, saving the current settings
+     *
+     * Does nothing if already applied. Call when an update starts.
+     */
+    static void enterPerformanceMode();
+
+    /**
+     * @brief Restore the settings saved by enterPerformanceMode()
+     *
+     * Does nothing if the profile is not applied. Call when an update ends.
+     */
+    static void exitPerformanceMode();
+
+    /**
+     * @brief Check if the performance profile is applied
+     * @return true between enterPerformanceMode() and exitPerformanceMode()
+     */
+    static bool isPerformanceMode();
+
     /**
      * @brief Disconnect from WiFi network
      */
@@ -73,6 +241,12 @@ public:
      */
     static String getIPAddress();
 
+    /**
+     * @brief Get local IP address without formatting it
+     * @return IP address (0.0.0.0 when disconnected)
+     */
+    static IPAddress getLocalIP();
+
     /**
      * @brief Get WiFi signal strength
      * @return RSSI value
@@ -86,7 +260,13 @@ public:
     static String getSSID();
 
     /**
-     * @brief Handle network tasks (call from loop)
+     * @brief Get the configured SSID without copying it
+     * @return SSID the manager connects to
+     */
+    static const char* getSSIDCStr();
+
+    /**
+     * @brief Advance the connection state machine (call from loop)
      */
     static void handle();
 
@@ -103,8 +283,8 @@ public:
     static bool isAutoReconnectEnabled();
 
     /**
-     * @brief Set reconnection interval
-     * @param interval Interval in milliseconds
+     * @brief Set the longest delay between reconnect attempts
+     * @param interval Backoff cap in milliseconds (ConnectPolicy::backoffMax)
      */
     static void setReconnectInterval(unsigned long interval);
 
@@ -122,13 +302,63 @@ private:
     static String _ssid;
     static String _password;
     static bool _autoReconnect;
-    static unsigned long _reconnectInterval;
-    static unsigned long _lastReconnectAttempt;
     static CallbackFunction _callback;
-    static int _reconnectAttempts;
-    static const int MAX_RECONNECT_ATTEMPTS = 5;
 
-    static void onWiFiEvent(WiFiEvent_t event);
+    /**
+     * @brief Connection state machine phases
+     */
+    enum class Phase {
+        IDLE,                              // Not trying to connect
+        FAST,                              // Associating with the cached AP
+        SCAN,                              // Scanning and associating
+        ONLINE,                            // Connected with an address
+        BACKOFF                            // Waiting for the next attempt
+    };
+
+    static Phase _phase;
+    static unsigned long _attemptStart;
+    static unsigned long _nextAttempt;
+    static uint32_t _failures;             // Consecutive failed attempts
+    static volatile bool _gotIP;           // Set on the WiFi event task
+    static volatile bool _linkLost;
+    static volatile uint8_t _disconnectReason;
+    static ConnectMetrics _metrics;
+    static ConnectPolicy _policy;
+    static PerformanceProfile _profile;
+    static bool _performanceMode;
+    static wifi_ps_type_t _savedSleep;
+    static wifi_power_t _savedTxPower;
+    static uint32_t _savedCpuFrequency;
+    static IPAddress _staticIP;
+    static IPAddress _staticGateway;
+    static IPAddress _staticSubnet;
+    static IPAddress _staticDNS;
+    static RTCData _cache;
+    static bool _cacheValid;
+    static bool _leaseValid;
+    static bool _fastAttempt;
+    static bool _leaseReused;
+    static bool _leaseRenewing;            // DHCP restarted after a reused lease
+    static uint32_t _leaseRenewAt;         // time() at which a reused lease goes back to DHCP
+    static bool _fastConnect;
+    static unsigned long _lastConnectTime;
+    static const uint32_t RTC_MAGIC = 0x4E45544D;   // "NETM"
+    static const uint32_t LEASE_MIN_REMAINING_S = 120;  // Shorter leases are not reused
+
+    static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+    static void startAttempt(Status status);
+    static bool beginFast();
+    static void beginScan();
+    static void onConnected();
+    static void onLinkLost(uint8_t reason);
+    static void failAttempt(const String& message);
+    static void scheduleRetry();
+    static void loadCache();
+    static void saveCache();
+    static void invalidateCache();
+    static uint32_t leaseRemaining();
+    static uint32_t dhcpLeaseTime();
+    static uint32_t calculateCRC(const RTCData& data);
+    static uint32_t hashSSID();
     static void updateStatus(Status newStatus, const String& message = "");
-    static void attemptReconnect();
 };
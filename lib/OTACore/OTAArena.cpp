@@ -0,0 +1,55 @@
+#include "OTACore.h"
+#include "OTAArena.h"
+
+#if OTA_STATIC_MEMORY
+static uint8_t s_arena[OTA_ARENA_SIZE] __attribute__((aligned(16)));
+#endif
+
+size_t OTAArena::_used = 0;
+uint16_t OTAArena::_regions = 0;
+uint16_t OTAArena::_failures = 0;
+
+void* OTAArena::claim(Region& region, size_t size, size_t align) {
+    if (region.data) {
+        return size <= region.size ? region.data : nullptr;
+    }
+
+#if OTA_STATIC_MEMORY
+    size_t start = (_used + align - 1) & ~(align - 1);
+    if (start + size > OTA_ARENA_SIZE) {
+        _failures++;
+        Serial.println("[OTAArena] Out of space: " + String(size) + " bytes requested, " +
+                       String(OTA_ARENA_SIZE - _used) + " free");
+        return nullptr;
+    }
+
+    region.data = s_arena + start;
+    region.size = size;
+    _used = start + size;
+    _regions++;
+    return region.data;
+#else
+    return nullptr;
+#endif
+}
+
+bool OTAArena::enabled() {
+    return OTA_STATIC_MEMORY != 0;
+}
+
+OTAArena::Stats OTAArena::getStats() {
+    Stats stats;
+    stats.capacity = OTA_STATIC_MEMORY ? OTA_ARENA_SIZE : 0;
+    stats.used = _used;
+    stats.regions = _regions;
+    stats.failures = _failures;
+    return stats;
+}
+
+void OTAArena::reserve(String& message) {
+#if OTA_STATIC_MEMORY
+    message.reserve(OTA_MESSAGE_SIZE);
+#else
+    (void)message;
+#endif
+}
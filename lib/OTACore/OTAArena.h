@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Bounded-memory mode: OTA buffers and server objects come from a fixed arena
+// instead of the heap. Enable with -DOTA_STATIC_MEMORY=1 in build_flags.
+#ifndef OTA_STATIC_MEMORY
+#define OTA_STATIC_MEMORY 0
+#endif
+
+// Arena size in bytes; the default covers two OTA_BUFFER_SIZE write buffers,
+// a 4KB raw upload buffer, a 4KB fetch buffer and the server objects
+#ifndef OTA_ARENA_SIZE
+#define OTA_ARENA_SIZE (2 * ((OTA_BUFFER_SIZE + 4095) / 4096) * 4096 + 12288)
+#endif
+
+// Capacity reserved for last-error and status messages
+#ifndef OTA_MESSAGE_SIZE
+#define OTA_MESSAGE_SIZE 96
+#endif
+
+/**
+ * @brief Fixed memory arena for bounded-memory builds
+ *
+ * The arena is one static block, so its whole cost shows in the image's
+ * .bss and never depends on heap state. Each user owns a Region that is
+ * carved out on first use and kept for the life of the program: a module
+ * that is stopped and started again gets the same bytes back, so repeated
+ * begin()/stop() cycles cannot fragment anything. A Region never grows; a
+ * later request larger than the first one fails.
+ *
+ * Without OTA_STATIC_MEMORY the arena has no storage and every claim fails,
+ * so callers fall back to the heap.
+ */
+class OTAArena {
+public:
+    /**
+     * @brief Arena slice owned by one buffer or object
+     */
+    struct Region {
+        void* data;                        // Start of the slice, nullptr until claimed
+        size_t size;                       // Bytes in the slice
+
+        Region() : data(nullptr), size(0) {}
+    };
+
+    /**
+     * @brief Arena usage
+     */
+    struct Stats {
+        size_t capacity;                   // OTA_ARENA_SIZE (0 when disabled)
+        size_t used;                       // Bytes carved into regions
+        uint16_t regions;                  // Regions claimed
+        uint16_t failures;                 // Claims refused for lack of space
+    };
+
+    /**
+     * @brief Get the storage for a region, carving it out on first use
+     * @param region Region owned by the caller
+     * @param size Bytes needed
+     * @param align Alignment of the slice (power of two)
+     * @return Pointer to at least @p size bytes, nullptr if the arena is full
+     *         or the region was claimed smaller
+     */
+    static void* claim(Region& region, size_t size, size_t align = 4);
+
+    /**
+     * @brief Check if bounded-memory mode is compiled in
+     * @return true when built with OTA_STATIC_MEMORY
+     */
+    static bool enabled();
+
+    /**
+     * @brief Get arena usage
+     * @return Statistics snapshot
+     */
+    static Stats getStats();
+
+    /**
+     * @brief Reserve a message buffer once so later writes do not reallocate
+     * @param message String member holding errors or status text
+     */
+    static void reserve(String& message);
+
+private:
+    static size_t _used;
+    static uint16_t _regions;
+    static uint16_t _failures;
+};
@@ -1,30 +1,254 @@
 #include "OTACore.h"
+#include "OTAUtil.h"
 #include <esp_system.h>
 #include <esp_ota_ops.h>
 #include <esp_partition.h>
+#include <esp_heap_caps.h>
+#include <esp_image_format.h>
+#include <esp_rom_crc.h>
+#include <Preferences.h>
+#include <time.h>
+
+#if CONFIG_IDF_TARGET_ESP32
+#include <esp32/rom/miniz.h>
+#elif CONFIG_IDF_TARGET_ESP32S2
+#include <esp32s2/rom/miniz.h>
+#elif CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#elif CONFIG_IDF_TARGET_ESP32C3
+#include <esp32c3/rom/miniz.h>
+#endif
+
+// gzip member header (RFC 1952)
+static const uint8_t GZIP_ID1 = 0x1f;
+static const uint8_t GZIP_ID2 = 0x8b;
+static const uint8_t GZIP_CM_DEFLATE = 8;
+static const uint8_t GZIP_FHCRC = 0x02;
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+static const uint8_t GZIP_FIXED_HEADER = 10;
+
+// NVS record of an image that has not been validated yet
+static const char* PREFS_NAMESPACE = "ota_core";
+static const char* PREFS_PENDING = "pending";
+static const char* PREFS_FROM = "from";
+static const char* PREFS_TARGET = "target";
+static const char* PREFS_BOOTS = "boots";
+static const char* PREFS_DIGEST = "sha_";              // + partition label
+
+// Header parser states, in stream order
+enum : uint8_t {
+    GZ_FIXED,
+    GZ_EXTRA_LEN,
+    GZ_EXTRA,
+    GZ_NAME,
+    GZ_COMMENT,
+    GZ_HCRC,
+    GZ_DONE
+};
+
+// Delta patch stream: header, then bsdiff-style records of
+// {diff length, extra length, seek} followed by the diff and extra bytes
+static const uint8_t PATCH_MAGIC[4] = {'O', 'D', 'P', '1'};
+
+enum : uint8_t {
+    PATCH_DETECT,
+    PATCH_OFF,
+    PATCH_HEADER,
+    PATCH_CONTROL,
+    PATCH_DIFF,
+    PATCH_EXTRA,
+    PATCH_DONE
+};
+
+static bool parseHexDigest(const String& hex, uint8_t* digest) {
+    if (hex.length() != 64) {
+        return false;
+    }
+    for (int i = 0; i < 32; i++) {
+        char byte[3] = {hex[2 * i], hex[2 * i + 1], 0};
+        char* end = nullptr;
+        digest[i] = (uint8_t)strtoul(byte, &end, 16);
+        if (end != byte + 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Metrics histogram bucket upper bounds; the last bucket is open-ended
+static const uint32_t WRITE_LATENCY_BOUNDS_US[OTA_METRICS_BUCKETS - 1] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000
+};
+static const uint32_t CHUNK_SIZE_BOUNDS[OTA_METRICS_BUCKETS - 1] = {
+    256, 512, 1024, 1460, 2048, 4096, 8192
+};
+
+static uint8_t bucketIndex(uint32_t value, const uint32_t* bounds) {
+    uint8_t i = 0;
+    while (i < OTA_METRICS_BUCKETS - 1 && value >= bounds[i]) {
+        i++;
+    }
+    return i;
+}
 
 // Static member definitions
-OTACore::Status OTACore::_status = Status::IDLE;
-int OTACore::_progress = 0;
+volatile OTACore::Status OTACore::_status = Status::IDLE;
+volatile int OTACore::_progress = 0;
+unsigned long OTACore::_completeTime = 0;
+OTACore::RebootPolicy OTACore::_rebootPolicy;
+OTACore::IdleCheck OTACore::_idleCheck = nullptr;
+OTACore::RebootHook OTACore::_rebootHook = nullptr;
+bool OTACore::_rebootScheduled = false;
+unsigned long OTACore::_rebootRequestTime = 0;
+unsigned long OTACore::_rebootDelay = 0;
+OTACore::ValidationPolicy OTACore::_validation;
+OTACore::HealthCheck OTACore::_healthCheck = nullptr;
+bool OTACore::_pendingVerify = false;
+unsigned long OTACore::_verifyStart = 0;
+unsigned long OTACore::_lastHealthCheck = 0;
+bool OTACore::_healthChecked = false;
+bool OTACore::_bootCounted = false;
 String OTACore::_lastError = "";
 OTACore::CallbackFunction OTACore::_callback = nullptr;
+OTACore::EventHandler OTACore::_eventHandler = nullptr;
+OTACore::DispatchPolicy OTACore::_dispatchPolicy;
+int OTACore::_lastEventProgress = 0;
+unsigned long OTACore::_lastEventTime = 0;
+QueueHandle_t OTACore::_eventQueue = nullptr;
+TaskHandle_t OTACore::_dispatchTask = nullptr;
 bool OTACore::_persistent = false;
 OTACore::RTCData OTACore::_rtcData = {0};
+OTACore::PersistencePolicy OTACore::_persistPolicy;
+size_t OTACore::_imageSize = 0;
+size_t OTACore::_bytesReceived = 0;
+size_t OTACore::_lastPersistBytes = 0;
+unsigned long OTACore::_lastPersistTime = 0;
+int OTACore::_lastPersistProgress = 0;
+const esp_partition_t* OTACore::_partition = nullptr;
+volatile size_t OTACore::_writeOffset = 0;
+size_t OTACore::_erasedUntil = 0;
+size_t OTACore::_prepareSize = 0;
+TaskHandle_t OTACore::_prepareTask = nullptr;
+TaskHandle_t OTACore::_runningDigestTask = nullptr;
+uint8_t OTACore::_runningDigest[32] = {0};
+volatile bool OTACore::_runningDigestReady = false;
+const esp_partition_t* OTACore::_preparedPartition = nullptr;
+volatile size_t OTACore::_preparedUntil = 0;
+size_t OTACore::_prepareTarget = 0;
+volatile bool OTACore::_preparing = false;
+volatile bool OTACore::_prepareCancel = false;
+const char* OTACore::_prepareError = nullptr;
+unsigned long OTACore::_prepareStart = 0;
+volatile uint32_t OTACore::_imageCRC = 0;
+MD5Builder OTACore::_md5;
+String OTACore::_expectedMD5 = "";
+const char* OTACore::_writeError = nullptr;
+portMUX_TYPE OTACore::_commitLock = portMUX_INITIALIZER_UNLOCKED;
+bool OTACore::_blockMode = false;
+OTACore::Metrics OTACore::_metrics = {};
+unsigned long OTACore::_metricsStart = 0;
+uint32_t OTACore::_lastWriteEnd = 0;
+unsigned long OTACore::_rateWindowStart = 0;
+size_t OTACore::_rateWindowBytes = 0;
+bool OTACore::_resumeAvailable = false;
+size_t OTACore::_bufferSize = 0;
+bool OTACore::_asyncWrite = false;
+uint8_t OTACore::_writeBufferCount = 0;
+uint8_t* OTACore::_writeBuffers[OTACore::MAX_WRITE_BUFFERS] = {nullptr};
+QueueHandle_t OTACore::_freeQueue = nullptr;
+QueueHandle_t OTACore::_fullQueue = nullptr;
+OTAArena::Region OTACore::_bufferRegion;
+OTAArena::Region OTACore::_freeQueueRegion;
+OTAArena::Region OTACore::_fullQueueRegion;
+OTAArena::Region OTACore::_inflatorRegion;
+OTAArena::Region OTACore::_dictionaryRegion;
+TaskHandle_t OTACore::_writerTask = nullptr;
+volatile bool OTACore::_writerFailed = false;
+int OTACore::_fillIndex = -1;
+size_t OTACore::_fillLength = 0;
+bool OTACore::_compressionEnabled = false;
+struct tinfl_decompressor_tag* OTACore::_inflator = nullptr;
+uint8_t* OTACore::_dictionary = nullptr;
+size_t OTACore::_dictOffset = 0;
+OTACore::Encoding OTACore::_encoding = OTACore::Encoding::AUTO;
+bool OTACore::_inflating = false;
+bool OTACore::_inflateDone = false;
+uint8_t OTACore::_gzipState = GZ_FIXED;
+uint8_t OTACore::_gzipFlags = 0;
+uint16_t OTACore::_gzipField = 0;
+uint8_t OTACore::_gzipPos = 0;
+uint8_t OTACore::_gzipTrailer[8] = {0};
+uint8_t OTACore::_gzipTrailerLen = 0;
+uint32_t OTACore::_inflateCRC = 0;
+size_t OTACore::_inflateSize = 0;
+uint8_t OTACore::_patchState = PATCH_OFF;
+uint8_t OTACore::_patchField[OTACore::PATCH_HEADER_SIZE] = {0};
+size_t OTACore::_patchFieldLen = 0;
+uint8_t OTACore::_patchSource[OTACore::PATCH_CHUNK_SIZE] = {0};
+const esp_partition_t* OTACore::_sourcePartition = nullptr;
+size_t OTACore::_sourceSize = 0;
+size_t OTACore::_sourceOffset = 0;
+size_t OTACore::_targetSize = 0;
+size_t OTACore::_patchOutput = 0;
+size_t OTACore::_patchRemaining = 0;
+size_t OTACore::_patchExtra = 0;
+int32_t OTACore::_patchSeek = 0;
+uint8_t OTACore::_targetDigest[32] = {0};
+mbedtls_sha256_context OTACore::_imageHash;
+uint8_t OTACore::_imageDigest[32] = {0};
+bool OTACore::_digestReady = false;
+uint8_t OTACore::_expectedDigest[32] = {0};
+bool OTACore::_hasExpectedDigest = false;
+OTACore::DigestVerifier OTACore::_digestVerifier = nullptr;
 
 // RTC memory allocation for persistence
 RTC_DATA_ATTR OTACore::RTCData rtc_ota_data = {0};
 
+// Block session state; the bitmap is updated in place, so it survives a reset as-is
+RTC_DATA_ATTR OTACore::BlockSession rtc_ota_blocks = {0};
+
 bool OTACore::begin(bool enablePersistence) {
-    _persistent = enablePersistence;
+    Config config;
+    config.enablePersistence = enablePersistence;
+    return begin(config);
+}
+
+bool OTACore::begin(const Config& config) {
+    if (isActive()) {
+        Serial.println("[OTACore] Cannot reinitialize while an update is in progress");
+        return false;
+    }
+
+    _persistent = config.enablePersistence;
+    _persistPolicy = config.persistence;
+    _dispatchPolicy = config.dispatch;
+    _validation = config.validation;
+    _rebootPolicy = config.reboot;
+    _prepareSize = config.prepareSize;
+    OTAArena::reserve(_lastError);
     _status = Status::IDLE;
     _progress = 0;
     _lastError = "";
+    _resumeAvailable = false;
 
     if (_persistent) {
         if (loadFromRTC()) {
             Serial.println("[OTACore] Restored OTA state from RTC memory");
+
+            // An interrupted transfer can be resumed; any other state means
+            // the previous session is over and the core starts idle.
+            if (_status == Status::RECEIVING && _rtcData.writeOffset > 0 && _rtcData.rawStream) {
+                _resumeAvailable = true;
+                Serial.println("[OTACore] Interrupted update can resume at offset " +
+                               String(_rtcData.writeOffset) + "/" + String(_rtcData.imageSize));
+            }
+            _status = Status::IDLE;
+            _progress = 0;
         } else {
             Serial.println("[OTACore] Initializing fresh OTA state");
+            memset(&_rtcData, 0, sizeof(_rtcData));
             _rtcData.magic = RTC_MAGIC;
             _rtcData.otaEnabled = true;
             _rtcData.status = Status::IDLE;
@@ -33,12 +257,26 @@ bool OTACore::begin(bool enablePersistence) {
         }
     }
 
-    // Initialize Update library
-    Update.onProgress([](size_t progress, size_t total) {
-        int percent = (progress * 100) / total;
-        _progress = percent;
-        updateCallback(Status::RECEIVING, percent, "Receiving update...");
-    });
+    releaseBuffers();
+    if (!initBuffers(config)) {
+        Serial.println("[OTACore] Failed to allocate write buffers");
+        return false;
+    }
+
+    releaseInflater();
+    if (config.enableCompression && !initInflater()) {
+        Serial.println("[OTACore] Failed to allocate inflate window");
+        return false;
+    }
+
+    releaseDispatcher();
+    if (config.dispatch.useTask && !initDispatcher(config.dispatch)) {
+        Serial.println("[OTACore] Failed to start event dispatcher");
+        return false;
+    }
+
+    checkPendingVerify();
+    startRunningDigest();
 
     Serial.println("[OTACore] OTA Core initialized successfully");
     return true;
@@ -48,12 +286,21 @@ void OTACore::setCallback(CallbackFunction callback) {
     _callback = callback;
 }
 
-bool OTACore::startUpdate(size_t size, const String& md5) {
+void OTACore::setEventHandler(EventHandler handler) {
+    _eventHandler = handler;
+}
+
+bool OTACore::startUpdate(size_t size, const String& md5, Encoding encoding) {
     if (_status != Status::IDLE) {
         _lastError = "OTA already in progress";
         return false;
     }
 
+    if (encoding == Encoding::GZIP && !_compressionEnabled) {
+        _lastError = "Compressed updates are not enabled";
+        return false;
+    }
+
     if (size == 0) {
         _lastError = "Invalid update size";
         return false;
@@ -66,42 +313,80 @@ bool OTACore::startUpdate(size_t size, const String& md5) {
         return false;
     }
 
-    // Start update
-    bool success = false;
-    if (md5.length() > 0) {
-        // ESP32 Update library doesn't support MD5 directly in begin()
-        // We'll validate MD5 after the update is complete
-        success = Update.begin(size, U_FLASH);
-        if (success) {
-            Update.setMD5(md5.c_str());
-        }
-    } else {
-        success = Update.begin(size, U_FLASH);
+    _encoding = encoding;
+    if (!beginSession(size, 0, md5)) {
+        return false;
     }
 
-    if (!success) {
-        _lastError = "Failed to start update: " + String(Update.errorString());
-        _status = Status::ERROR;
-        updateCallback(_status, 0, _lastError);
+    emitEvent(EventCode::STARTED, "Starting OTA update...");
+    Serial.println("[OTACore] OTA update started, size: " + String(size) +
+                   (_inflating ? " (gzip)" : ""));
+    return true;
+}
+
+bool OTACore::resumeUpdate(size_t size, size_t offset, const String& md5) {
+    if (_status != Status::IDLE) {
+        _lastError = "OTA already in progress";
         return false;
     }
 
-    _status = Status::RECEIVING;
-    _progress = 0;
-    _lastError = "";
-    
-    if (_persistent) {
-        _rtcData.status = _status;
-        _rtcData.progress = _progress;
-        saveToRTC();
+    if (!_resumeAvailable) {
+        _lastError = "No resumable update";
+        return false;
+    }
+
+    const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+    if (size != _rtcData.imageSize || !partition ||
+        partition->address != _rtcData.partitionAddress) {
+        _lastError = "Resume does not match interrupted update";
+        return false;
+    }
+
+    if (offset != _rtcData.writeOffset) {
+        _lastError = "Resume offset mismatch, expected " + String(_rtcData.writeOffset);
+        return false;
+    }
+
+    // Inflater state is not persisted, so only raw sessions are resumable
+    _encoding = Encoding::RAW;
+    if (!beginSession(size, offset, md5)) {
+        return false;
     }
 
-    updateCallback(_status, _progress, "Starting OTA update...");
-    Serial.println("[OTACore] OTA update started, size: " + String(size));
+    emitEvent(EventCode::RESUMED, "Resuming OTA update...");
+    Serial.println("[OTACore] OTA update resumed at offset " + String(offset) + "/" + String(size));
     return true;
 }
 
+OTACore::ResumeInfo OTACore::getResumeInfo() {
+    ResumeInfo info;
+    info.available = _resumeAvailable;
+    info.imageSize = _resumeAvailable ? _rtcData.imageSize : 0;
+    info.offset = _resumeAvailable ? _rtcData.writeOffset : 0;
+    info.imageCRC = _resumeAvailable ? _rtcData.imageCRC : 0;
+    return info;
+}
+
+size_t OTACore::getCommittedOffset() {
+    return _writeOffset;
+}
+
+OTACore::Metrics OTACore::getMetrics() {
+    portENTER_CRITICAL(&_commitLock);
+    Metrics metrics = _metrics;
+    portEXIT_CRITICAL(&_commitLock);
+
+    if (_status == Status::RECEIVING) {
+        metrics.duration = millis() - _metricsStart;
+        metrics.averageRate = metrics.duration > 0
+                              ? (uint64_t)metrics.bytesReceived * 1000 / metrics.duration : 0;
+    }
+    return metrics;
+}
+
 int OTACore::writeData(uint8_t* data, size_t len) {
+    uint32_t enter = micros();
+
     if (_status != Status::RECEIVING) {
         _lastError = "OTA not in receiving state";
         return -1;
@@ -112,21 +397,43 @@ int OTACore::writeData(uint8_t* data, size_t len) {
         return -1;
     }
 
-    size_t written = Update.write(data, len);
-    
-    if (written != len) {
-        _lastError = "Write error: " + String(Update.errorString());
-        _status = Status::ERROR;
-        updateCallback(_status, _progress, _lastError);
+    if (_blockMode) {
+        _lastError = "Block session in progress, use writeBlock()";
         return -1;
     }
 
-    if (_persistent) {
-        _rtcData.progress = _progress;
-        saveToRTC();
+    // Detect a gzip stream from its first byte; raw images start with 0xE9
+    if (_encoding == Encoding::AUTO && _bytesReceived == 0) {
+        if (data[0] == GZIP_ID1) {
+            if (!_compressionEnabled) {
+                failWrite("Compressed image received but compression is not enabled");
+                return -1;
+            }
+            startInflate();
+        }
+        _encoding = _inflating ? Encoding::GZIP : Encoding::RAW;
+    }
+
+    bool queued = _inflating ? inflateData(data, len) : decodeData(data, len);
+    if (!queued) {
+        if (_status == Status::RECEIVING) {
+            failWrite("Write error: " + String(_writeError ? _writeError : "unknown"));
+        }
+        // Reclaim buffers still owned by the writer
+        _writerFailed = true;
+        drainWriter();
+        endDigest();
+        return -1;
     }
 
-    return written;
+    _bytesReceived += len;
+    _progress = (_bytesReceived * 100) / _imageSize;
+    if (_progress > 100) _progress = 100;
+    persistProgress();
+    recordChunk(len, enter);
+    emitProgress();
+
+    return len;
 }
 
 bool OTACore::finishUpdate() {
@@ -135,46 +442,147 @@ bool OTACore::finishUpdate() {
         return false;
     }
 
-    bool success = Update.end(true);
-    
-    if (!success) {
-        _lastError = "Failed to finish update: " + String(Update.errorString());
-        _status = Status::ERROR;
-        updateCallback(_status, _progress, _lastError);
+    if (_blockMode) {
+        return finishBlockUpdate();
+    }
+
+    // Flush the partially filled buffer and wait for pending writes
+    if (!drainWriter()) {
+        endDigest();
+        if (_status == Status::RECEIVING) {
+            failWrite("Write error: " + String(_writeError ? _writeError : "unknown"));
+        }
+        return false;
+    }
+
+    if (_writeOffset == 0) {
+        endDigest();
+        failWrite("Failed to finish update: no data received");
+        return false;
+    }
+
+    // The digest was accumulated as buffers were committed
+    mbedtls_sha256_finish(&_imageHash, _imageDigest);
+    endDigest();
+
+    if (_inflating && !checkGzipTrailer()) {
+        return false;
+    }
+
+    if (isDelta() && !checkPatch()) {
+        return false;
+    }
+
+    if (!checkDigest()) {
         return false;
     }
+    _digestReady = true;
 
+    if (_expectedMD5.length() > 0) {
+        _md5.calculate();
+        if (!_md5.toString().equalsIgnoreCase(_expectedMD5)) {
+            failWrite("Failed to finish update: MD5 mismatch");
+            return false;
+        }
+    }
+
+    // Validates the image header and segments before switching boot slot
+    esp_err_t err = esp_ota_set_boot_partition(_partition);
+    if (err != ESP_OK) {
+        failWrite("Failed to finish update: " + String(esp_err_to_name(err)));
+        return false;
+    }
+    markPendingVerify(_partition);
+    cacheSlotDigest(_partition, _imageDigest);
+
+    endMetrics();
     _status = Status::COMPLETE;
     _progress = 100;
+    _completeTime = millis();
+    _resumeAvailable = false;
     
-    if (_persistent) {
-        _rtcData.status = _status;
-        _rtcData.progress = _progress;
-        saveToRTC();
-    }
+    _rtcData.status = _status;
+    _rtcData.progress = _progress;
+    _rtcData.writeOffset = _writeOffset;
+    _rtcData.imageCRC = _imageCRC;
+    saveToRTC();
 
-    updateCallback(_status, _progress, "OTA update completed successfully");
+    emitEvent(EventCode::COMPLETED, "OTA update completed successfully");
     Serial.println("[OTACore] OTA update completed successfully");
     return true;
 }
 
 void OTACore::abortUpdate() {
     if (_status == Status::RECEIVING) {
-        Update.abort();
+        // Discard anything still buffered or queued before aborting
+        _writerFailed = true;
+        drainWriter();
+        _writerFailed = false;
+        endMetrics();
         Serial.println("[OTACore] OTA update aborted");
     }
     
     _status = Status::IDLE;
     _progress = 0;
     _lastError = "Update aborted";
-    
-    if (_persistent) {
-        _rtcData.status = _status;
-        _rtcData.progress = _progress;
-        saveToRTC();
+    _resumeAvailable = false;
+    _inflating = false;
+    endDigest();
+    _patchState = PATCH_OFF;
+    if (_blockMode) {
+        clearBlockSession();
+        _blockMode = false;
     }
     
-    updateCallback(_status, _progress, _lastError);
+    _rtcData.status = _status;
+    _rtcData.progress = _progress;
+    saveToRTC();
+    
+    emitEvent(EventCode::ABORTED, _lastError.c_str());
+}
+
+void OTACore::suspendUpdate() {
+    if (_status != Status::RECEIVING) {
+        return;
+    }
+
+    // Blocks go straight to flash and the bitmap is already in RTC memory
+    if (_blockMode) {
+        endMetrics();
+        endDigest();
+        _status = Status::IDLE;
+        _lastError = "Block session suspended at " + String(rtc_ota_blocks.received) + "/" +
+                     String(rtc_ota_blocks.blockCount) + " blocks";
+        Serial.println("[OTACore] " + _lastError);
+        emitEvent(EventCode::SUSPENDED, _lastError.c_str());
+        return;
+    }
+
+    // Commit queued full buffers but drop the partial one to keep the offset aligned
+    drainWriter(false);
+
+    portENTER_CRITICAL(&_commitLock);
+    size_t offset = _writeOffset;
+    uint32_t crc = _imageCRC;
+    portEXIT_CRITICAL(&_commitLock);
+
+    endMetrics();
+    _status = Status::IDLE;
+    _progress = (offset * 100) / _imageSize;
+    _resumeAvailable = offset > 0 && !_writerFailed && !_inflating && !isDelta();
+    endDigest();
+    _lastError = "Update suspended at offset " + String(offset);
+
+    // Keep RECEIVING in the record so the session survives a reset
+    _rtcData.status = _resumeAvailable ? Status::RECEIVING : Status::IDLE;
+    _rtcData.progress = _progress;
+    _rtcData.writeOffset = offset;
+    _rtcData.imageCRC = crc;
+    _rtcData.rawStream = _resumeAvailable;
+    saveToRTC();
+
+    Serial.println("[OTACore] " + _lastError);
+    emitEvent(EventCode::SUSPENDED, _lastError.c_str());
 }
 
 OTACore::Status OTACore::getStatus() {
@@ -189,19 +597,65 @@ String OTACore::getLastError() {
     return _lastError;
 }
 
+const char* OTACore::getLastErrorCStr() {
+    return _lastError.c_str();
+}
+
+bool OTACore::setExpectedSHA256(const String& hex) {
+    if (_status != Status::RECEIVING) {
+        _lastError = "OTA not in receiving state";
+        return false;
+    }
+
+    if (!parseHexDigest(hex, _expectedDigest)) {
+        _lastError = "Invalid SHA-256 digest";
+        return false;
+    }
+
+    _hasExpectedDigest = true;
+    return true;
+}
+
+void OTACore::setDigestVerifier(DigestVerifier verifier) {
+    _digestVerifier = verifier;
+}
+
+String OTACore::getSHA256() {
+    if (!_digestReady) {
+        return "";
+    }
+
+    char hex[65];
+    OTAUtil::formatHex(_imageDigest, sizeof(_imageDigest), hex);
+    return String(hex);
+}
+
 bool OTACore::isActive() {
     return _status == Status::RECEIVING;
 }
 
 void OTACore::handle() {
     // Handle any background OTA tasks
-    if (_status == Status::COMPLETE) {
-        // Auto-restart after successful update
-        delay(1000);
+    if (_prepareStart != 0 && !_preparing) {
+        if (_prepareError) {
+            Serial.println("[OTACore] Pre-erase failed: " + String(_prepareError));
+        } else if (_preparedPartition) {
+            Serial.println("[OTACore] Pre-erased " + String(_preparedUntil) + " bytes of " +
+                           String(_preparedPartition->label) + " in " +
+                           String(millis() - _prepareStart) + " ms");
+        }
+        _prepareStart = 0;
+    }
+
+    // Restart into a completed update as the reboot policy allows, without blocking
+    if (rebootDue()) {
         _status = Status::REBOOTING;
-        updateCallback(_status, 100, "Rebooting...");
+        emitEvent(EventCode::REBOOTING, "Rebooting...");
+        flushEvents();
         restart();
     }
+
+    serviceValidation();
 }
 
 void OTACore::setPersistence(bool enable) {
@@ -211,10 +665,44 @@ void OTACore::setPersistence(bool enable) {
     }
 }
 
+void OTACore::setPersistence(bool enable, const PersistencePolicy& policy) {
+    _persistPolicy = policy;
+    setPersistence(enable);
+}
+
+OTACore::PersistencePolicy OTACore::getPersistencePolicy() {
+    return _persistPolicy;
+}
+
 bool OTACore::isPersistent() {
     return _persistent;
 }
 
+bool OTACore::isAsyncWrite() {
+    return _asyncWrite;
+}
+
+size_t OTACore::getBufferSize() {
+    return _bufferSize;
+}
+
+size_t OTACore::getWriteCapacity() {
+    if (!_asyncWrite || !_freeQueue) {
+        return _bufferSize;
+    }
+
+    size_t capacity = _fillIndex >= 0 ? _bufferSize - _fillLength : 0;
+    return capacity + uxQueueMessagesWaiting(_freeQueue) * _bufferSize;
+}
+
+bool OTACore::isCompressed() {
+    return _inflating;
+}
+
+bool OTACore::isDelta() {
+    return _patchState >= PATCH_HEADER;
+}
+
 size_t OTACore::getAvailableSize() {
     const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
     if (partition) {
@@ -223,46 +711,1820 @@ size_t OTACore::getAvailableSize() {
     return 0;
 }
 
-void OTACore::restart() {
-    Serial.println("[OTACore] Restarting ESP32...");
-    Serial.flush();
-    ESP.restart();
+uint8_t OTACore::getSlots(SlotInfo* slots, uint8_t maxSlots, bool withDigest) {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* boot = esp_ota_get_boot_partition();
+    uint8_t count = 0;
+
+    esp_partition_iterator_t it = esp_partition_find(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, NULL);
+    for (; it && count < maxSlots; it = esp_partition_next(it)) {
+        const esp_partition_t* partition = esp_partition_get(it);
+        SlotInfo& slot = slots[count++];
+        memset(&slot, 0, sizeof(slot));
+        strlcpy(slot.label, partition->label, sizeof(slot.label));
+        slot.address = partition->address;
+        slot.size = partition->size;
+        slot.running = running && running->address == partition->address;
+        slot.boot = boot && boot->address == partition->address;
+        if (esp_ota_get_state_partition(partition, &slot.state) != ESP_OK) {
+            slot.state = ESP_OTA_IMG_UNDEFINED;
+        }
+
+        esp_partition_pos_t position = {partition->address, partition->size};
+        esp_image_metadata_t metadata;
+        if (esp_image_verify(ESP_IMAGE_VERIFY_SILENT, &position, &metadata) != ESP_OK) {
+            continue;
+        }
+        slot.valid = true;
+        slot.imageSize = metadata.image_len;
+
+        esp_app_desc_t description;
+        if (esp_ota_get_partition_description(partition, &description) == ESP_OK) {
+            strlcpy(slot.version, description.version, sizeof(slot.version));
+            strlcpy(slot.project, description.project_name, sizeof(slot.project));
+        }
+        if (withDigest) {
+            slotDigest(partition, slot.sha256);
+        }
+    }
+    esp_partition_iterator_release(it);
+    return count;
 }
 
-void OTACore::saveToRTC() {
-    if (!_persistent) return;
-    
-    _rtcData.crc = calculateCRC();
-    rtc_ota_data = _rtcData;
+void OTACore::setHealthCheck(HealthCheck check) {
+    _healthCheck = check;
 }
 
-bool OTACore::loadFromRTC() {
-    if (!_persistent) return false;
-    
-    _rtcData = rtc_ota_data;
-    
-    // Validate magic number and CRC
-    if (_rtcData.magic != RTC_MAGIC) {
+bool OTACore::isPendingVerify() {
+    return _pendingVerify;
+}
+
+void OTACore::markValid() {
+    esp_ota_mark_app_valid_cancel_rollback();
+    // A staged image waiting for its reboot keeps its pending mark
+    if (!_pendingVerify) {
+        return;
+    }
+
+    clearPendingVerify();
+    _pendingVerify = false;
+    Serial.println("[OTACore] Running image validated");
+    emitEvent(EventCode::VALIDATED, "Firmware image validated");
+
+    if (_prepareSize > 0) {
+        prepareUpdate(_prepareSize);
+    }
+}
+
+bool OTACore::prepareUpdate(size_t size) {
+    if (_status == Status::RECEIVING || _status == Status::COMPLETE || _resumeAvailable) {
+        _lastError = "Cannot prepare while an update is in progress or resumable";
         return false;
     }
-    
-    uint32_t storedCRC = _rtcData.crc;
-    uint32_t calculatedCRC = calculateCRC();
-    
-    if (storedCRC != calculatedCRC) {
+    if (_pendingVerify) {
+        _lastError = "Cannot prepare before the running image is validated";
         return false;
     }
-    
-    // Restore state
-    _status = _rtcData.status;
-    _progress = _rtcData.progress;
-    
+
+    const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+    if (!partition) {
+        _lastError = "No OTA partition to prepare";
+        return false;
+    }
+
+    // Erasing would discard the blocks of an unfinished multicast session
+    BlockSession& blocks = rtc_ota_blocks;
+    if (blocks.magic == BLOCK_MAGIC && blocks.partitionAddress == partition->address) {
+        _lastError = "Cannot prepare while a block session is resumable";
+        return false;
+    }
+
+    if (size == 0 || size > partition->size) {
+        size = partition->size;
+    }
+    size_t target = ((size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
+
+    stopPrepare();
+    if (_preparedPartition != partition) {
+        _preparedPartition = partition;
+        _preparedUntil = 0;
+    }
+    if (_preparedUntil >= target) {
+        return true;
+    }
+
+    clearSlotDigest(partition);
+    _prepareTarget = target;
+    _prepareError = nullptr;
+    _prepareStart = millis();
+    _preparing = true;
+    if (!OTAUtil::startTask(prepareTask, "ota_prepare", PREPARE_STACK_SIZE, tskIDLE_PRIORITY, &_prepareTask)) {
+        _preparing = false;
+        _prepareStart = 0;
+        _lastError = "Failed to start pre-erase task";
+        return false;
+    }
+
+    Serial.println("[OTACore] Pre-erasing " + String(target) + " bytes of " + String(partition->label));
     return true;
 }
 
-void OTACore::updateCallback(Status status, int progress, const String& message) {
-    if (_callback) {
-        _callback(status, progress, message);
+OTACore::PrepareInfo OTACore::getPrepareInfo() {
+    PrepareInfo info;
+    info.running = _preparing;
+    info.erased = _preparedPartition ? _preparedUntil : 0;
+    info.target = _preparedPartition ? _prepareTarget : 0;
+    info.error = _prepareError;
+    return info;
+}
+
+void OTACore::prepareTask(void* param) {
+    // Idle priority; the flash driver yields between sectors within a step
+    while (!_prepareCancel && _preparedUntil < _prepareTarget) {
+        size_t len = _prepareTarget - _preparedUntil;
+        if (len > PREPARE_STEP) {
+            len = PREPARE_STEP;
+        }
+        esp_err_t err = esp_partition_erase_range(_preparedPartition, _preparedUntil, len);
+        if (err != ESP_OK) {
+            _prepareError = esp_err_to_name(err);
+            break;
+        }
+        _preparedUntil += len;
+        vTaskDelay(1);
+    }
+
+    _prepareTask = nullptr;
+    _preparing = false;
+    vTaskDelete(NULL);
+}
+
+void OTACore::startRunningDigest() {
+    if (_runningDigestReady || _runningDigestTask) {
+        return;
+    }
+
+    // Delta patches are checked against this digest instead of hashing the
+    // running image on the upload path
+    if (!OTAUtil::startTask(runningDigestTask, "ota_digest", RUNNING_DIGEST_STACK_SIZE, tskIDLE_PRIORITY,
+                            &_runningDigestTask)) {
+        Serial.println("[OTACore] Failed to start running image digest task");
+    }
+}
+
+void OTACore::runningDigestTask(void* param) {
+    // Idle priority; a cache hit in NVS makes this a single lookup
+    _runningDigestReady = slotDigest(esp_ota_get_running_partition(), _runningDigest);
+    if (!_runningDigestReady) {
+        Serial.println("[OTACore] Cannot compute running image digest, delta updates disabled");
+    }
+
+    _runningDigestTask = nullptr;
+    vTaskDelete(NULL);
+}
+
+void OTACore::stopPrepare() {
+    if (!_preparing) {
+        return;
+    }
+
+    // Waits for at most one erase step
+    _prepareCancel = true;
+    while (_preparing) {
+        vTaskDelay(1);
+    }
+    _prepareCancel = false;
+}
+
+size_t OTACore::takePrepared(const esp_partition_t* partition) {
+    stopPrepare();
+    size_t prepared = _preparedPartition == partition ? _preparedUntil : 0;
+    _preparedPartition = nullptr;
+    _preparedUntil = 0;
+    return prepared;
+}
+
+bool OTACore::canRollback() {
+    return _status != Status::RECEIVING && _status != Status::COMPLETE && rollbackTarget() != nullptr;
+}
+
+bool OTACore::rollback(bool reboot) {
+    if (_status == Status::RECEIVING || _status == Status::COMPLETE) {
+        _lastError = "Cannot roll back while an update is in progress";
+        return false;
+    }
+
+    const esp_partition_t* target = rollbackTarget();
+    if (!target) {
+        _lastError = "No previous image to roll back to";
+        return false;
+    }
+
+    // Verifies the image in place before switching
+    esp_err_t err = esp_ota_set_boot_partition(target);
+    if (err != ESP_OK) {
+        _lastError = "Rollback failed: " + String(esp_err_to_name(err));
+        return false;
+    }
+
+    clearPendingVerify();
+    _pendingVerify = false;
+    _resumeAvailable = false;
+    Serial.println("[OTACore] Boot partition switched back to " + String(target->label));
+    emitEvent(EventCode::ROLLED_BACK, "Rolled back to previous image");
+
+    if (reboot) {
+        _status = Status::REBOOTING;
+        emitEvent(EventCode::REBOOTING, "Rebooting...");
+        flushEvents();
+        restart();
+    }
+    return true;
+}
+
+OTACore::Installed OTACore::skipIfInstalled(const String& sha256) {
+    uint8_t digest[32];
+    if (_status == Status::RECEIVING || _status == Status::COMPLETE || !parseHexDigest(sha256, digest)) {
+        return Installed::NONE;
+    }
+
+    uint8_t installed[32];
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (slotDigest(running, installed) && memcmp(installed, digest, sizeof(digest)) == 0) {
+        Serial.println("[OTACore] Image is already running, update skipped");
+        return Installed::RUNNING;
+    }
+
+    const esp_partition_t* inactive = esp_ota_get_next_update_partition(NULL);
+    if (!inactive || !slotDigest(inactive, installed) || memcmp(installed, digest, sizeof(digest)) != 0) {
+        return Installed::NONE;
+    }
+
+    // Verifies the image in place before switching
+    if (esp_ota_set_boot_partition(inactive) != ESP_OK) {
+        return Installed::NONE;
+    }
+    markPendingVerify(inactive);
+
+    memcpy(_imageDigest, digest, sizeof(digest));
+    _digestReady = true;
+    _status = Status::COMPLETE;
+    _progress = 100;
+    _completeTime = millis();
+    _resumeAvailable = false;
+
+    _rtcData.status = _status;
+    _rtcData.progress = _progress;
+    saveToRTC();
+
+    Serial.println("[OTACore] Image already in " + String(inactive->label) + ", boot partition switched");
+    emitEvent(EventCode::COMPLETED, "Installed image selected for boot");
+    return Installed::INACTIVE;
+}
+
+bool OTACore::slotDigest(const esp_partition_t* partition, uint8_t digest[32]) {
+    esp_app_desc_t description;
+    if (!partition || esp_ota_get_partition_description(partition, &description) != ESP_OK) {
+        return false;
+    }
+
+    // Entry: ELF SHA-256 of the image it was computed for, then the image digest
+    char key[16];
+    snprintf(key, sizeof(key), "%s%.11s", PREFS_DIGEST, partition->label);
+    uint8_t entry[64];
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, true)) {
+        size_t length = prefs.getBytes(key, entry, sizeof(entry));
+        prefs.end();
+        if (length == sizeof(entry) && memcmp(entry, description.app_elf_sha256, 32) == 0) {
+            memcpy(digest, entry + 32, 32);
+            return true;
+        }
+    }
+
+    esp_partition_pos_t position = {partition->address, partition->size};
+    esp_image_metadata_t metadata;
+    if (esp_image_verify(ESP_IMAGE_VERIFY_SILENT, &position, &metadata) != ESP_OK ||
+        !hashPartition(partition, metadata.image_len, digest)) {
+        return false;
+    }
+
+    cacheSlotDigest(partition, digest);
+    return true;
+}
+
+void OTACore::cacheSlotDigest(const esp_partition_t* partition, const uint8_t digest[32]) {
+    esp_app_desc_t description;
+    if (esp_ota_get_partition_description(partition, &description) != ESP_OK) {
+        return;
+    }
+
+    char key[16];
+    snprintf(key, sizeof(key), "%s%.11s", PREFS_DIGEST, partition->label);
+    uint8_t entry[64];
+    memcpy(entry, description.app_elf_sha256, 32);
+    memcpy(entry + 32, digest, 32);
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, false)) {
+        prefs.putBytes(key, entry, sizeof(entry));
+        prefs.end();
+    }
+}
+
+void OTACore::clearSlotDigest(const esp_partition_t* partition) {
+    char key[16];
+    snprintf(key, sizeof(key), "%s%.11s", PREFS_DIGEST, partition->label);
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, false)) {
+        if (prefs.isKey(key)) {
+            prefs.remove(key);
+        }
+        prefs.end();
+    }
+}
+
+const esp_partition_t* OTACore::rollbackTarget() {
+    // The slot the current image was installed from, otherwise the other OTA slot
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* target = nullptr;
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, true)) {
+        String from = prefs.getString(PREFS_FROM, "");
+        prefs.end();
+        if (from.length() > 0 && from != running->label) {
+            target = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, from.c_str());
+        }
+    }
+    if (!target) {
+        target = esp_ota_get_next_update_partition(NULL);
+    }
+
+    esp_app_desc_t description;
+    if (!target || esp_ota_get_partition_description(target, &description) != ESP_OK) {
+        return nullptr;
+    }
+
+    esp_ota_img_states_t state;
+    if (esp_ota_get_state_partition(target, &state) == ESP_OK &&
+        (state == ESP_OTA_IMG_INVALID || state == ESP_OTA_IMG_ABORTED)) {
+        return nullptr;
+    }
+    return target;
+}
+
+void OTACore::markPendingVerify(const esp_partition_t* target) {
+    // The new image has to prove itself; remember where it goes and where it came from
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, false)) {
+        prefs.putBool(PREFS_PENDING, true);
+        prefs.putString(PREFS_TARGET, target->label);
+        prefs.putString(PREFS_FROM, esp_ota_get_running_partition()->label);
+        prefs.putUChar(PREFS_BOOTS, 0);
+        prefs.end();
+    }
+}
+
+void OTACore::clearPendingVerify() {
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, false)) {
+        prefs.remove(PREFS_PENDING);
+        prefs.remove(PREFS_BOOTS);
+        prefs.end();
+    }
+}
+
+void OTACore::checkPendingVerify() {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    bool bootloaderPending = esp_ota_get_state_partition(running, &state) == ESP_OK &&
+                             state == ESP_OTA_IMG_PENDING_VERIFY;
+
+    _pendingVerify = false;
+    _healthChecked = false;
+    _verifyStart = millis();
+
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        _pendingVerify = bootloaderPending;
+        return;
+    }
+
+    bool pending = prefs.getBool(PREFS_PENDING, false);
+    String target = prefs.getString(PREFS_TARGET, "");
+    if (pending && target != running->label) {
+        // Still on the old image: either the new one is staged and waiting
+        // for its reboot, or it was booted and the bootloader went back
+        const esp_partition_t* boot = esp_ota_get_boot_partition();
+        esp_ota_img_states_t targetState;
+        const esp_partition_t* staged = esp_partition_find_first(ESP_PARTITION_TYPE_APP,
+                                                                 ESP_PARTITION_SUBTYPE_ANY, target.c_str());
+        bool failed = !staged || !boot || boot->address != staged->address ||
+                      (esp_ota_get_state_partition(staged, &targetState) == ESP_OK &&
+                       (targetState == ESP_OTA_IMG_INVALID || targetState == ESP_OTA_IMG_ABORTED));
+        if (failed) {
+            Serial.println("[OTACore] New image did not start, running the previous image");
+            prefs.remove(PREFS_PENDING);
+            prefs.remove(PREFS_BOOTS);
+        }
+        // The running image is not the one on trial either way
+        pending = false;
+    }
+
+    if (!pending && !bootloaderPending) {
+        prefs.end();
+        return;
+    }
+
+    // begin() may run more than once per boot; count the boot only once
+    uint8_t boots = prefs.getUChar(PREFS_BOOTS, 0);
+    if (!_bootCounted) {
+        boots++;
+        _bootCounted = true;
+        prefs.putBool(PREFS_PENDING, true);
+        prefs.putUChar(PREFS_BOOTS, boots);
+    }
+    prefs.end();
+
+    _pendingVerify = true;
+    Serial.printf("[OTACore] Image pending verification (boot %u)\n", boots);
+
+    if (_validation.maxBootAttempts > 0 && boots > _validation.maxBootAttempts) {
+        Serial.println("[OTACore] Image reset before it was validated, rolling back");
+        if (!rollback(true)) {
+            Serial.println("[OTACore] " + _lastError);
+        }
+    }
+}
+
+void OTACore::serviceValidation() {
+    if (!_pendingVerify) {
+        return;
+    }
+
+    unsigned long uptime = millis() - _verifyStart;
+    if (uptime < _validation.healthCheckDelay) {
+        return;
+    }
+
+    if (!_healthCheck) {
+        markValid();
+        return;
+    }
+
+    if (!_healthChecked || millis() - _lastHealthCheck >= _validation.checkInterval) {
+        _healthChecked = true;
+        _lastHealthCheck = millis();
+        if (_healthCheck()) {
+            markValid();
+            return;
+        }
+    }
+
+    if (_validation.validationTimeout > 0 && uptime >= _validation.validationTimeout) {
+        Serial.println("[OTACore] Health check did not pass, rolling back");
+        if (!rollback(true)) {
+            // Nothing to go back to; keep the image rather than retrying forever
+            Serial.println("[OTACore] " + _lastError);
+            markValid();
+        }
+    }
+}
+
+void OTACore::setRebootPolicy(const RebootPolicy& policy) {
+    _rebootPolicy = policy;
+}
+
+void OTACore::setIdleCheck(IdleCheck check) {
+    _idleCheck = check;
+}
+
+void OTACore::setRebootHook(RebootHook hook) {
+    _rebootHook = hook;
+}
+
+void OTACore::scheduleReboot(unsigned long delayMs) {
+    _rebootScheduled = true;
+    _rebootRequestTime = millis();
+    _rebootDelay = delayMs;
+    Serial.println("[OTACore] Reboot scheduled in " + String(delayMs) + " ms");
+}
+
+bool OTACore::isRebootPending() {
+    return _rebootScheduled || _status == Status::COMPLETE;
+}
+
+bool OTACore::rebootDue() {
+    if (_status == Status::RECEIVING || _status == Status::REBOOTING) {
+        return false;
+    }
+    if (_rebootScheduled && millis() - _rebootRequestTime >= _rebootDelay) {
+        return true;
+    }
+    if (_status != Status::COMPLETE) {
+        return false;
+    }
+
+    unsigned long waited = millis() - _completeTime;
+    if (_rebootPolicy.maxDefer > 0 && waited >= _rebootPolicy.maxDefer) {
+        return true;
+    }
+
+    switch (_rebootPolicy.mode) {
+        case RebootMode::IMMEDIATE:
+            return true;
+        case RebootMode::DELAYED:
+            return waited >= _rebootPolicy.delay;
+        case RebootMode::WINDOW:
+            return inRebootWindow();
+        case RebootMode::IDLE:
+            return !_idleCheck || _idleCheck();
+        case RebootMode::MANUAL:
+        default:
+            return false;
+    }
+}
+
+bool OTACore::inRebootWindow() {
+    time_t now = time(nullptr);
+    if (now < MIN_VALID_TIME) {
+        return false;
+    }
+
+    struct tm local;
+    localtime_r(&now, &local);
+    uint8_t start = _rebootPolicy.windowStart;
+    uint8_t end = _rebootPolicy.windowEnd;
+    if (start == end) {
+        return true;
+    }
+    if (start < end) {
+        return local.tm_hour >= start && local.tm_hour < end;
+    }
+    return local.tm_hour >= start || local.tm_hour < end;
+}
+
+void OTACore::restart() {
+    if (_rebootHook) {
+        _rebootHook();
+    }
+    Serial.println("[OTACore] Restarting ESP32...");
+    Serial.flush();
+    ESP.restart();
+}
+
+bool OTACore::initBuffers(const Config& config) {
+    // Round the buffer up to whole flash sectors so flushes never split a sector
+    size_t size = config.bufferSize;
+    if (size < FLASH_SECTOR_SIZE) size = FLASH_SECTOR_SIZE;
+    if (size > MAX_BUFFER_SIZE) size = MAX_BUFFER_SIZE;
+    size = ((size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
+
+    uint8_t count = 1;
+    if (config.asyncWrite) {
+        count = config.writeBufferCount;
+        if (count < 2) count = 2;
+        if (count > MAX_WRITE_BUFFERS) count = MAX_WRITE_BUFFERS;
+    }
+
+#if OTA_STATIC_MEMORY
+    // One slice for all buffers; a later begin() asking for more than the first fails
+    uint8_t* arena = (uint8_t*)OTAArena::claim(_bufferRegion,
+                                               (size_t)(config.asyncWrite ? count : 1) * size);
+    if (!arena) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        _writeBuffers[i] = arena + (size_t)i * size;
+    }
+#else
+    for (uint8_t i = 0; i < count; i++) {
+        _writeBuffers[i] = (uint8_t*)heap_caps_aligned_alloc(4, size,
+                                                             MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (!_writeBuffers[i]) {
+            releaseBuffers();
+            return false;
+        }
+    }
+#endif
+    _writeBufferCount = count;
+    _bufferSize = size;
+    _fillIndex = -1;
+    _fillLength = 0;
+
+    if (!config.asyncWrite) {
+        Serial.println("[OTACore] Write buffer: " + String(size) + " bytes");
+        return true;
+    }
+
+    _freeQueue = createQueue(_freeQueueRegion, count, sizeof(uint8_t));
+    _fullQueue = createQueue(_fullQueueRegion, count, sizeof(WriteJob));
+    if (!_freeQueue || !_fullQueue) {
+        releaseBuffers();
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        xQueueSend(_freeQueue, &i, 0);
+    }
+
+    if (!OTAUtil::startTask(writerTask, "ota_writer", config.writerStackSize, config.writerPriority,
+                            &_writerTask, config.writerCore)) {
+        releaseBuffers();
+        return false;
+    }
+
+    _asyncWrite = true;
+    Serial.println("[OTACore] Async flash writer started with " + String(count) + " x " +
+                   String(size) + " byte buffers");
+    return true;
+}
+
+void OTACore::releaseBuffers() {
+    if (_writerTask) {
+        vTaskDelete(_writerTask);
+        _writerTask = nullptr;
+    }
+    if (_freeQueue) {
+        vQueueDelete(_freeQueue);
+        _freeQueue = nullptr;
+    }
+    if (_fullQueue) {
+        vQueueDelete(_fullQueue);
+        _fullQueue = nullptr;
+    }
+    for (uint8_t i = 0; i < MAX_WRITE_BUFFERS; i++) {
+#if !OTA_STATIC_MEMORY
+        if (_writeBuffers[i]) {
+            heap_caps_free(_writeBuffers[i]);
+        }
+#endif
+        _writeBuffers[i] = nullptr;
+    }
+    _writeBufferCount = 0;
+    _bufferSize = 0;
+    _asyncWrite = false;
+    _fillIndex = -1;
+    _fillLength = 0;
+}
+
+QueueHandle_t OTACore::createQueue(OTAArena::Region& region, UBaseType_t length, UBaseType_t itemSize) {
+#if OTA_STATIC_MEMORY
+    // Room for the longest queue, so every begin() reuses the same slice
+    size_t storage = (size_t)MAX_WRITE_BUFFERS * itemSize;
+    uint8_t* memory = (uint8_t*)OTAArena::claim(region, sizeof(StaticQueue_t) + storage, 8);
+    if (!memory) {
+        return nullptr;
+    }
+    return xQueueCreateStatic(length, itemSize, memory + sizeof(StaticQueue_t), (StaticQueue_t*)memory);
+#else
+    (void)region;
+    return xQueueCreate(length, itemSize);
+#endif
+}
+
+void OTACore::writerTask(void* param) {
+    WriteJob job;
+    for (;;) {
+        if (xQueueReceive(_fullQueue, &job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        if (!_writerFailed) {
+            commitBuffer(_writeBuffers[job.index], job.length);
+        }
+
+        xQueueSend(_freeQueue, &job.index, portMAX_DELAY);
+    }
+}
+
+bool OTACore::commitBuffer(uint8_t* buffer, size_t len) {
+    size_t offset = _writeOffset;
+    size_t end = offset + len;
+
+    if (offset == 0 && buffer[0] != ESP_IMAGE_HEADER_MAGIC) {
+        _writeError = "Invalid firmware image";
+        _writerFailed = true;
+        return false;
+    }
+
+    if (end > _partition->size) {
+        _writeError = "Image exceeds partition size";
+        _writerFailed = true;
+        return false;
+    }
+
+    // Erase whole sectors just ahead of the write cursor
+    uint32_t start = micros();
+    uint32_t eraseTime = 0;
+    if (end > _erasedUntil) {
+        size_t eraseEnd = ((end + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
+        esp_err_t err = esp_partition_erase_range(_partition, _erasedUntil, eraseEnd - _erasedUntil);
+        if (err != ESP_OK) {
+            _writeError = esp_err_to_name(err);
+            _writerFailed = true;
+            return false;
+        }
+        _erasedUntil = eraseEnd;
+        eraseTime = micros() - start;
+    }
+
+    esp_err_t err = esp_partition_write(_partition, offset, buffer, len);
+    uint32_t commitTime = micros() - start;
+    if (err != ESP_OK) {
+        _writeError = esp_err_to_name(err);
+        _writerFailed = true;
+        return false;
+    }
+
+    // Hashed on the SHA engine while the next buffer is being received
+    mbedtls_sha256_update(&_imageHash, buffer, len);
+    if (_expectedMD5.length() > 0) {
+        _md5.add(buffer, len);
+    }
+    uint32_t crc = esp_rom_crc32_le(_imageCRC, buffer, len);
+
+    portENTER_CRITICAL(&_commitLock);
+    _imageCRC = crc;
+    _writeOffset = end;
+    _metrics.bytesWritten += len;
+    _metrics.writeCount++;
+    _metrics.eraseTimeUs += eraseTime;
+    _metrics.writeTimeUs += commitTime - eraseTime;
+    if (commitTime > _metrics.maxWriteUs) {
+        _metrics.maxWriteUs = commitTime;
+    }
+    _metrics.writeHistogram[bucketIndex(commitTime, WRITE_LATENCY_BOUNDS_US)]++;
+    portEXIT_CRITICAL(&_commitLock);
+    return true;
+}
+
+bool OTACore::beginSession(size_t size, size_t offset, const String& md5) {
+    _partition = esp_ota_get_next_update_partition(NULL);
+    if (!_partition) {
+        _lastError = "Failed to start update: no OTA partition";
+        _status = Status::ERROR;
+        _progress = 0;
+        emitEvent(EventCode::FAILED, _lastError.c_str());
+        return false;
+    }
+
+    // The slot is about to change; its cached digest no longer applies
+    clearSlotDigest(_partition);
+    size_t prepared = takePrepared(_partition);
+
+    _expectedMD5 = md5;
+    _md5 = MD5Builder();
+    _md5.begin();
+    endDigest();
+    mbedtls_sha256_init(&_imageHash);
+    mbedtls_sha256_starts(&_imageHash, 0);
+    _digestReady = false;
+    _hasExpectedDigest = false;
+    _writeError = nullptr;
+    _writerFailed = false;
+    _fillIndex = -1;
+    _fillLength = 0;
+    _inflating = false;
+    if (_encoding == Encoding::GZIP) {
+        startInflate();
+    }
+    _patchState = offset == 0 ? PATCH_DETECT : PATCH_OFF;
+    _blockMode = false;
+
+    startMetrics();
+
+    if (offset > 0 && !verifyCommitted(offset, _rtcData.imageCRC)) {
+        _resumeAvailable = false;
+        _lastError = "Resume verification failed, restart the update";
+        _rtcData.status = Status::IDLE;
+        saveToRTC();
+        return false;
+    }
+
+    // Only sectors up to the committed offset hold session data
+    _writeOffset = offset;
+    _erasedUntil = ((offset + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
+    if (offset == 0) {
+        _imageCRC = 0;
+        // Sectors erased ahead by prepareUpdate() only need programming
+        _erasedUntil = prepared;
+    }
+
+    _status = Status::RECEIVING;
+    _imageSize = size;
+    _bytesReceived = offset;
+    _progress = (offset * 100) / size;
+    _lastError = "";
+    _resumeAvailable = false;
+
+    _rtcData.status = _status;
+    _rtcData.progress = _progress;
+    _rtcData.imageSize = size;
+    _rtcData.writeOffset = offset;
+    _rtcData.partitionAddress = _partition->address;
+    _rtcData.imageCRC = _imageCRC;
+    // Set once the first bytes show the stream is a plain image
+    _rtcData.rawStream = false;
+    saveToRTC();
+    return true;
+}
+
+bool OTACore::verifyCommitted(size_t offset, uint32_t expectedCRC) {
+    uint8_t chunk[512];
+    uint32_t crc = 0;
+
+    for (size_t pos = 0; pos < offset; pos += sizeof(chunk)) {
+        size_t len = offset - pos < sizeof(chunk) ? offset - pos : sizeof(chunk);
+        if (esp_partition_read(_partition, pos, chunk, len) != ESP_OK) {
+            return false;
+        }
+        crc = esp_rom_crc32_le(crc, chunk, len);
+        mbedtls_sha256_update(&_imageHash, chunk, len);
+        if (_expectedMD5.length() > 0) {
+            _md5.add(chunk, len);
+        }
+    }
+
+    if (crc != expectedCRC) {
+        return false;
+    }
+
+    _imageCRC = crc;
+    return true;
+}
+
+bool OTACore::initInflater() {
+#if OTA_STATIC_MEMORY
+    _inflator = (tinfl_decompressor*)OTAArena::claim(_inflatorRegion, sizeof(tinfl_decompressor));
+    _dictionary = (uint8_t*)OTAArena::claim(_dictionaryRegion, INFLATE_DICT_SIZE);
+#else
+    _inflator = (tinfl_decompressor*)heap_caps_malloc(sizeof(tinfl_decompressor),
+                                                      MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    _dictionary = (uint8_t*)heap_caps_malloc(INFLATE_DICT_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#endif
+    if (!_inflator || !_dictionary) {
+        releaseInflater();
+        return false;
+    }
+
+    _compressionEnabled = true;
+    Serial.println("[OTACore] Inflater ready, window: " + String(INFLATE_DICT_SIZE) + " bytes");
+    return true;
+}
+
+void OTACore::releaseInflater() {
+#if !OTA_STATIC_MEMORY
+    if (_inflator) {
+        heap_caps_free(_inflator);
+    }
+    if (_dictionary) {
+        heap_caps_free(_dictionary);
+    }
+#endif
+    _inflator = nullptr;
+    _dictionary = nullptr;
+    _compressionEnabled = false;
+    _inflating = false;
+}
+
+void OTACore::startInflate() {
+    tinfl_init(_inflator);
+    _dictOffset = 0;
+    _inflating = true;
+    _inflateDone = false;
+    _gzipState = GZ_FIXED;
+    _gzipFlags = 0;
+    _gzipField = 0;
+    _gzipPos = 0;
+    _gzipTrailerLen = 0;
+    _inflateCRC = 0;
+    _inflateSize = 0;
+}
+
+bool OTACore::inflateData(const uint8_t* data, size_t len) {
+    if (_gzipState != GZ_DONE && !parseGzipHeader(data, len)) {
+        _writerFailed = true;
+        return false;
+    }
+
+    while (len > 0 && !_inflateDone) {
+        // The dictionary doubles as the output buffer and wraps at its end
+        size_t inBytes = len;
+        size_t outBytes = INFLATE_DICT_SIZE - _dictOffset;
+        tinfl_status status = tinfl_decompress(_inflator, data, &inBytes, _dictionary,
+                                               _dictionary + _dictOffset, &outBytes,
+                                               TINFL_FLAG_HAS_MORE_INPUT);
+        data += inBytes;
+        len -= inBytes;
+
+        if (outBytes > 0) {
+            _inflateCRC = esp_rom_crc32_le(_inflateCRC, _dictionary + _dictOffset, outBytes);
+            _inflateSize += outBytes;
+            if (!decodeData(_dictionary + _dictOffset, outBytes)) {
+                return false;
+            }
+            _dictOffset = (_dictOffset + outBytes) & (INFLATE_DICT_SIZE - 1);
+        }
+
+        if (status == TINFL_STATUS_DONE) {
+            _inflateDone = true;
+            recoverTrailer();
+        } else if (status < TINFL_STATUS_DONE) {
+            _writeError = "Corrupt compressed image";
+            _writerFailed = true;
+            return false;
+        }
+    }
+
+    // Whatever follows the deflate stream is the CRC32/ISIZE trailer
+    while (len > 0 && _gzipTrailerLen < sizeof(_gzipTrailer)) {
+        _gzipTrailer[_gzipTrailerLen++] = *data++;
+        len--;
+    }
+
+    return !_writerFailed;
+}
+
+bool OTACore::parseGzipHeader(const uint8_t*& data, size_t& len) {
+    while (len > 0 && _gzipState != GZ_DONE) {
+        uint8_t byte = *data++;
+        len--;
+
+        switch (_gzipState) {
+            case GZ_FIXED:
+                if ((_gzipPos == 0 && byte != GZIP_ID1) || (_gzipPos == 1 && byte != GZIP_ID2)) {
+                    _writeError = "Invalid gzip header";
+                    return false;
+                }
+                if (_gzipPos == 2 && byte != GZIP_CM_DEFLATE) {
+                    _writeError = "Unsupported gzip compression method";
+                    return false;
+                }
+                if (_gzipPos == 3) {
+                    _gzipFlags = byte;
+                }
+                if (++_gzipPos == GZIP_FIXED_HEADER) {
+                    _gzipState = nextGzipState(GZ_FIXED);
+                }
+                break;
+
+            case GZ_EXTRA_LEN:
+                _gzipField |= (uint16_t)byte << (8 * _gzipPos);
+                if (++_gzipPos == 2) {
+                    _gzipState = _gzipField > 0 ? GZ_EXTRA : nextGzipState(GZ_EXTRA);
+                }
+                break;
+
+            case GZ_EXTRA:
+                if (--_gzipField == 0) {
+                    _gzipState = nextGzipState(GZ_EXTRA);
+                }
+                break;
+
+            case GZ_NAME:
+            case GZ_COMMENT:
+                if (byte == 0) {
+                    _gzipState = nextGzipState(_gzipState);
+                }
+                break;
+
+            case GZ_HCRC:
+                if (++_gzipPos == 2) {
+                    _gzipState = nextGzipState(GZ_HCRC);
+                }
+                break;
+        }
+    }
+
+    return true;
+}
+
+uint8_t OTACore::nextGzipState(uint8_t state) {
+    _gzipPos = 0;
+    if (state < GZ_EXTRA_LEN && (_gzipFlags & GZIP_FEXTRA)) {
+        _gzipField = 0;
+        return GZ_EXTRA_LEN;
+    }
+    if (state < GZ_NAME && (_gzipFlags & GZIP_FNAME)) return GZ_NAME;
+    if (state < GZ_COMMENT && (_gzipFlags & GZIP_FCOMMENT)) return GZ_COMMENT;
+    if (state < GZ_HCRC && (_gzipFlags & GZIP_FHCRC)) return GZ_HCRC;
+    return GZ_DONE;
+}
+
+void OTACore::recoverTrailer() {
+    // The ROM inflater reads ahead into its bit buffer and does not hand
+    // those bytes back; after the partial last byte they are the trailer
+    tinfl_bit_buf_t bits = _inflator->m_bit_buf;
+    mz_uint32 count = _inflator->m_num_bits;
+    bits >>= count & 7;
+    count &= ~7u;
+    while (count >= 8 && _gzipTrailerLen < sizeof(_gzipTrailer)) {
+        _gzipTrailer[_gzipTrailerLen++] = (uint8_t)(bits & 0xFF);
+        bits >>= 8;
+        count -= 8;
+    }
+}
+
+bool OTACore::checkGzipTrailer() {
+    if (!_inflateDone) {
+        failWrite("Failed to finish update: compressed image is truncated");
+        return false;
+    }
+
+    // Without CRC32 and ISIZE the image cannot be told from a truncated one
+    if (_gzipTrailerLen < sizeof(_gzipTrailer)) {
+        failWrite("Failed to finish update: gzip trailer is truncated");
+        return false;
+    }
+
+    uint32_t crc = 0;
+    uint32_t size = 0;
+    for (int i = 3; i >= 0; i--) {
+        crc = (crc << 8) | _gzipTrailer[i];
+        size = (size << 8) | _gzipTrailer[4 + i];
+    }
+
+    if (crc != _inflateCRC || size != (uint32_t)_inflateSize) {
+        failWrite("Failed to finish update: gzip CRC mismatch");
+        return false;
+    }
+    return true;
+}
+
+bool OTACore::decodeData(const uint8_t* data, size_t len) {
+    // The first decoded byte tells a patch from a plain image
+    if (_patchState == PATCH_DETECT) {
+        if (data[0] == PATCH_MAGIC[0]) {
+            startPatch();
+        } else {
+            _patchState = PATCH_OFF;
+        }
+    }
+
+    return _patchState == PATCH_OFF ? queueData(data, len) : patchData(data, len);
+}
+
+void OTACore::startPatch() {
+    _patchState = PATCH_HEADER;
+    _patchFieldLen = 0;
+    _sourcePartition = nullptr;
+    _sourceSize = 0;
+    _sourceOffset = 0;
+    _targetSize = 0;
+    _patchOutput = 0;
+    _patchRemaining = 0;
+    _patchExtra = 0;
+    _patchSeek = 0;
+}
+
+bool OTACore::patchData(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t n = 0;
+
+        switch (_patchState) {
+            case PATCH_HEADER:
+            case PATCH_CONTROL: {
+                size_t fieldSize = _patchState == PATCH_HEADER ? PATCH_HEADER_SIZE : PATCH_CONTROL_SIZE;
+                n = fieldSize - _patchFieldLen;
+                if (n > len) n = len;
+                memcpy(_patchField + _patchFieldLen, data, n);
+                _patchFieldLen += n;
+
+                if (_patchFieldLen == fieldSize) {
+                    _patchFieldLen = 0;
+                    if (_patchState == PATCH_CONTROL) {
+                        parsePatchControl();
+                    } else if (!parsePatchHeader()) {
+                        _writerFailed = true;
+                        return false;
+                    }
+                }
+                break;
+            }
+
+            case PATCH_DIFF:
+                n = len < _patchRemaining ? len : _patchRemaining;
+                if (n > PATCH_CHUNK_SIZE) n = PATCH_CHUNK_SIZE;
+
+                // Diff bytes are added to the source image at the source cursor
+                if (_sourceOffset + n > _sourceSize) {
+                    _writeError = "Patch reads outside the source image";
+                    _writerFailed = true;
+                    return false;
+                }
+                if (esp_partition_read(_sourcePartition, _sourceOffset, _patchSource, n) != ESP_OK) {
+                    _writeError = "Failed to read running partition";
+                    _writerFailed = true;
+                    return false;
+                }
+                for (size_t i = 0; i < n; i++) {
+                    _patchSource[i] += data[i];
+                }
+                if (!patchOutput(_patchSource, n)) {
+                    return false;
+                }
+                _sourceOffset += n;
+                _patchRemaining -= n;
+                if (_patchRemaining == 0) advancePatch();
+                break;
+
+            case PATCH_EXTRA:
+                n = len < _patchRemaining ? len : _patchRemaining;
+                if (!patchOutput(data, n)) {
+                    return false;
+                }
+                _patchRemaining -= n;
+                if (_patchRemaining == 0) advancePatch();
+                break;
+
+            default:
+                _writeError = "Unexpected data after patch";
+                _writerFailed = true;
+                return false;
+        }
+
+        data += n;
+        len -= n;
+    }
+
+    return !_writerFailed;
+}
+
+bool OTACore::parsePatchHeader() {
+    if (memcmp(_patchField, PATCH_MAGIC, sizeof(PATCH_MAGIC)) != 0) {
+        _writeError = "Invalid patch header";
+        return false;
+    }
+
+    _sourceSize = OTAUtil::readLE32(_patchField + 4);
+    _targetSize = OTAUtil::readLE32(_patchField + 8);
+    memcpy(_targetDigest, _patchField + 44, sizeof(_targetDigest));
+
+    _sourcePartition = esp_ota_get_running_partition();
+    if (!_sourcePartition || _sourceSize == 0 || _sourceSize > _sourcePartition->size) {
+        _writeError = "Patch source does not fit the running partition";
+        return false;
+    }
+    if (_targetSize == 0 || _targetSize > _partition->size) {
+        _writeError = "Patch target exceeds partition size";
+        return false;
+    }
+
+    // Hashed once after begin(), so a patch is never applied to the wrong base
+    if (!_runningDigestReady) {
+        _writeError = _runningDigestTask ? "Running image digest not ready, retry shortly"
+                                         : "Running image digest unavailable";
+        return false;
+    }
+    if (memcmp(_runningDigest, _patchField + 12, sizeof(_runningDigest)) != 0) {
+        _writeError = "Patch does not match the running firmware";
+        return false;
+    }
+
+    _patchState = PATCH_CONTROL;
+    Serial.println("[OTACore] Applying delta patch: " + String(_sourceSize) + " -> " +
+                   String(_targetSize) + " bytes");
+    return true;
+}
+
+void OTACore::parsePatchControl() {
+    _patchRemaining = OTAUtil::readLE32(_patchField);
+    _patchExtra = OTAUtil::readLE32(_patchField + 4);
+    _patchSeek = (int32_t)OTAUtil::readLE32(_patchField + 8);
+    advancePatch();
+}
+
+void OTACore::advancePatch() {
+    if (_patchState == PATCH_CONTROL && _patchRemaining > 0) {
+        _patchState = PATCH_DIFF;
+        return;
+    }
+
+    if (_patchState != PATCH_EXTRA && _patchExtra > 0) {
+        _patchState = PATCH_EXTRA;
+        _patchRemaining = _patchExtra;
+        _patchExtra = 0;
+        return;
+    }
+
+    // Record complete: move the source cursor and expect the next control block
+    _sourceOffset = (size_t)((int64_t)_sourceOffset + _patchSeek);
+    _patchState = _patchOutput >= _targetSize ? PATCH_DONE : PATCH_CONTROL;
+}
+
+bool OTACore::patchOutput(const uint8_t* data, size_t len) {
+    if (_patchOutput + len > _targetSize) {
+        _writeError = "Patch output exceeds target size";
+        _writerFailed = true;
+        return false;
+    }
+
+    _patchOutput += len;
+    return queueData(data, len);
+}
+
+bool OTACore::checkPatch() {
+    if (_patchState != PATCH_DONE || _patchOutput != _targetSize) {
+        failWrite("Failed to finish update: delta patch is incomplete");
+        return false;
+    }
+
+    // The image digest covers exactly the reconstructed output
+    if (memcmp(_imageDigest, _targetDigest, sizeof(_imageDigest)) != 0) {
+        failWrite("Failed to finish update: patched image SHA-256 mismatch");
+        return false;
+    }
+    return true;
+}
+
+void OTACore::endDigest() {
+    // Releases the SHA engine if the hash was left unfinished
+    mbedtls_sha256_free(&_imageHash);
+}
+
+bool OTACore::checkDigest() {
+    if (_hasExpectedDigest && memcmp(_imageDigest, _expectedDigest, sizeof(_imageDigest)) != 0) {
+        failWrite("Failed to finish update: SHA-256 mismatch");
+        return false;
+    }
+
+    if (_digestVerifier && !_digestVerifier(_imageDigest)) {
+        failWrite("Failed to finish update: image digest rejected by verifier");
+        return false;
+    }
+    return true;
+}
+
+bool OTACore::queueData(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        if (_writerFailed) {
+            return false;
+        }
+
+        if (_fillIndex < 0 && !acquireBuffer()) {
+            return false;
+        }
+
+        size_t space = _bufferSize - _fillLength;
+        size_t chunk = len < space ? len : space;
+        memcpy(_writeBuffers[_fillIndex] + _fillLength, data, chunk);
+        _fillLength += chunk;
+        data += chunk;
+        len -= chunk;
+
+        if (_fillLength == _bufferSize && !submitBuffer()) {
+            return false;
+        }
+    }
+
+    return !_writerFailed;
+}
+
+bool OTACore::acquireBuffer() {
+    if (!_asyncWrite) {
+        _fillIndex = 0;
+        _fillLength = 0;
+        return true;
+    }
+
+    uint8_t index;
+    if (xQueueReceive(_freeQueue, &index, pdMS_TO_TICKS(WRITER_TIMEOUT_MS)) != pdTRUE) {
+        failWrite("Flash writer timeout");
+        return false;
+    }
+
+    _fillIndex = index;
+    _fillLength = 0;
+    return true;
+}
+
+bool OTACore::submitBuffer() {
+    if (_fillIndex < 0) {
+        return true;
+    }
+
+    WriteJob job = {(uint8_t)_fillIndex, _fillLength};
+    _fillIndex = -1;
+    _fillLength = 0;
+
+    if (!_asyncWrite) {
+        return _writerFailed ? false : commitBuffer(_writeBuffers[job.index], job.length);
+    }
+
+    // The full queue holds one slot per buffer, so this never blocks
+    return xQueueSend(_fullQueue, &job, portMAX_DELAY) == pdTRUE;
+}
+
+bool OTACore::drainWriter(bool flushPartial) {
+    if (_fillIndex >= 0 && _fillLength > 0 && flushPartial) {
+        submitBuffer();
+    } else if (_fillIndex >= 0) {
+        uint8_t index = _fillIndex;
+        _fillIndex = -1;
+        if (_asyncWrite) {
+            xQueueSend(_freeQueue, &index, 0);
+        }
+    }
+
+    if (!_asyncWrite) {
+        return !_writerFailed;
+    }
+
+    // Collect every buffer back from the writer, then return them to the pool
+    uint8_t indices[MAX_WRITE_BUFFERS];
+    uint8_t collected = 0;
+    bool drained = true;
+    while (collected < _writeBufferCount) {
+        if (xQueueReceive(_freeQueue, &indices[collected], pdMS_TO_TICKS(WRITER_TIMEOUT_MS)) != pdTRUE) {
+            drained = false;
+            break;
+        }
+        collected++;
+    }
+    for (uint8_t i = 0; i < collected; i++) {
+        xQueueSend(_freeQueue, &indices[i], 0);
+    }
+
+    if (!drained) {
+        failWrite("Flash writer timeout");
+        return false;
+    }
+
+    return !_writerFailed;
+}
+
+bool OTACore::startBlockUpdate(size_t size, size_t blockSize, uint32_t sessionId) {
+    if (_status != Status::IDLE) {
+        _lastError = "OTA already in progress";
+        return false;
+    }
+
+    if (blockSize < 256 || blockSize > FLASH_SECTOR_SIZE || (blockSize & (blockSize - 1)) != 0) {
+        _lastError = "Block size must be a power of two from 256 to " + String(FLASH_SECTOR_SIZE);
+        return false;
+    }
+
+    if (size == 0 || size > getAvailableSize()) {
+        _lastError = "Update size exceeds available space";
+        return false;
+    }
+
+    uint32_t count = (size + blockSize - 1) / blockSize;
+    if (count > OTA_BLOCK_BITMAP_SIZE * 8) {
+        _lastError = "Image has more blocks than OTA_BLOCK_BITMAP_SIZE allows";
+        return false;
+    }
+
+    // Same image into the same slot: keep the blocks already in flash
+    BlockSession& blocks = rtc_ota_blocks;
+    const esp_partition_t* partition = esp_ota_get_next_update_partition(NULL);
+    bool resume = _persistent && partition && blocks.magic == BLOCK_MAGIC &&
+                  blocks.sessionId == sessionId && blocks.imageSize == size &&
+                  blocks.blockSize == blockSize && blocks.partitionAddress == partition->address &&
+                  blocks.received <= count;
+
+    _encoding = Encoding::RAW;
+    if (!beginSession(size, 0, "")) {
+        return false;
+    }
+    _patchState = PATCH_OFF;
+    _blockMode = true;
+
+    if (!resume) {
+        memset(&blocks, 0, sizeof(blocks));
+        blocks.sessionId = sessionId;
+        blocks.imageSize = size;
+        blocks.blockSize = blockSize;
+        blocks.blockCount = count;
+        blocks.partitionAddress = _partition->address;
+        blocks.magic = BLOCK_MAGIC;
+    }
+
+    _bytesReceived = (size_t)blocks.received * blockSize;
+    if (hasBlock(count - 1)) {
+        _bytesReceived -= (size_t)count * blockSize - size;
+    }
+    _progress = (_bytesReceived * 100) / size;
+
+    if (resume) {
+        emitEvent(EventCode::RESUMED, "Resuming block update...");
+        Serial.println("[OTACore] Block update resumed with " + String(blocks.received) + "/" +
+                       String(count) + " blocks");
+    } else {
+        emitEvent(EventCode::STARTED, "Starting block update...");
+        Serial.println("[OTACore] Block update started, size: " + String(size) + ", " +
+                       String(count) + " blocks of " + String(blockSize));
+    }
+    return true;
+}
+
+int OTACore::writeBlock(uint32_t index, const uint8_t* data, size_t len) {
+    uint32_t enter = micros();
+
+    if (!isBlockSession()) {
+        _lastError = "No block session in progress";
+        return -1;
+    }
+
+    BlockSession& blocks = rtc_ota_blocks;
+    if (index >= blocks.blockCount) {
+        _lastError = "Block index out of range";
+        return -1;
+    }
+
+    size_t offset = (size_t)index * blocks.blockSize;
+    size_t expected = blocks.imageSize - offset < blocks.blockSize
+                      ? blocks.imageSize - offset : blocks.blockSize;
+    if (!data || len != expected) {
+        _lastError = "Invalid block length";
+        return -1;
+    }
+
+    // Repeats are normal on lossy transports
+    if (hasBlock(index)) {
+        return 0;
+    }
+
+    if (index == 0 && data[0] != ESP_IMAGE_HEADER_MAGIC) {
+        failWrite("Write error: Invalid firmware image");
+        return -1;
+    }
+
+    // The first block to land in a sector erases it
+    uint32_t start = micros();
+    uint32_t eraseTime = 0;
+    size_t sector = offset / FLASH_SECTOR_SIZE;
+    if (offset >= _erasedUntil && !blockSectorErased(sector)) {
+        esp_err_t err = esp_partition_erase_range(_partition, sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+        if (err != ESP_OK) {
+            failWrite("Write error: " + String(esp_err_to_name(err)));
+            return -1;
+        }
+        eraseTime = micros() - start;
+    }
+
+    esp_err_t err = esp_partition_write(_partition, offset, data, len);
+    uint32_t commitTime = micros() - start;
+    if (err != ESP_OK) {
+        failWrite("Write error: " + String(esp_err_to_name(err)));
+        return -1;
+    }
+
+    blocks.bitmap[index / 8] |= (uint8_t)(1 << (index % 8));
+    blocks.received++;
+
+    portENTER_CRITICAL(&_commitLock);
+    _metrics.bytesWritten += len;
+    _metrics.writeCount++;
+    _metrics.eraseTimeUs += eraseTime;
+    _metrics.writeTimeUs += commitTime - eraseTime;
+    if (commitTime > _metrics.maxWriteUs) {
+        _metrics.maxWriteUs = commitTime;
+    }
+    _metrics.writeHistogram[bucketIndex(commitTime, WRITE_LATENCY_BOUNDS_US)]++;
+    portEXIT_CRITICAL(&_commitLock);
+
+    _bytesReceived += len;
+    _progress = (_bytesReceived * 100) / _imageSize;
+    recordChunk(len, enter);
+    emitProgress();
+
+    return len;
+}
+
+bool OTACore::isBlockSession() {
+    return _blockMode && _status == Status::RECEIVING;
+}
+
+bool OTACore::hasBlock(uint32_t index) {
+    if (!_blockMode || index >= rtc_ota_blocks.blockCount) {
+        return false;
+    }
+    return (rtc_ota_blocks.bitmap[index / 8] >> (index % 8)) & 1;
+}
+
+uint32_t OTACore::nextMissingBlock(uint32_t from) {
+    uint32_t count = getBlockCount();
+    for (uint32_t index = from; index < count; index++) {
+        // Skip complete bytes of the bitmap at once
+        if (index % 8 == 0 && rtc_ota_blocks.bitmap[index / 8] == 0xFF) {
+            index += 7;
+            continue;
+        }
+        if (!hasBlock(index)) {
+            return index;
+        }
+    }
+    return count;
+}
+
+uint32_t OTACore::getBlockCount() {
+    return _blockMode ? rtc_ota_blocks.blockCount : 0;
+}
+
+uint32_t OTACore::getBlocksReceived() {
+    return _blockMode ? rtc_ota_blocks.received : 0;
+}
+
+bool OTACore::finishBlockUpdate() {
+    BlockSession& blocks = rtc_ota_blocks;
+    if (blocks.received < blocks.blockCount) {
+        // Not an error: the transport runs another repair round
+        _lastError = String(blocks.blockCount - blocks.received) + " blocks missing";
+        return false;
+    }
+
+    // Blocks arrived out of order, so the digest is taken from flash
+    endDigest();
+    if (!hashPartition(_partition, _imageSize, _imageDigest)) {
+        clearBlockSession();
+        failWrite("Failed to finish update: cannot read back image");
+        return false;
+    }
+
+    if (!checkDigest()) {
+        clearBlockSession();
+        return false;
+    }
+    _digestReady = true;
+
+    esp_err_t err = esp_ota_set_boot_partition(_partition);
+    clearBlockSession();
+    if (err != ESP_OK) {
+        failWrite("Failed to finish update: " + String(esp_err_to_name(err)));
+        return false;
+    }
+    markPendingVerify(_partition);
+    cacheSlotDigest(_partition, _imageDigest);
+
+    endMetrics();
+    _status = Status::COMPLETE;
+    _progress = 100;
+    _completeTime = millis();
+    _resumeAvailable = false;
+
+    _rtcData.status = _status;
+    _rtcData.progress = _progress;
+    saveToRTC();
+
+    emitEvent(EventCode::COMPLETED, "OTA update completed successfully");
+    Serial.println("[OTACore] Block update completed successfully");
+    return true;
+}
+
+bool OTACore::blockSectorErased(size_t sector) {
+    uint32_t perSector = FLASH_SECTOR_SIZE / rtc_ota_blocks.blockSize;
+    uint32_t first = sector * perSector;
+    for (uint32_t index = first; index < first + perSector; index++) {
+        if (hasBlock(index)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OTACore::clearBlockSession() {
+    rtc_ota_blocks.magic = 0;
+}
+
+bool OTACore::hashPartition(const esp_partition_t* partition, size_t size, uint8_t digest[32]) {
+    uint8_t chunk[512];
+    bool readOk = true;
+    mbedtls_sha256_context hash;
+    mbedtls_sha256_init(&hash);
+    mbedtls_sha256_starts(&hash, 0);
+    for (size_t pos = 0; pos < size && readOk; pos += sizeof(chunk)) {
+        size_t len = size - pos < sizeof(chunk) ? size - pos : sizeof(chunk);
+        readOk = esp_partition_read(partition, pos, chunk, len) == ESP_OK;
+        if (readOk) {
+            mbedtls_sha256_update(&hash, chunk, len);
+        }
+    }
+    mbedtls_sha256_finish(&hash, digest);
+    mbedtls_sha256_free(&hash);
+    return readOk;
+}
+
+void OTACore::startMetrics() {
+    portENTER_CRITICAL(&_commitLock);
+    memset(&_metrics, 0, sizeof(_metrics));
+    portEXIT_CRITICAL(&_commitLock);
+
+    _metrics.minFreeHeap = ESP.getFreeHeap();
+    _metricsStart = millis();
+    _rateWindowStart = _metricsStart;
+    _rateWindowBytes = 0;
+    _lastWriteEnd = micros();
+}
+
+void OTACore::endMetrics() {
+    _metrics.duration = millis() - _metricsStart;
+    _metrics.averageRate = _metrics.duration > 0
+                           ? (uint64_t)_metrics.bytesReceived * 1000 / _metrics.duration : 0;
+}
+
+void OTACore::recordChunk(size_t len, uint32_t enter) {
+    // Fields written by the caller's task only; commits update under the lock
+    uint32_t now = micros();
+    _metrics.receiveWaitUs += enter - _lastWriteEnd;
+    _metrics.processTimeUs += now - enter;
+    _metrics.bytesReceived += len;
+    _metrics.chunkCount++;
+    _metrics.chunkHistogram[bucketIndex(len, CHUNK_SIZE_BOUNDS)]++;
+    _lastWriteEnd = now;
+
+    uint32_t freeHeap = ESP.getFreeHeap();
+    if (freeHeap < _metrics.minFreeHeap) {
+        _metrics.minFreeHeap = freeHeap;
+    }
+
+    _rateWindowBytes += len;
+    unsigned long elapsed = millis() - _rateWindowStart;
+    if (elapsed >= RATE_WINDOW_MS) {
+        _metrics.currentRate = (uint64_t)_rateWindowBytes * 1000 / elapsed;
+        _rateWindowStart += elapsed;
+        _rateWindowBytes = 0;
+    }
+}
+
+void OTACore::failWrite(const String& message) {
+    if (_status == Status::RECEIVING) {
+        endMetrics();
+    }
+    _lastError = message;
+    _status = Status::ERROR;
+    emitEvent(EventCode::FAILED, _lastError.c_str());
+}
+
+void OTACore::persistProgress() {
+    if (!_persistent) return;
+
+    bool due = false;
+    if (_persistPolicy.byteInterval > 0 &&
+        _bytesReceived - _lastPersistBytes >= _persistPolicy.byteInterval) {
+        due = true;
+    }
+    if (_persistPolicy.timeInterval > 0 &&
+        millis() - _lastPersistTime >= _persistPolicy.timeInterval) {
+        due = true;
+    }
+    if (_persistPolicy.progressStep > 0 &&
+        _progress - _lastPersistProgress >= _persistPolicy.progressStep) {
+        due = true;
+    }
+
+    if (due) {
+        portENTER_CRITICAL(&_commitLock);
+        _rtcData.writeOffset = _writeOffset;
+        _rtcData.imageCRC = _imageCRC;
+        portEXIT_CRITICAL(&_commitLock);
+        _rtcData.progress = _progress;
+        // The flash offset of a gzip or patch stream is not an input offset
+        _rtcData.rawStream = !_inflating && !isDelta();
+        saveToRTC();
+    }
+}
+
+void OTACore::saveToRTC() {
+    if (!_persistent) return;
+    
+    _rtcData.crc = calculateCRC();
+    rtc_ota_data = _rtcData;
+
+    _lastPersistBytes = _bytesReceived;
+    _lastPersistTime = millis();
+    _lastPersistProgress = _rtcData.progress;
+}
+
+bool OTACore::loadFromRTC() {
+    if (!_persistent) return false;
+    
+    _rtcData = rtc_ota_data;
+    
+    // Validate magic number and CRC
+    if (_rtcData.magic != RTC_MAGIC) {
+        return false;
+    }
+    
+    uint32_t storedCRC = _rtcData.crc;
+    uint32_t calculatedCRC = calculateCRC();
+    
+    if (storedCRC != calculatedCRC) {
+        return false;
+    }
+    
+    // Restore state
+    _status = _rtcData.status;
+    _progress = _rtcData.progress;
+    
+    return true;
+}
+
+bool OTACore::initDispatcher(const DispatchPolicy& policy) {
+    uint8_t length = policy.queueLength > 0 ? policy.queueLength : 1;
+    _eventQueue = xQueueCreate(length, sizeof(QueuedEvent));
+    if (!_eventQueue) {
+        return false;
+    }
+
+    if (!OTAUtil::startTask(dispatchTask, "ota_events", policy.taskStackSize, policy.taskPriority,
+                            &_dispatchTask)) {
+        releaseDispatcher();
+        return false;
+    }
+
+    Serial.println("[OTACore] Event dispatcher task started");
+    return true;
+}
+
+void OTACore::releaseDispatcher() {
+    if (_dispatchTask) {
+        vTaskDelete(_dispatchTask);
+        _dispatchTask = nullptr;
+    }
+    if (_eventQueue) {
+        vQueueDelete(_eventQueue);
+        _eventQueue = nullptr;
+    }
+}
+
+void OTACore::dispatchTask(void* param) {
+    QueuedEvent item;
+    for (;;) {
+        if (xQueueReceive(_eventQueue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        Event event = {item.code, item.status, item.progress, item.message};
+        deliverEvent(event);
+    }
+}
+
+void OTACore::emitEvent(EventCode code, const char* message) {
+    _lastEventProgress = _progress;
+    _lastEventTime = millis();
+
+    if (!_eventHandler && !_callback) {
+        return;
+    }
+
+    if (!message) {
+        message = "";
+    }
+
+    if (_eventQueue) {
+        QueuedEvent item;
+        item.code = code;
+        item.status = _status;
+        item.progress = _progress;
+        strlcpy(item.message, message, sizeof(item.message));
+
+        // A full queue drops progress but holds state changes briefly
+        TickType_t wait = code == EventCode::PROGRESS ? 0 : pdMS_TO_TICKS(EVENT_QUEUE_TIMEOUT_MS);
+        xQueueSend(_eventQueue, &item, wait);
+        return;
+    }
+
+    Event event = {code, _status, _progress, message};
+    deliverEvent(event);
+}
+
+void OTACore::emitProgress() {
+    int delta = _progress - _lastEventProgress;
+    if (delta <= 0) {
+        return;
+    }
+
+    bool stepDue = _dispatchPolicy.progressStep > 0 && delta >= _dispatchPolicy.progressStep;
+    bool timeDue = _dispatchPolicy.minInterval > 0 &&
+                   millis() - _lastEventTime >= _dispatchPolicy.minInterval;
+    if (stepDue || timeDue) {
+        emitEvent(EventCode::PROGRESS, "Receiving update...");
+    }
+}
+
+void OTACore::deliverEvent(const Event& event) {
+    if (_eventHandler) {
+        _eventHandler(event);
+    }
+
+    // The legacy callback still takes a String
+    if (_callback) {
+        _callback(event.status, event.progress, String(event.message));
+    }
+}
+
+void OTACore::flushEvents() {
+    if (!_eventQueue) {
+        return;
+    }
+
+    unsigned long start = millis();
+    while (uxQueueMessagesWaiting(_eventQueue) > 0 && millis() - start < EVENT_QUEUE_TIMEOUT_MS) {
+        delay(1);
     }
 }
 
@@ -273,5 +2535,10 @@ uint32_t OTACore::calculateCRC() {
     crc ^= (uint32_t)_rtcData.otaEnabled;
     crc ^= (uint32_t)_rtcData.status;
     crc ^= (uint32_t)_rtcData.progress;
+    crc ^= _rtcData.imageSize;
+    crc ^= _rtcData.writeOffset;
+    crc ^= _rtcData.partitionAddress;
+    crc ^= _rtcData.imageCRC;
+    crc ^= (uint32_t)_rtcData.rawStream << 1;      // otaEnabled holds bit 0
     return crc;
 }
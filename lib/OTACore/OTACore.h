@@ -1,8 +1,30 @@
 #pragma once
 
 #include <Arduino.h>
-#include <Update.h>
+#include <MD5Builder.h>
 #include <WiFi.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "OTAArena.h"
+
+struct tinfl_decompressor_tag;
+
+// Size of the coalescing write buffer; rounded up to whole 4KB flash sectors
+#ifndef OTA_BUFFER_SIZE
+#define OTA_BUFFER_SIZE 4096
+#endif
+
+// Buckets in the Metrics latency and chunk size histograms
+#define OTA_METRICS_BUCKETS 8
+
+// Received-block bitmap kept in RTC memory for block sessions (8 blocks per byte)
+#ifndef OTA_BLOCK_BITMAP_SIZE
+#define OTA_BLOCK_BITMAP_SIZE 512
+#endif
 
 /**
  * @brief Core OTA functionality that persists across firmware updates
@@ -24,11 +46,260 @@ public:
         REBOOTING
     };
 
+    /**
+     * @brief Encoding of the incoming image stream
+     */
+    enum class Encoding {
+        AUTO,                              // Detect gzip by its header, otherwise raw
+        RAW,                               // Plain application image
+        GZIP                               // gzip-compressed application image
+    };
+
+    /**
+     * @brief When to persist progress to RTC memory while receiving
+     *
+     * State changes (start, complete, error, abort) are always persisted.
+     * Progress is only persisted when one of the enabled thresholds is
+     * crossed; a value of 0 disables that threshold.
+     */
+    struct PersistencePolicy {
+        size_t byteInterval;               // Save after this many new bytes
+        unsigned long timeInterval;        // Save after this many milliseconds
+        uint8_t progressStep;              // Save when progress advances by this many percent
+
+        // Constructor with default values
+        PersistencePolicy() : byteInterval(0), timeInterval(0), progressStep(10) {}
+    };
+
+    /**
+     * @brief How OTA events are rate-limited and delivered
+     *
+     * State changes are always delivered. PROGRESS events are only emitted
+     * once progress has advanced by progressStep percent, or after
+     * minInterval ms if it has changed at all; 0 disables a threshold.
+     */
+    struct DispatchPolicy {
+        uint8_t progressStep;              // Minimum progress change in percent
+        unsigned long minInterval;         // Emit a changed progress after this many ms
+        bool useTask;                      // Deliver events from a low-priority task
+        UBaseType_t taskPriority;          // Dispatcher task priority
+        uint32_t taskStackSize;            // Dispatcher task stack size in bytes
+        uint8_t queueLength;               // Events buffered for the dispatcher task
+
+        // Constructor with default values
+        DispatchPolicy() : progressStep(1), minInterval(0), useTask(false),
+                           taskPriority(1), taskStackSize(3072), queueLength(8) {}
+    };
+
+    /**
+     * @brief When a newly installed image is confirmed or rolled back
+     *
+     * After an update the new image boots pending verification. It is
+     * marked valid once it has run for healthCheckDelay ms and the health
+     * check, if one is set, passes. If the check has not passed within
+     * validationTimeout, or the image resets maxBootAttempts times before
+     * being validated, the previous image is booted again. The pending state
+     * is kept in NVS, so it survives power loss; a bootloader built with
+     * app rollback also reverts an image that never reaches begin().
+     */
+    struct ValidationPolicy {
+        unsigned long healthCheckDelay;    // Uptime before the first health check
+        unsigned long checkInterval;       // Time between health checks
+        unsigned long validationTimeout;   // Roll back if still unhealthy by then (0 = never)
+        uint8_t maxBootAttempts;           // Roll back after this many unvalidated boots (0 = never)
+
+        // Constructor with default values
+        ValidationPolicy() : healthCheckDelay(0), checkInterval(1000), validationTimeout(60000),
+                             maxBootAttempts(3) {}
+    };
+
+    /**
+     * @brief Reboot scheduling modes
+     */
+    enum class RebootMode {
+        IMMEDIATE,                         // On the next handle()
+        DELAYED,                           // delay ms after completion
+        WINDOW,                            // Inside the local-time maintenance window
+        IDLE,                              // Once the idle check returns true
+        MANUAL                             // Only when scheduleReboot() is called
+    };
+
+    /**
+     * @brief When the device restarts into a completed update
+     *
+     * The window runs from windowStart up to windowEnd (local hours, wrapping
+     * past midnight when windowEnd < windowStart) and needs the clock set,
+     * e.g. by SNTP. Without an idle check IDLE reboots at once. maxDefer
+     * bounds WINDOW, IDLE and MANUAL so a staged image does not wait forever.
+     */
+    struct RebootPolicy {
+        RebootMode mode;
+        unsigned long delay;               // DELAYED: ms after completion
+        uint8_t windowStart;               // WINDOW: first hour of the window (0-23)
+        uint8_t windowEnd;                 // WINDOW: hour the window closes (0-23)
+        unsigned long maxDefer;            // Reboot anyway this long after completion (0 = never)
+
+        // Constructor with default values
+        RebootPolicy() : mode(RebootMode::DELAYED), delay(1000), windowStart(2), windowEnd(4),
+                         maxDefer(0) {}
+    };
+
+    /**
+     * @brief OTA core configuration
+     */
+    struct Config {
+        bool enablePersistence;            // Enable RTC memory persistence
+        PersistencePolicy persistence;     // Progress persistence thresholds
+        DispatchPolicy dispatch;           // Event rate limiting and delivery
+        size_t bufferSize;                 // Write buffer size, rounded up to whole sectors
+        bool asyncWrite;                   // Program flash from a dedicated writer task
+        uint8_t writeBufferCount;          // Buffers shared with the writer (2-8)
+        int writerCore;                    // Core the writer task is pinned to
+        UBaseType_t writerPriority;        // Writer task priority
+        uint32_t writerStackSize;          // Writer task stack size in bytes
+        bool enableCompression;            // Preallocate the inflater for gzip images (~43KB)
+        ValidationPolicy validation;       // Boot validation and rollback
+        RebootPolicy reboot;               // When to restart into a completed update
+        size_t prepareSize;                // Pre-erase this much of the inactive slot once a new image is validated (0 = off)
+
+        // Constructor with default values
+        Config() : enablePersistence(true), bufferSize(OTA_BUFFER_SIZE),
+                   asyncWrite(false), writeBufferCount(2),
+                   writerCore(ARDUINO_RUNNING_CORE == 0 ? 1 : 0),
+                   writerPriority(2), writerStackSize(4096), enableCompression(false),
+                   prepareSize(0) {}
+    };
+
+    /**
+     * @brief Interrupted transfer that can be continued
+     */
+    struct ResumeInfo {
+        bool available;                    // A resumable session exists
+        size_t imageSize;                  // Total image size of the session
+        size_t offset;                     // Bytes committed to flash
+        uint32_t imageCRC;                 // CRC32 of the committed bytes
+    };
+
+    /**
+     * @brief Transfer and flash timing of the current or last session
+     *
+     * writeHistogram counts flash commits (erase + write of one buffer) by
+     * latency: <1, <2, <5, <10, <20, <50, <100 and >=100 ms. chunkHistogram
+     * counts writeData() calls by size: <256, <512, <1024, <1460, <2048,
+     * <4096, <8192 and >=8192 bytes. receiveWaitUs is the time spent between
+     * writeData() calls, i.e. waiting on the network; a session that is
+     * flash-bound shows high writeTimeUs and eraseTimeUs instead.
+     */
+    struct Metrics {
+        uint32_t duration;                 // Session time in ms (live while receiving)
+        uint32_t bytesReceived;            // Bytes passed to writeData()
+        uint32_t bytesWritten;             // Bytes committed to flash
+        uint32_t averageRate;              // Bytes/s received over the session
+        uint32_t currentRate;              // Bytes/s received over the last second
+        uint32_t chunkCount;               // writeData() calls
+        uint32_t receiveWaitUs;            // Time between writeData() calls
+        uint32_t processTimeUs;            // Time inside writeData()
+        uint32_t writeCount;               // Flash commits
+        uint32_t writeTimeUs;              // Time in esp_partition_write()
+        uint32_t maxWriteUs;               // Slowest single commit
+        uint32_t eraseTimeUs;              // Time in esp_partition_erase_range()
+        uint32_t minFreeHeap;              // Heap low-water mark during the session
+        uint32_t writeHistogram[OTA_METRICS_BUCKETS];
+        uint32_t chunkHistogram[OTA_METRICS_BUCKETS];
+    };
+
+    /**
+     * @brief Where an image is already installed
+     */
+    enum class Installed {
+        NONE,                              // Not installed; transfer it
+        RUNNING,                           // It is the running image
+        INACTIVE                           // It is in the other slot and now selected for boot
+    };
+
+    /**
+     * @brief Application slot as found in the partition table
+     */
+    struct SlotInfo {
+        char label[17];                    // Partition label
+        uint32_t address;                  // Partition flash address
+        uint32_t size;                     // Partition size
+        bool running;                      // Image executing now
+        bool boot;                         // Image selected for the next boot
+        bool valid;                        // Holds an image that passes verification
+        esp_ota_img_states_t state;        // otadata state (ESP_OTA_IMG_UNDEFINED if none)
+        uint32_t imageSize;                // Image length (0 if not valid)
+        char version[32];                  // App version from the image description
+        char project[32];                  // Project name from the image description
+        uint8_t sha256[32];                // SHA-256 of the image as a .bin (zero if not computed)
+    };
+
+    /**
+     * @brief Background pre-erase of the inactive slot
+     */
+    struct PrepareInfo {
+        bool running;                      // Erase task is working
+        size_t erased;                     // Bytes erased from the start of the slot
+        size_t target;                     // Bytes requested
+        const char* error;                 // Erase error, nullptr if none
+    };
+
+    /**
+     * @brief OTA event codes
+     */
+    enum class EventCode {
+        STARTED,
+        RESUMED,
+        PROGRESS,
+        COMPLETED,
+        SUSPENDED,
+        ABORTED,
+        FAILED,
+        REBOOTING,
+        VALIDATED,
+        ROLLED_BACK
+    };
+
+    /**
+     * @brief OTA event passed to the event handler
+     */
+    struct Event {
+        EventCode code;
+        Status status;
+        int progress;
+        const char* message;               // Valid only during the handler call
+    };
+
+    /**
+     * @brief OTA event handler function type
+     */
+    typedef std::function<void(const Event& event)> EventHandler;
+
     /**
      * @brief OTA update callback function type
      */
     typedef std::function<void(Status status, int progress, const String& message)> CallbackFunction;
 
+    /**
+     * @brief Image digest verifier (e.g. a signature check over the SHA-256)
+     */
+    typedef std::function<bool(const uint8_t digest[32])> DigestVerifier;
+
+    /**
+     * @brief Health check for a newly booted image; true once it is healthy
+     */
+    typedef std::function<bool()> HealthCheck;
+
+    /**
+     * @brief Idle check for RebootMode::IDLE; true when a restart is convenient
+     */
+    typedef std::function<bool()> IdleCheck;
+
+    /**
+     * @brief Called before OTACore restarts the device, e.g. to flush state
+     */
+    typedef std::function<void()> RebootHook;
+
     /**
      * @brief Initialize OTA core functionality
      * @param enablePersistence Enable RTC memory persistence for OTA logic
@@ -36,25 +307,156 @@ public:
      */
     static bool begin(bool enablePersistence = true);
 
+    /**
+     * @brief Initialize OTA core functionality with full configuration
+     * @param config Core configuration
+     * @return true if initialization successful
+     */
+    static bool begin(const Config& config);
+
     /**
      * @brief Set callback function for OTA events
      * @param callback Function to call on OTA events
      */
     static void setCallback(CallbackFunction callback);
 
+    /**
+     * @brief Set handler for rate-limited OTA events
+     *
+     * Unlike setCallback(), messages are passed as plain C strings and
+     * no String is built per event. With DispatchPolicy::useTask the
+     * handler runs in the dispatcher task instead of the write path.
+     *
+     * @param handler Function to call on OTA events
+     */
+    static void setEventHandler(EventHandler handler);
+
     /**
      * @brief Start OTA update process
-     * @param size Expected firmware size
+     *
+     * For compressed images @p size is the number of bytes that will be
+     * passed to writeData(), and @p md5 applies to the decompressed image.
+     *
+     * @param size Expected transfer size
      * @param md5 Expected MD5 hash (optional)
+     * @param encoding Image encoding (gzip is detected by header with AUTO)
      * @return true if OTA start successful
      */
-    static bool startUpdate(size_t size, const String& md5 = "");
+    static bool startUpdate(size_t size, const String& md5 = "", Encoding encoding = Encoding::AUTO);
+
+    /**
+     * @brief Continue an interrupted update from its committed offset
+     *
+     * The committed region is read back once and checked against the
+     * persisted CRC before new data is accepted.
+     *
+     * @param size Total firmware size (must match the interrupted session)
+     * @param offset Offset the client resumes from (must equal the committed offset)
+     * @param md5 Expected MD5 hash of the complete image (optional)
+     * @return true if the session was resumed
+     */
+    static bool resumeUpdate(size_t size, size_t offset, const String& md5 = "");
+
+    /**
+     * @brief Get the resumable session, if any
+     * @return Resume information
+     */
+    static ResumeInfo getResumeInfo();
+
+    /**
+     * @brief Get bytes committed to flash in the current session
+     * @return Committed byte offset
+     */
+    static size_t getCommittedOffset();
+
+    /**
+     * @brief Get transfer and flash metrics of the current or last session
+     * @return Metrics snapshot
+     */
+    static Metrics getMetrics();
+
+    /**
+     * @brief Start an update whose blocks may arrive in any order
+     *
+     * For transports that deliver numbered blocks out of order or repeat
+     * them (multicast, peer-to-peer). A received-block bitmap is kept in RTC
+     * memory, so calling this again with the same session id, size and
+     * block size after a reset resumes the session with the blocks already
+     * in flash. finishUpdate() hashes the image from flash once every block
+     * is present, so setExpectedSHA256() and verifiers apply as usual.
+     *
+     * @param size Image size in bytes
+     * @param blockSize Block size, a power of two from 256 to 4096
+     * @param sessionId Identifies the image across resets
+     * @return true if the session was started or resumed
+     */
+    static bool startBlockUpdate(size_t size, size_t blockSize, uint32_t sessionId);
+
+    /**
+     * @brief Write one block of a block session
+     * @param index Block number
+     * @param data Block data
+     * @param len Block length (blockSize, shorter only for the last block)
+     * @return Bytes written, 0 for a block already received, -1 on error
+     */
+    static int writeBlock(uint32_t index, const uint8_t* data, size_t len);
+
+    /**
+     * @brief Check if a block session is active
+     * @return true between startBlockUpdate() and its finish or abort
+     */
+    static bool isBlockSession();
+
+    /**
+     * @brief Check if a block of the current session has been written
+     * @param index Block number
+     * @return true if the block is in flash
+     */
+    static bool hasBlock(uint32_t index);
+
+    /**
+     * @brief Find the next block still missing
+     * @param from First block number to check
+     * @return Block number, or getBlockCount() when none is missing from there
+     */
+    static uint32_t nextMissingBlock(uint32_t from);
+
+    /**
+     * @brief Get the number of blocks in the current block session
+     * @return Block count
+     */
+    static uint32_t getBlockCount();
+
+    /**
+     * @brief Get the number of blocks written in the current block session
+     * @return Received block count
+     */
+    static uint32_t getBlocksReceived();
+
+    /**
+     * @brief Compute the SHA-256 of the first bytes of a partition
+     *
+     * With the running partition and ESP.getSketchSize() this is the digest
+     * of the installed .bin, as setExpectedSHA256() expects it.
+     *
+     * @param partition Partition to read
+     * @param size Number of bytes to hash
+     * @param digest Receives the 32-byte digest
+     * @return true if the partition could be read
+     */
+    static bool hashPartition(const esp_partition_t* partition, size_t size, uint8_t digest[32]);
 
     /**
      * @brief Write data chunk to OTA
+     *
+     * Data is coalesced into a sector-aligned buffer and only whole buffers
+     * are written to flash; the remainder is flushed by finishUpdate(). In
+     * async write mode full buffers are handed to the writer task and flash
+     * errors are reported on a later call or by finishUpdate().
+     *
      * @param data Data buffer
      * @param len Data length
-     * @return Number of bytes written, -1 on error
+     * @return Number of bytes accepted, -1 on error
      */
     static int writeData(uint8_t* data, size_t len);
 
@@ -69,6 +471,15 @@ public:
      */
     static void abortUpdate();
 
+    /**
+     * @brief Suspend the current update so it can be resumed later
+     *
+     * Pending full buffers are committed, the partially filled buffer is
+     * dropped so the committed offset stays sector aligned, and the session
+     * is kept for resumeUpdate().
+     */
+    static void suspendUpdate();
+
     /**
      * @brief Get current OTA status
      * @return Current status
@@ -87,6 +498,36 @@ public:
      */
     static String getLastError();
 
+    /**
+     * @brief Get last error message without copying it
+     * @return Error message, valid until the next OTACore call
+     */
+    static const char* getLastErrorCStr();
+
+    /**
+     * @brief Set the expected SHA-256 of the image being received
+     *
+     * May be called any time before finishUpdate(), so a digest sent after
+     * the image (e.g. in a trailing form field) works as well as one known
+     * at start. The digest is computed while the image is written.
+     *
+     * @param hex 64-character hex digest
+     * @return true if the digest was accepted
+     */
+    static bool setExpectedSHA256(const String& hex);
+
+    /**
+     * @brief Set a verifier that must accept the image digest before commit
+     * @param verifier Function receiving the SHA-256 of the written image
+     */
+    static void setDigestVerifier(DigestVerifier verifier);
+
+    /**
+     * @brief Get the SHA-256 of the last completed image
+     * @return Hex digest (empty until an update has finished)
+     */
+    static String getSHA256();
+
     /**
      * @brief Check if OTA is currently active
      * @return true if OTA is in progress
@@ -104,12 +545,62 @@ public:
      */
     static void setPersistence(bool enable);
 
+    /**
+     * @brief Enable/disable persistence and set when progress is saved
+     * @param enable true to enable persistence
+     * @param policy Progress persistence thresholds
+     */
+    static void setPersistence(bool enable, const PersistencePolicy& policy);
+
+    /**
+     * @brief Get the current progress persistence policy
+     * @return Persistence policy
+     */
+    static PersistencePolicy getPersistencePolicy();
+
     /**
      * @brief Check if OTA core is persistent
      * @return true if persistence is enabled
      */
     static bool isPersistent();
 
+    /**
+     * @brief Check if flash is programmed from the writer task
+     * @return true if async write mode is active
+     */
+    static bool isAsyncWrite();
+
+    /**
+     * @brief Check if the current image is being decompressed
+     * @return true if the incoming stream is gzip
+     */
+    static bool isCompressed();
+
+    /**
+     * @brief Check if the current image is being rebuilt from a delta patch
+     * @return true if the decoded stream is a patch against the running firmware
+     */
+    static bool isDelta();
+
+    /**
+     * @brief Get the coalescing write buffer size
+     * @return Buffer size in bytes (multiple of the flash sector size)
+     */
+    static size_t getBufferSize();
+
+    /**
+     * @brief Get how many bytes writeData() takes without waiting for flash
+     *
+     * In async write mode this is the space left in the buffer being filled
+     * plus the buffers the writer has handed back; a transport can read only
+     * that much from its socket and leave the rest in the TCP window. Without
+     * the writer, writeData() commits inline and one buffer is reported.
+     * Call from the task that calls writeData().
+     *
+     * @return Bytes that can be staged now (0 while every buffer is in flash)
+     */
+    static size_t getWriteCapacity();
+
     /**
      * @brief Get available OTA partition size
      * @return Available size in bytes
@@ -117,7 +608,131 @@ public:
     static size_t getAvailableSize();
 
     /**
-     * @brief Restart ESP32 after OTA completion
+     * @brief Describe the application slots
+     *
+     * Each image is verified from flash, and with @p withDigest its digest is
+     * taken from the NVS cache or computed, so this reads both images and is
+     * not meant for the write path.
+     *
+     * @param slots Receives up to @p maxSlots entries
+     * @param maxSlots Capacity of @p slots
+     * @param withDigest Compute SHA-256 of each valid image
+     * @return Number of entries filled
+     */
+    static uint8_t getSlots(SlotInfo* slots, uint8_t maxSlots, bool withDigest = true);
+
+    /**
+     * @brief Set the check that validates a newly booted image
+     *
+     * Called from handle() every checkInterval ms while the image is pending
+     * verification. Without a check the image is validated once it has run
+     * for healthCheckDelay ms.
+     *
+     * @param check Function returning true once the firmware is healthy
+     */
+    static void setHealthCheck(HealthCheck check);
+
+    /**
+     * @brief Check if the running image still has to be validated
+     * @return true after the first boots of a new image, until markValid()
+     */
+    static bool isPendingVerify();
+
+    /**
+     * @brief Confirm the running image and cancel any pending rollback
+     */
+    static void markValid();
+
+    /**
+     * @brief Check if a previous image can be booted
+     * @return true if the other slot holds an image and no update is in progress
+     */
+    static bool canRollback();
+
+    /**
+     * @brief Boot the previous image by switching the boot partition
+     *
+     * No data is transferred; the previous image is verified in place.
+     *
+     * @param reboot Restart right away
+     * @return true if the boot partition was switched
+     */
+    static bool rollback(bool reboot = true);
+
+    /**
+     * @brief Skip an update whose image is already in flash
+     *
+     * Compares @p sha256 (the digest of the .bin, as for setExpectedSHA256())
+     * with the digests of the running and the inactive slot. Slot digests are
+     * computed once and cached in NVS, keyed by the image's ELF SHA-256 from
+     * its app description, so a slot that changes is hashed again. If the
+     * image is running there is nothing to do. If it is in the inactive slot,
+     * that slot is selected for boot and the core completes as after an
+     * update, without erasing or writing flash.
+     *
+     * @param sha256 64-character hex digest of the image to be installed
+     * @return Where the image was found (NONE: go ahead with the transfer)
+     */
+    static Installed skipIfInstalled(const String& sha256);
+
+    /**
+     * @brief Erase the start of the inactive slot ahead of an update
+     *
+     * A low-priority task erases the slot in 64KB steps so that a later
+     * update from offset zero only pays program time. The prepared sectors
+     * are adopted by the next startUpdate() or startBlockUpdate(); anything
+     * else that claims the slot discards them. Refused while an update is
+     * running, staged or resumable, and while the running image is pending
+     * verification, since the inactive slot then holds the rollback image.
+     * Once validated, preparing erases that image and rollback() is no
+     * longer possible.
+     *
+     * @param size Bytes to erase (0 = whole slot), rounded up to whole sectors
+     * @return true if the erase was started or the slot is already prepared
+     */
+    static bool prepareUpdate(size_t size = 0);
+
+    /**
+     * @brief Get pre-erase progress
+     * @return Snapshot of the background erase
+     */
+    static PrepareInfo getPrepareInfo();
+
+    /**
+     * @brief Change when a completed update is rebooted into
+     * @param policy Reboot policy; applies to an update already waiting
+     */
+    static void setRebootPolicy(const RebootPolicy& policy);
+
+    /**
+     * @brief Set the check RebootMode::IDLE waits on
+     * @param check Function returning true when the application is idle
+     */
+    static void setIdleCheck(IdleCheck check);
+
+    /**
+     * @brief Set the hook run before every restart OTACore performs
+     * @param hook Function that flushes application state; must not block long
+     */
+    static void setRebootHook(RebootHook hook);
+
+    /**
+     * @brief Restart from handle() after a delay, regardless of the policy
+     *
+     * Deferred while an update is being received.
+     *
+     * @param delayMs Delay in ms (0 = next handle())
+     */
+    static void scheduleReboot(unsigned long delayMs = 0);
+
+    /**
+     * @brief Check if a completed update or scheduled restart is waiting
+     * @return true until the device restarts
+     */
+    static bool isRebootPending();
+
+    /**
+     * @brief Restart ESP32 after running the reboot hook
      */
     static void restart();
 
@@ -129,21 +744,238 @@ public:
         bool otaEnabled;
         Status status;
         int progress;
+        uint32_t imageSize;                // Total size of the session image
+        uint32_t writeOffset;              // Bytes committed to flash
+        uint32_t partitionAddress;         // Target partition flash address
+        uint32_t imageCRC;                 // CRC32 of the committed bytes
+        bool rawStream;                    // Plain image; gzip and patch streams cannot resume
         uint32_t crc;
     };
 
+    /**
+     * @brief Block session state kept in RTC memory
+     */
+    struct BlockSession {
+        uint32_t magic;
+        uint32_t sessionId;
+        uint32_t imageSize;
+        uint32_t blockSize;
+        uint32_t blockCount;
+        uint32_t received;
+        uint32_t partitionAddress;
+        uint8_t bitmap[OTA_BLOCK_BITMAP_SIZE];
+    };
+
 private:
 
-    static Status _status;
-    static int _progress;
+    static volatile Status _status;
+    static volatile int _progress;
+    static unsigned long _completeTime;
+    static RebootPolicy _rebootPolicy;
+    static IdleCheck _idleCheck;
+    static RebootHook _rebootHook;
+    static bool _rebootScheduled;
+    static unsigned long _rebootRequestTime;
+    static unsigned long _rebootDelay;
+    static const time_t MIN_VALID_TIME = 1609459200;   // 2021-01-01; earlier means the clock is unset
+    static ValidationPolicy _validation;
+    static HealthCheck _healthCheck;
+    static bool _pendingVerify;
+    static unsigned long _verifyStart;
+    static unsigned long _lastHealthCheck;
+    static bool _healthChecked;
+    static bool _bootCounted;
+
+    static bool rebootDue();
+    static bool inRebootWindow();
+    static void checkPendingVerify();
+    static void markPendingVerify(const esp_partition_t* target);
+    static void clearPendingVerify();
+    static void serviceValidation();
+    static const esp_partition_t* rollbackTarget();
+    static bool slotDigest(const esp_partition_t* partition, uint8_t digest[32]);
+    static void cacheSlotDigest(const esp_partition_t* partition, const uint8_t digest[32]);
+    static void clearSlotDigest(const esp_partition_t* partition);
     static String _lastError;
     static CallbackFunction _callback;
+    static EventHandler _eventHandler;
+    static DispatchPolicy _dispatchPolicy;
+    static int _lastEventProgress;
+    static unsigned long _lastEventTime;
+
+    static const size_t EVENT_MESSAGE_SIZE = 64;       // Copied message length for queued events
+    static const unsigned long EVENT_QUEUE_TIMEOUT_MS = 100;
+    struct QueuedEvent {
+        EventCode code;
+        Status status;
+        int progress;
+        char message[EVENT_MESSAGE_SIZE];
+    };
+    static QueueHandle_t _eventQueue;
+    static TaskHandle_t _dispatchTask;
     static bool _persistent;
     static RTCData _rtcData;
     static const uint32_t RTC_MAGIC = 0xDEADBEEF;
+    static PersistencePolicy _persistPolicy;
+    static size_t _imageSize;
+    static size_t _bytesReceived;
+    static size_t _lastPersistBytes;
+    static unsigned long _lastPersistTime;
+    static int _lastPersistProgress;
+    static const esp_partition_t* _partition;
+    static volatile size_t _writeOffset;
+    static size_t _erasedUntil;
+    static size_t _prepareSize;
+    static TaskHandle_t _prepareTask;
+    static const esp_partition_t* _preparedPartition;
+    static volatile size_t _preparedUntil;
+    static size_t _prepareTarget;
+    static volatile bool _preparing;
+    static volatile bool _prepareCancel;
+    static const char* _prepareError;
+    static unsigned long _prepareStart;
+    static const size_t PREPARE_STEP = 65536;      // One block erase per step
+    static const uint32_t PREPARE_STACK_SIZE = 2048;
+    static TaskHandle_t _runningDigestTask;
+    static uint8_t _runningDigest[32];
+    static volatile bool _runningDigestReady;
+    static const uint32_t RUNNING_DIGEST_STACK_SIZE = 4096;
+    static volatile uint32_t _imageCRC;
+    static MD5Builder _md5;
+    static String _expectedMD5;
+    static const char* _writeError;
+    static portMUX_TYPE _commitLock;
+    static bool _blockMode;
+    static const uint32_t BLOCK_MAGIC = 0x4B4C424F;   // "OBLK"
+    static Metrics _metrics;
+    static unsigned long _metricsStart;
+    static uint32_t _lastWriteEnd;
+    static unsigned long _rateWindowStart;
+    static size_t _rateWindowBytes;
+    static const unsigned long RATE_WINDOW_MS = 1000;
+    static bool _resumeAvailable;
+
+    static const size_t INFLATE_DICT_SIZE = 32768;     // Deflate window
+    static bool _compressionEnabled;
+    static struct tinfl_decompressor_tag* _inflator;
+    static uint8_t* _dictionary;
+    static size_t _dictOffset;
+    static Encoding _encoding;
+    static bool _inflating;
+    static bool _inflateDone;
+    static uint8_t _gzipState;
+    static uint8_t _gzipFlags;
+    static uint16_t _gzipField;
+    static uint8_t _gzipPos;
+    static uint8_t _gzipTrailer[8];
+    static uint8_t _gzipTrailerLen;
+    static uint32_t _inflateCRC;
+    static size_t _inflateSize;
+
+    static const size_t PATCH_HEADER_SIZE = 76;        // Magic, sizes and two SHA-256 digests
+    static const size_t PATCH_CONTROL_SIZE = 12;       // Diff length, extra length, seek
+    static const size_t PATCH_CHUNK_SIZE = 512;        // Source read granularity
+    static uint8_t _patchState;
+    static uint8_t _patchField[PATCH_HEADER_SIZE];
+    static size_t _patchFieldLen;
+    static uint8_t _patchSource[PATCH_CHUNK_SIZE];
+    static const esp_partition_t* _sourcePartition;
+    static size_t _sourceSize;
+    static size_t _sourceOffset;
+    static size_t _targetSize;
+    static size_t _patchOutput;
+    static size_t _patchRemaining;
+    static size_t _patchExtra;
+    static int32_t _patchSeek;
+    static uint8_t _targetDigest[32];
+
+    static mbedtls_sha256_context _imageHash;
+    static uint8_t _imageDigest[32];
+    static bool _digestReady;
+    static uint8_t _expectedDigest[32];
+    static bool _hasExpectedDigest;
+    static DigestVerifier _digestVerifier;
+
+    /**
+     * @brief Buffer hand-off between writeData() and the writer task
+     */
+    struct WriteJob {
+        uint8_t index;
+        size_t length;
+    };
+
+    static const size_t FLASH_SECTOR_SIZE = 4096;
+    static const size_t MAX_BUFFER_SIZE = 16 * FLASH_SECTOR_SIZE;
+    static const uint8_t MAX_WRITE_BUFFERS = 8;
+    static const uint32_t WRITER_TIMEOUT_MS = 10000;
+
+    static size_t _bufferSize;
+    static bool _asyncWrite;
+    static uint8_t _writeBufferCount;
+    static uint8_t* _writeBuffers[MAX_WRITE_BUFFERS];
+    static QueueHandle_t _freeQueue;
+    static QueueHandle_t _fullQueue;
+    static OTAArena::Region _bufferRegion;
+    static OTAArena::Region _freeQueueRegion;
+    static OTAArena::Region _fullQueueRegion;
+    static OTAArena::Region _inflatorRegion;
+    static OTAArena::Region _dictionaryRegion;
+    static TaskHandle_t _writerTask;
+    static volatile bool _writerFailed;
+    static int _fillIndex;
+    static size_t _fillLength;
+
+    static bool initBuffers(const Config& config);
+    static void releaseBuffers();
+    static QueueHandle_t createQueue(OTAArena::Region& region, UBaseType_t length, UBaseType_t itemSize);
+    static void writerTask(void* param);
+    static void prepareTask(void* param);
+    static void stopPrepare();
+    static void startRunningDigest();
+    static void runningDigestTask(void* param);
+    static size_t takePrepared(const esp_partition_t* partition);
+    static bool commitBuffer(uint8_t* buffer, size_t len);
+    static bool beginSession(size_t size, size_t offset, const String& md5);
+    static bool verifyCommitted(size_t offset, uint32_t expectedCRC);
+    static bool initInflater();
+    static void releaseInflater();
+    static void startInflate();
+    static bool inflateData(const uint8_t* data, size_t len);
+    static bool parseGzipHeader(const uint8_t*& data, size_t& len);
+    static uint8_t nextGzipState(uint8_t state);
+    static void recoverTrailer();
+    static bool checkGzipTrailer();
+    static bool decodeData(const uint8_t* data, size_t len);
+    static void startPatch();
+    static void endDigest();
+    static bool checkDigest();
+    static bool patchData(const uint8_t* data, size_t len);
+    static bool parsePatchHeader();
+    static void parsePatchControl();
+    static void advancePatch();
+    static bool patchOutput(const uint8_t* data, size_t len);
+    static bool checkPatch();
+    static bool queueData(const uint8_t* data, size_t len);
+    static bool acquireBuffer();
+    static bool submitBuffer();
+    static bool drainWriter(bool flushPartial = true);
+    static void failWrite(const String& message);
+    static bool finishBlockUpdate();
+    static bool blockSectorErased(size_t sector);
+    static void clearBlockSession();
+    static void startMetrics();
+    static void endMetrics();
+    static void recordChunk(size_t len, uint32_t enter);
 
+    static void persistProgress();
     static void saveToRTC();
     static bool loadFromRTC();
-    static void updateCallback(Status status, int progress, const String& message);
+    static bool initDispatcher(const DispatchPolicy& policy);
+    static void releaseDispatcher();
+    static void dispatchTask(void* param);
+    static void emitEvent(EventCode code, const char* message);
+    static void emitProgress();
+    static void deliverEvent(const Event& event);
+    static void flushEvents();
     static uint32_t calculateCRC();
 };
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/**
+ * @brief Internal helpers shared by the OTA modules
+ *
+ * Wire-format byte order, digest formatting and task creation used by
+ * OTACore and the transports built on it. Not part of the public API.
+ */
+class OTAUtil {
+public:
+    /**
+     * @brief Read a little-endian 32-bit value
+     * @param p First of four bytes
+     * @return Decoded value
+     */
+    static inline uint32_t readLE32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    /**
+     * @brief Write a little-endian 32-bit value
+     * @param p Receives four bytes
+     * @param value Value to encode
+     */
+    static inline void writeLE32(uint8_t* p, uint32_t value) {
+        p[0] = value & 0xFF;
+        p[1] = (value >> 8) & 0xFF;
+        p[2] = (value >> 16) & 0xFF;
+        p[3] = (value >> 24) & 0xFF;
+    }
+
+    /**
+     * @brief Format bytes as lowercase hex
+     * @param data Bytes to format
+     * @param len Number of bytes
+     * @param hex Receives 2 * len characters and a terminator
+     */
+    static inline void formatHex(const uint8_t* data, size_t len, char* hex) {
+        static const char digits[] = "0123456789abcdef";
+        for (size_t i = 0; i < len; i++) {
+            hex[2 * i] = digits[data[i] >> 4];
+            hex[2 * i + 1] = digits[data[i] & 0x0F];
+        }
+        hex[2 * len] = '\0';
+    }
+
+    /**
+     * @brief Start a task, pinned to a core where the chip has several
+     * @param task Task function
+     * @param name Task name
+     * @param stackSize Stack size in bytes
+     * @param priority Task priority
+     * @param handle Receives the task handle (nullptr on failure)
+     * @param core Core to pin to; out of range or single-core runs unpinned
+     * @return true if the task was created
+     */
+    static inline bool startTask(TaskFunction_t task, const char* name, uint32_t stackSize,
+                                 UBaseType_t priority, TaskHandle_t* handle, int core = -1) {
+#if CONFIG_FREERTOS_UNICORE
+        BaseType_t affinity = tskNO_AFFINITY;
+        (void)core;
+#else
+        BaseType_t affinity = (core >= 0 && core < portNUM_PROCESSORS) ? core : tskNO_AFFINITY;
+#endif
+
+        if (xTaskCreatePinnedToCore(task, name, stackSize, nullptr, priority, handle, affinity) != pdPASS) {
+            *handle = nullptr;
+            return false;
+        }
+        return true;
+    }
+};
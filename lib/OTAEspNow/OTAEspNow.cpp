@@ -0,0 +1,568 @@
+#include "OTAEspNow.h"
+#include "OTAUtil.h"
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/md.h>
+
+// Static member definitions
+const uint8_t OTAEspNow::FRAME_MAGIC[4] = {'O', 'N', 'W', '1'};
+OTAEspNow::Config OTAEspNow::_config;
+OTAEspNow::CallbackFunction OTAEspNow::_callback = nullptr;
+volatile bool OTAEspNow::_running = false;
+TaskHandle_t OTAEspNow::_task = nullptr;
+QueueHandle_t OTAEspNow::_rxQueue = nullptr;
+OTAEspNow::Stats OTAEspNow::_stats = {};
+String OTAEspNow::_lastError = "";
+uint8_t OTAEspNow::_frame[ESP_NOW_MAX_DATA_LEN] = {0};
+const esp_partition_t* OTAEspNow::_image = nullptr;
+size_t OTAEspNow::_imageSize = 0;
+uint8_t OTAEspNow::_imageDigest[32] = {0};
+bool OTAEspNow::_seeding = false;
+uint8_t OTAEspNow::_seedPeer[ESP_NOW_ETH_ALEN] = {0};
+size_t OTAEspNow::_sendOffset = 0;
+size_t OTAEspNow::_ackedOffset = 0;
+unsigned long OTAEspNow::_lastAck = 0;
+uint8_t OTAEspNow::_retries = 0;
+unsigned long OTAEspNow::_lastOffer = 0;
+bool OTAEspNow::_receiving = false;
+uint8_t OTAEspNow::_source[ESP_NOW_ETH_ALEN] = {0};
+uint32_t OTAEspNow::_sourceBuild = 0;
+size_t OTAEspNow::_expectedOffset = 0;
+size_t OTAEspNow::_receiveSize = 0;
+uint8_t OTAEspNow::_sinceAck = 0;
+unsigned long OTAEspNow::_lastData = 0;
+unsigned long OTAEspNow::_lastAckSent = 0;
+
+static const uint8_t BROADCAST_MAC[ESP_NOW_ETH_ALEN] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static String macToString(const uint8_t* mac) {
+    char text[18];
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(text);
+}
+
+bool OTAEspNow::begin(const Config& config) {
+    if (_running) {
+        Serial.println("[OTAEspNow] Transport already running");
+        return false;
+    }
+
+    // Without a key any radio in range could supply the digest it is checked against
+    if (config.sharedKey.length() == 0) {
+        _lastError = "sharedKey is required";
+        Serial.println("[OTAEspNow] " + _lastError);
+        return false;
+    }
+
+    _config = config;
+    if (_config.window == 0) {
+        _config.window = 1;
+    }
+
+    // ESP-NOW rides on the station interface, connected or not
+    if (WiFi.getMode() == WIFI_OFF) {
+        WiFi.mode(WIFI_STA);
+    }
+    if (_config.channel > 0 && WiFi.status() != WL_CONNECTED) {
+        esp_wifi_set_channel(_config.channel, WIFI_SECOND_CHAN_NONE);
+    }
+
+    if (esp_now_init() != ESP_OK) {
+        _lastError = "Failed to initialize ESP-NOW";
+        Serial.println("[OTAEspNow] " + _lastError);
+        return false;
+    }
+
+    _rxQueue = xQueueCreate(RX_QUEUE_LENGTH, sizeof(Frame));
+    if (!_rxQueue) {
+        esp_now_deinit();
+        _lastError = "Failed to allocate receive queue";
+        Serial.println("[OTAEspNow] " + _lastError);
+        return false;
+    }
+    if (!addPeer(BROADCAST_MAC)) {
+        _lastError = "Failed to allocate ESP-NOW resources";
+        Serial.println("[OTAEspNow] " + _lastError);
+        stop();
+        return false;
+    }
+    esp_now_register_recv_cb(onReceive);
+
+    // The offered digest is that of the installed .bin
+    _image = nullptr;
+    if (_config.seed) {
+        const esp_partition_t* running = esp_ota_get_running_partition();
+        _imageSize = ESP.getSketchSize();
+        if (running && _imageSize > 0 && OTACore::hashPartition(running, _imageSize, _imageDigest)) {
+            _image = running;
+        } else {
+            Serial.println("[OTAEspNow] Cannot read the running image, seeding disabled");
+        }
+    }
+
+    _seeding = false;
+    _receiving = false;
+    _lastOffer = millis() - _config.offerInterval;
+    _lastError = "";
+    _running = true;
+
+    if (!OTAUtil::startTask(transportTask, "ota_espnow", _config.taskStackSize, _config.taskPriority,
+                            &_task, _config.taskCore)) {
+        _lastError = "Failed to start transport task";
+        Serial.println("[OTAEspNow] " + _lastError);
+        stop();
+        return false;
+    }
+
+    Serial.println("[OTAEspNow] Transport started, build " + String(_config.firmwareBuild) +
+                   (_image ? ", seeding " + String(_imageSize) + " bytes" : String("")));
+    return true;
+}
+
+void OTAEspNow::stop() {
+    if (!_rxQueue) {
+        return;
+    }
+
+    // The task ends its transfers on the way out
+    _running = false;
+    while (_task) {
+        delay(10);
+    }
+
+    esp_now_unregister_recv_cb();
+    esp_now_deinit();
+    if (_rxQueue) {
+        vQueueDelete(_rxQueue);
+        _rxQueue = nullptr;
+    }
+    Serial.println("[OTAEspNow] Transport stopped");
+}
+
+void OTAEspNow::setCallback(CallbackFunction callback) {
+    _callback = callback;
+}
+
+bool OTAEspNow::isRunning() {
+    return _running;
+}
+
+bool OTAEspNow::isBusy() {
+    return _seeding || _receiving;
+}
+
+OTAEspNow::Stats OTAEspNow::getStats() {
+    return _stats;
+}
+
+String OTAEspNow::getLastError() {
+    return _lastError;
+}
+
+void OTAEspNow::onReceive(const uint8_t* mac, const uint8_t* data, int len) {
+    // WiFi task: copy the frame out and return
+    if (!_rxQueue || len < (int)HEADER_SIZE || len > ESP_NOW_MAX_DATA_LEN ||
+        memcmp(data, FRAME_MAGIC, sizeof(FRAME_MAGIC)) != 0) {
+        return;
+    }
+
+    Frame frame;
+    memcpy(frame.mac, mac, ESP_NOW_ETH_ALEN);
+    frame.len = len;
+    memcpy(frame.data, data, len);
+    if (xQueueSend(_rxQueue, &frame, 0) != pdTRUE) {
+        _stats.framesDropped++;
+    }
+}
+
+void OTAEspNow::transportTask(void* param) {
+    Frame frame;
+    while (_running) {
+        // Poll quickly while a window is open, slowly otherwise
+        TickType_t wait = _seeding ? pdMS_TO_TICKS(2) : pdMS_TO_TICKS(20);
+        if (xQueueReceive(_rxQueue, &frame, wait) == pdTRUE) {
+            _stats.framesReceived++;
+            handleFrame(frame);
+        }
+
+        serviceSeed();
+        serviceReceive();
+
+        if (_image && !_seeding && !OTACore::isActive() &&
+            millis() - _lastOffer >= _config.offerInterval) {
+            sendOffer();
+        }
+    }
+
+    if (_seeding) {
+        endSeed(false, "Transport stopped");
+    }
+    if (_receiving) {
+        endReceive(false, "Transport stopped");
+    }
+
+    _task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void OTAEspNow::handleFrame(const Frame& frame) {
+    switch (frame.data[4]) {
+        case FRAME_OFFER:
+            handleOffer(frame);
+            break;
+        case FRAME_REQUEST:
+            handleRequest(frame);
+            break;
+        case FRAME_DATA:
+            handleData(frame);
+            break;
+        case FRAME_ACK:
+            handleAck(frame);
+            break;
+        case FRAME_DONE:
+            handleDone(frame);
+            break;
+        case FRAME_BUSY:
+            if (_receiving && memcmp(frame.mac, _source, ESP_NOW_ETH_ALEN) == 0 && _expectedOffset == 0) {
+                endReceive(false, "Seeder busy");
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void OTAEspNow::handleOffer(const Frame& frame) {
+    if (frame.len < HEADER_SIZE + OFFER_SIZE || !_config.accept || _receiving || OTACore::isActive()) {
+        return;
+    }
+
+    const uint8_t* body = frame.data + HEADER_SIZE;
+    uint32_t build = OTAUtil::readLE32(body);
+    uint32_t size = OTAUtil::readLE32(body + 4);
+    if (build <= _config.firmwareBuild) {
+        return;
+    }
+
+    // The digest is only as good as the key that signed it
+    uint8_t expected[32];
+    uint8_t diff = 0;
+    if (!signOffer(body, expected)) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(expected); i++) {
+        diff |= expected[i] ^ body[OFFER_SIGNED_SIZE + i];
+    }
+    if (diff != 0) {
+        _lastError = "Offer from " + macToString(frame.mac) + " failed authentication";
+        return;
+    }
+
+    if (!OTACore::startUpdate(size)) {
+        _lastError = OTACore::getLastError();
+        return;
+    }
+
+    char hex[65];
+    OTAUtil::formatHex(body + 8, 32, hex);
+    OTACore::setExpectedSHA256(String(hex));
+
+    if (!addPeer(frame.mac)) {
+        OTACore::abortUpdate();
+        _lastError = "Failed to add ESP-NOW peer";
+        return;
+    }
+
+    memcpy(_source, frame.mac, ESP_NOW_ETH_ALEN);
+    _sourceBuild = build;
+    _receiveSize = size;
+    _expectedOffset = 0;
+    _sinceAck = 0;
+    _lastData = millis();
+    _lastAckSent = 0;
+    _receiving = true;
+
+    uint8_t request[4];
+    OTAUtil::writeLE32(request, build);
+    sendFrame(_source, FRAME_REQUEST, request, sizeof(request));
+
+    Serial.println("[OTAEspNow] Receiving build " + String(build) + " (" + String(size) +
+                   " bytes) from " + macToString(_source));
+    sendEvent(Event::RECEIVE_STARTED, "Receiving from " + macToString(_source), size);
+}
+
+void OTAEspNow::handleRequest(const Frame& frame) {
+    if (frame.len < HEADER_SIZE + 4 || !_image) {
+        return;
+    }
+
+    // A repeated request from the current peer means our first frames were lost
+    if (_seeding) {
+        if (memcmp(frame.mac, _seedPeer, ESP_NOW_ETH_ALEN) == 0) {
+            _sendOffset = _ackedOffset;
+            return;
+        }
+        if (addPeer(frame.mac)) {
+            sendFrame(frame.mac, FRAME_BUSY);
+        }
+        return;
+    }
+
+    if (OTAUtil::readLE32(frame.data + HEADER_SIZE) != _config.firmwareBuild || !addPeer(frame.mac)) {
+        return;
+    }
+
+    memcpy(_seedPeer, frame.mac, ESP_NOW_ETH_ALEN);
+    _sendOffset = 0;
+    _ackedOffset = 0;
+    _retries = 0;
+    _lastAck = millis();
+    _seeding = true;
+
+    Serial.println("[OTAEspNow] Seeding " + macToString(_seedPeer));
+    sendEvent(Event::SEED_STARTED, "Seeding " + macToString(_seedPeer), _imageSize);
+}
+
+void OTAEspNow::handleData(const Frame& frame) {
+    if (!_receiving || frame.len <= DATA_HEADER_SIZE ||
+        memcmp(frame.mac, _source, ESP_NOW_ETH_ALEN) != 0) {
+        return;
+    }
+
+    size_t offset = OTAUtil::readLE32(frame.data + HEADER_SIZE);
+    size_t len = frame.len - DATA_HEADER_SIZE;
+    _lastData = millis();
+
+    // Out of sequence: repeat the cumulative ack so the seeder rewinds
+    if (offset != _expectedOffset || offset + len > _receiveSize) {
+        if (millis() - _lastAckSent >= _config.ackTimeout / 2) {
+            sendAck();
+        }
+        return;
+    }
+
+    if (OTACore::writeData((uint8_t*)frame.data + DATA_HEADER_SIZE, len) != (int)len) {
+        endReceive(false, "Write error: " + OTACore::getLastError());
+        return;
+    }
+    _expectedOffset += len;
+
+    if (_expectedOffset >= _receiveSize) {
+        sendAck();
+        bool success = OTACore::finishUpdate();
+        uint8_t result[4] = {(uint8_t)(success ? 0 : 1), 0, 0, 0};
+        sendFrame(_source, FRAME_DONE, result, sizeof(result));
+        endReceive(success, success ? String("Image received") : "Update failed: " + OTACore::getLastError());
+        return;
+    }
+
+    // Ack twice per window so the seeder never stalls on a full window
+    if (++_sinceAck >= (_config.window + 1) / 2) {
+        sendAck();
+    }
+}
+
+void OTAEspNow::handleAck(const Frame& frame) {
+    if (!_seeding || frame.len < HEADER_SIZE + 4 ||
+        memcmp(frame.mac, _seedPeer, ESP_NOW_ETH_ALEN) != 0) {
+        return;
+    }
+
+    size_t offset = OTAUtil::readLE32(frame.data + HEADER_SIZE);
+    if (offset > _imageSize) {
+        return;
+    }
+
+    if (offset > _ackedOffset) {
+        _ackedOffset = offset;
+        _retries = 0;
+        _lastAck = millis();
+    } else if (offset == _ackedOffset && _sendOffset > _ackedOffset) {
+        // Duplicate ack: the frame at the acked offset was lost
+        _sendOffset = _ackedOffset;
+    }
+}
+
+void OTAEspNow::handleDone(const Frame& frame) {
+    if (!_seeding || frame.len < HEADER_SIZE + 1 ||
+        memcmp(frame.mac, _seedPeer, ESP_NOW_ETH_ALEN) != 0) {
+        return;
+    }
+
+    if (frame.data[HEADER_SIZE] == 0) {
+        _stats.imagesSent++;
+        endSeed(true, "Neighbour updated");
+    } else {
+        endSeed(false, "Neighbour rejected the image");
+    }
+}
+
+void OTAEspNow::serviceSeed() {
+    if (!_seeding) {
+        return;
+    }
+
+    // Everything acked; the neighbour verifies the image before it answers
+    if (_ackedOffset >= _imageSize) {
+        if (millis() - _lastAck >= _config.receiveTimeout) {
+            endSeed(false, "No result from neighbour");
+        }
+        return;
+    }
+
+    if (millis() - _lastAck >= _config.ackTimeout) {
+        if (++_retries > _config.maxRetries) {
+            endSeed(false, "Neighbour stopped responding");
+            return;
+        }
+        if (_sendOffset > _ackedOffset) {
+            _stats.retransmits++;
+        }
+        _sendOffset = _ackedOffset;
+        _lastAck = millis();
+    }
+
+    size_t windowEnd = _ackedOffset + (size_t)_config.window * CHUNK_SIZE;
+    while (_sendOffset < _imageSize && _sendOffset < windowEnd) {
+        size_t len = _imageSize - _sendOffset < CHUNK_SIZE ? _imageSize - _sendOffset : CHUNK_SIZE;
+
+        memcpy(_frame, FRAME_MAGIC, sizeof(FRAME_MAGIC));
+        _frame[4] = FRAME_DATA;
+        _frame[5] = 0;
+        _frame[6] = 0;
+        _frame[7] = 0;
+        OTAUtil::writeLE32(_frame + HEADER_SIZE, _sendOffset);
+        if (esp_partition_read(_image, _sendOffset, _frame + DATA_HEADER_SIZE, len) != ESP_OK) {
+            endSeed(false, "Failed to read the running image");
+            return;
+        }
+
+        // A full ESP-NOW queue is retried on the next pass
+        if (esp_now_send(_seedPeer, _frame, DATA_HEADER_SIZE + len) != ESP_OK) {
+            break;
+        }
+        _stats.framesSent++;
+        _sendOffset += len;
+    }
+}
+
+void OTAEspNow::serviceReceive() {
+    if (!_receiving) {
+        return;
+    }
+
+    unsigned long idle = millis() - _lastData;
+    if (idle >= _config.receiveTimeout) {
+        endReceive(false, "Seeder stopped sending at " + String(_expectedOffset) + "/" + String(_receiveSize));
+        return;
+    }
+
+    // Re-ack while stalled, in case the seeder lost the last ack or the request
+    if (idle >= _config.ackTimeout && millis() - _lastAckSent >= _config.ackTimeout) {
+        if (_expectedOffset == 0) {
+            uint8_t request[4];
+            OTAUtil::writeLE32(request, _sourceBuild);
+            sendFrame(_source, FRAME_REQUEST, request, sizeof(request));
+            _lastAckSent = millis();
+        } else {
+            sendAck();
+        }
+    }
+}
+
+void OTAEspNow::sendOffer() {
+    uint8_t body[OFFER_SIZE];
+    OTAUtil::writeLE32(body, _config.firmwareBuild);
+    OTAUtil::writeLE32(body + 4, _imageSize);
+    memcpy(body + 8, _imageDigest, sizeof(_imageDigest));
+    if (!signOffer(body, body + OFFER_SIGNED_SIZE)) {
+        return;
+    }
+    sendFrame(BROADCAST_MAC, FRAME_OFFER, body, sizeof(body));
+    _lastOffer = millis();
+}
+
+void OTAEspNow::sendAck() {
+    uint8_t body[4];
+    OTAUtil::writeLE32(body, _expectedOffset);
+    sendFrame(_source, FRAME_ACK, body, sizeof(body));
+    _sinceAck = 0;
+    _lastAckSent = millis();
+}
+
+void OTAEspNow::endSeed(bool success, const String& message) {
+    _seeding = false;
+    esp_now_del_peer(_seedPeer);
+    _lastOffer = millis();
+
+    Serial.println("[OTAEspNow] Seeding " + macToString(_seedPeer) + " ended: " + message);
+    if (success) {
+        sendEvent(Event::SEED_COMPLETE, message, _stats.imagesSent);
+    } else {
+        _lastError = message;
+        sendEvent(Event::SEED_FAILED, message);
+    }
+}
+
+void OTAEspNow::endReceive(bool success, const String& message) {
+    _receiving = false;
+    esp_now_del_peer(_source);
+
+    if (success) {
+        // OTACore reboots into the new image after its completion delay
+        Serial.println("[OTAEspNow] " + message);
+        sendEvent(Event::RECEIVE_COMPLETE, message, 100);
+        return;
+    }
+
+    if (OTACore::isActive()) {
+        OTACore::abortUpdate();
+    }
+    _lastError = message;
+    Serial.println("[OTAEspNow] Receive failed: " + message);
+    sendEvent(Event::RECEIVE_FAILED, message);
+}
+
+bool OTAEspNow::sendFrame(const uint8_t* mac, uint8_t type, const uint8_t* body, size_t len) {
+    memcpy(_frame, FRAME_MAGIC, sizeof(FRAME_MAGIC));
+    _frame[4] = type;
+    _frame[5] = 0;
+    _frame[6] = 0;
+    _frame[7] = 0;
+    if (len > 0) {
+        memcpy(_frame + HEADER_SIZE, body, len);
+    }
+
+    if (esp_now_send(mac, _frame, HEADER_SIZE + len) != ESP_OK) {
+        return false;
+    }
+    _stats.framesSent++;
+    return true;
+}
+
+bool OTAEspNow::addPeer(const uint8_t* mac) {
+    if (esp_now_is_peer_exist(mac)) {
+        return true;
+    }
+
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, mac, ESP_NOW_ETH_ALEN);
+    peer.channel = 0;                  // Current channel
+    peer.ifidx = WIFI_IF_STA;
+    peer.encrypt = false;
+    return esp_now_add_peer(&peer) == ESP_OK;
+}
+
+bool OTAEspNow::signOffer(const uint8_t* body, uint8_t mac[32]) {
+    const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    return info && mbedtls_md_hmac(info, (const uint8_t*)_config.sharedKey.c_str(), _config.sharedKey.length(),
+                                   body, OFFER_SIGNED_SIZE, mac) == 0;
+}
+
+void OTAEspNow::sendEvent(Event event, const String& message, int value) {
+    if (_callback) {
+        _callback(event, message, value);
+    }
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <esp_now.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "OTACore.h"
+
+/**
+ * @brief Peer-to-peer OTA over ESP-NOW
+ *
+ * A node that runs a newer build offers its running image to neighbours by
+ * periodic broadcast. A node with an older build answers the offer and the
+ * image is streamed to it as unicast frames in a sliding window, with
+ * cumulative acknowledgements and go-back-N retransmission, straight into
+ * OTACore::writeData(). The stream is checked against the SHA-256 from the
+ * offer before the boot partition is switched. Once rebooted, the updated
+ * node offers the image itself, so an update spreads node to node without
+ * every node reaching the access point.
+ *
+ * Offers are broadcast, which ESP-NOW cannot encrypt, so each offer carries
+ * an HMAC-SHA256 of its build, size and digest under a pre-shared key. Only
+ * offers with a valid HMAC are answered, which makes the digest the image
+ * is checked against as trustworthy as the key. Installing is opt-in.
+ *
+ * ESP-NOW only reaches peers on the same channel; with WiFi connected that
+ * is the AP channel.
+ */
+class OTAEspNow {
+public:
+    /**
+     * @brief ESP-NOW transport configuration structure
+     */
+    struct Config {
+        uint32_t firmwareBuild;            // Build number of the running image; higher wins
+        bool seed;                         // Offer the running image to neighbours
+        bool accept;                       // Install newer images offered by neighbours
+        String sharedKey;                  // Pre-shared key authenticating offers (required)
+        uint8_t channel;                   // WiFi channel (0 = current channel)
+        uint8_t window;                    // Data frames in flight before an acknowledgement
+        unsigned long offerInterval;       // Offer broadcast interval in ms
+        unsigned long ackTimeout;          // Retransmit the window after this long without an ack
+        uint8_t maxRetries;                // Give up a peer after this many timeouts in a row
+        unsigned long receiveTimeout;      // Abort a download after this long without data
+        uint32_t taskStackSize;            // Transport task stack size
+        UBaseType_t taskPriority;          // Transport task priority
+        int taskCore;                      // Core the transport task is pinned to
+
+        // Constructor with default values
+        Config() : firmwareBuild(0), seed(true), accept(false), sharedKey(""), channel(0), window(16),
+                   offerInterval(3000), ackTimeout(250), maxRetries(12), receiveTimeout(10000),
+                   taskStackSize(6144), taskPriority(1),
+                   taskCore(ARDUINO_RUNNING_CORE == 0 ? 1 : 0) {}
+    };
+
+    /**
+     * @brief Transport event types
+     */
+    enum class Event {
+        RECEIVE_STARTED,
+        RECEIVE_COMPLETE,
+        RECEIVE_FAILED,
+        SEED_STARTED,
+        SEED_COMPLETE,
+        SEED_FAILED
+    };
+
+    /**
+     * @brief Transport statistics
+     */
+    struct Stats {
+        uint32_t framesSent;               // Frames handed to ESP-NOW
+        uint32_t framesReceived;           // Valid frames received
+        uint32_t framesDropped;            // Frames lost to a full receive queue
+        uint32_t retransmits;              // Windows sent again after a timeout
+        uint32_t imagesSent;               // Neighbours updated from this node
+    };
+
+    /**
+     * @brief Transport event callback function type
+     */
+    typedef std::function<void(Event event, const String& message, int value)> CallbackFunction;
+
+    /**
+     * @brief Initialize ESP-NOW and start the transport task
+     * @param config Transport configuration
+     * @return true if the transport was started
+     */
+    static bool begin(const Config& config);
+
+    /**
+     * @brief Stop the transport; a download in progress is aborted
+     */
+    static void stop();
+
+    /**
+     * @brief Set event callback
+     * @param callback Function to call on transport events
+     */
+    static void setCallback(CallbackFunction callback);
+
+    /**
+     * @brief Check if the transport is running
+     * @return true between begin() and stop()
+     */
+    static bool isRunning();
+
+    /**
+     * @brief Check if an image is being received or sent
+     * @return true while a transfer is in progress
+     */
+    static bool isBusy();
+
+    /**
+     * @brief Get transport statistics
+     * @return Statistics snapshot
+     */
+    static Stats getStats();
+
+    /**
+     * @brief Get last error message
+     * @return Error message string
+     */
+    static String getLastError();
+
+private:
+    /**
+     * @brief Received frame, copied out of the WiFi task
+     */
+    struct Frame {
+        uint8_t mac[ESP_NOW_ETH_ALEN];
+        uint8_t len;
+        uint8_t data[ESP_NOW_MAX_DATA_LEN];
+    };
+
+    // Wire format, little-endian
+    static const uint8_t FRAME_MAGIC[4];
+    static const size_t HEADER_SIZE = 8;           // magic, type, 3 reserved
+    static const size_t DATA_HEADER_SIZE = HEADER_SIZE + 4;
+    static const size_t CHUNK_SIZE = ESP_NOW_MAX_DATA_LEN - DATA_HEADER_SIZE;
+    static const uint8_t RX_QUEUE_LENGTH = 24;
+    static const size_t OFFER_SIGNED_SIZE = 40;    // build, size, sha256
+    static const size_t OFFER_SIZE = OFFER_SIGNED_SIZE + 32;
+
+    enum : uint8_t {
+        FRAME_OFFER = 1,                           // u32 build, u32 size, sha256, hmac-sha256
+        FRAME_REQUEST = 2,                         // u32 build
+        FRAME_DATA = 3,                            // u32 offset, bytes
+        FRAME_ACK = 4,                             // u32 next expected offset
+        FRAME_DONE = 5,                            // u8 result (0 = installed)
+        FRAME_BUSY = 6                             // seeder is serving another peer
+    };
+
+    static Config _config;
+    static CallbackFunction _callback;
+    static volatile bool _running;
+    static TaskHandle_t _task;
+    static QueueHandle_t _rxQueue;
+    static Stats _stats;
+    static String _lastError;
+    static uint8_t _frame[ESP_NOW_MAX_DATA_LEN];
+
+    // Seeding the running image
+    static const esp_partition_t* _image;
+    static size_t _imageSize;
+    static uint8_t _imageDigest[32];
+    static bool _seeding;
+    static uint8_t _seedPeer[ESP_NOW_ETH_ALEN];
+    static size_t _sendOffset;
+    static size_t _ackedOffset;
+    static unsigned long _lastAck;
+    static uint8_t _retries;
+    static unsigned long _lastOffer;
+
+    // Receiving a newer image
+    static bool _receiving;
+    static uint8_t _source[ESP_NOW_ETH_ALEN];
+    static uint32_t _sourceBuild;
+    static size_t _expectedOffset;
+    static size_t _receiveSize;
+    static uint8_t _sinceAck;
+    static unsigned long _lastData;
+    static unsigned long _lastAckSent;
+
+    static void onReceive(const uint8_t* mac, const uint8_t* data, int len);
+    static void transportTask(void* param);
+    static void handleFrame(const Frame& frame);
+    static void handleOffer(const Frame& frame);
+    static void handleRequest(const Frame& frame);
+    static void handleData(const Frame& frame);
+    static void handleAck(const Frame& frame);
+    static void handleDone(const Frame& frame);
+    static void serviceSeed();
+    static void serviceReceive();
+    static void sendOffer();
+    static void sendAck();
+    static void endSeed(bool success, const String& message);
+    static void endReceive(bool success, const String& message);
+    static bool sendFrame(const uint8_t* mac, uint8_t type, const uint8_t* body = nullptr, size_t len = 0);
+    static bool addPeer(const uint8_t* mac);
+    static bool signOffer(const uint8_t* body, uint8_t mac[32]);
+    static void sendEvent(Event event, const String& message = "", int value = 0);
+};
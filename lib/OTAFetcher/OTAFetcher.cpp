@@ -0,0 +1,498 @@
+#include "OTAFetcher.h"
+#include "OTAUtil.h"
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+
+// Static member definitions
+OTAFetcher::Config OTAFetcher::_config;
+OTAFetcher::CallbackFunction OTAFetcher::_callback = nullptr;
+bool OTAFetcher::_initialized = false;
+volatile bool OTAFetcher::_busy = false;
+volatile bool OTAFetcher::_stopRequested = false;
+TaskHandle_t OTAFetcher::_task = nullptr;
+OTAFetcher::Result OTAFetcher::_lastResult = Result::NONE;
+char OTAFetcher::_lastError[96] = "";
+portMUX_TYPE OTAFetcher::_errorLock = portMUX_INITIALIZER_UNLOCKED;
+String OTAFetcher::_etag = "";
+String OTAFetcher::_stagedETag = "";
+char OTAFetcher::_stagedSlot[17] = "";
+volatile bool OTAFetcher::_stagedChanged = false;
+unsigned long OTAFetcher::_stagedCheck = 0;
+OTAArena::Region OTAFetcher::_bufferRegion;
+unsigned long OTAFetcher::_lastCheck = 0;
+
+static const char* PREFS_NAMESPACE = "ota_fetch";
+static const char* PREFS_ETAG = "etag";
+static const char* PREFS_PENDING = "pending";
+static const char* PREFS_STAGED = "staged";
+static const char* PREFS_STAGED_SLOT = "staged_slot";
+static const unsigned long STAGED_CHECK_INTERVAL_MS = 1000;
+
+bool OTAFetcher::begin(const Config& config) {
+    if (config.url.length() == 0) {
+        Serial.println("[OTAFetcher] Firmware URL is required");
+        return false;
+    }
+
+    // The download task reads the config; let it finish before replacing it
+    if (_busy) {
+        stop();
+    }
+
+    _config = config;
+
+#if OTA_STATIC_MEMORY
+    // Set aside now so a fetch late in uptime never depends on the heap
+    if (!OTAArena::claim(_bufferRegion, _config.chunkSize)) {
+        Serial.println("[OTAFetcher] Download buffer does not fit the arena");
+        return false;
+    }
+#endif
+
+    _initialized = true;
+    _lastResult = Result::NONE;
+    setError("");
+    _lastCheck = millis();
+
+    String pending;
+    loadETags(_etag, pending);
+    loadStagedETag();
+
+    Serial.println("[OTAFetcher] Fetcher initialized for " + _config.url);
+    if (_config.checkInterval > 0) {
+        Serial.println("[OTAFetcher] Checking every " + String(_config.checkInterval) + "ms");
+    }
+    return true;
+}
+
+void OTAFetcher::stop() {
+    _initialized = false;
+
+    if (_busy) {
+        // The download loop suspends the update so the next check resumes it
+        _stopRequested = true;
+        if (_task && xTaskGetCurrentTaskHandle() == _task) {
+            return; // Called from an event callback; the task ends on its own
+        }
+        while (_busy) {
+            delay(10);
+        }
+    }
+    _stopRequested = false;
+    Serial.println("[OTAFetcher] Fetcher stopped");
+}
+
+void OTAFetcher::setCallback(CallbackFunction callback) {
+    _callback = callback;
+}
+
+bool OTAFetcher::fetchNow() {
+    if (!_initialized || _busy) {
+        return false;
+    }
+
+    if (OTACore::isActive()) {
+        setError("OTA already in progress");
+        return false;
+    }
+
+    _busy = true;
+    _stopRequested = false;
+    _lastCheck = millis();
+
+    if (!OTAUtil::startTask(fetchTask, "ota_fetch", _config.taskStackSize, _config.taskPriority,
+                            &_task, _config.taskCore)) {
+        _busy = false;
+        setError("Failed to start download task");
+        return false;
+    }
+
+    return true;
+}
+
+void OTAFetcher::handle() {
+    if (!_initialized || _busy) {
+        return;
+    }
+
+    if (_stagedChanged) {
+        _stagedChanged = false;
+        loadStagedETag();
+    }
+    if (_stagedSlot[0] && millis() - _stagedCheck >= STAGED_CHECK_INTERVAL_MS) {
+        _stagedCheck = millis();
+        confirmStagedETag();
+    }
+
+    if (_config.checkInterval == 0) {
+        return;
+    }
+
+    if (millis() - _lastCheck >= _config.checkInterval) {
+        fetchNow();
+    }
+}
+
+bool OTAFetcher::isBusy() {
+    return _busy;
+}
+
+OTAFetcher::Result OTAFetcher::getLastResult() {
+    return _lastResult;
+}
+
+String OTAFetcher::getLastError() {
+    char error[sizeof(_lastError)];
+    portENTER_CRITICAL(&_errorLock);
+    memcpy(error, _lastError, sizeof(error));
+    portEXIT_CRITICAL(&_errorLock);
+    return String(error);
+}
+
+void OTAFetcher::setError(const String& error) {
+    // Written by the download task, read from any task
+    portENTER_CRITICAL(&_errorLock);
+    strlcpy(_lastError, error.c_str(), sizeof(_lastError));
+    portEXIT_CRITICAL(&_errorLock);
+}
+
+String OTAFetcher::getETag() {
+    return _etag;
+}
+
+OTAFetcher::Config OTAFetcher::getConfig() {
+    return _config;
+}
+
+void OTAFetcher::fetchTask(void* param) {
+    sendEvent(Event::CHECK_STARTED, "Checking " + _config.url);
+
+    _lastResult = fetch();
+
+    switch (_lastResult) {
+        case Result::UPDATED:
+            sendEvent(Event::DOWNLOAD_COMPLETE, "Firmware downloaded", 100);
+            break;
+        case Result::NOT_MODIFIED:
+        case Result::SAME_VERSION:
+        case Result::SAME_IMAGE:
+            Serial.println("[OTAFetcher] Firmware is up to date");
+            sendEvent(Event::UP_TO_DATE, "Firmware is up to date");
+            break;
+        case Result::FAILED: {
+            String error = getLastError();
+            Serial.println("[OTAFetcher] Fetch failed: " + error);
+            sendEvent(Event::DOWNLOAD_FAILED, error);
+            break;
+        }
+        default:
+            break;
+    }
+
+    // Nothing below may touch _config: begin() replaces it once _busy drops
+    _task = nullptr;
+    _busy = false;
+    vTaskDelete(nullptr);
+}
+
+OTAFetcher::Result OTAFetcher::fetch() {
+    if (WiFi.status() != WL_CONNECTED) {
+        setError("Network not connected");
+        return Result::FAILED;
+    }
+
+    String installed, pending;
+    loadETags(installed, pending);
+
+    // Continue an interrupted download of the same image with a Range request
+    OTACore::ResumeInfo resume = OTACore::getResumeInfo();
+    bool tryResume = resume.available && pending.length() > 0;
+
+    bool https = _config.url.startsWith("https://");
+    WiFiClient plainClient;
+    WiFiClientSecure secureClient;
+    if (https) {
+        if (_config.caCert) {
+            secureClient.setCACert(_config.caCert);
+        } else if (_config.insecure) {
+            secureClient.setInsecure();
+        } else {
+            setError("No CA certificate configured for https");
+            return Result::FAILED;
+        }
+    }
+    WiFiClient& client = https ? (WiFiClient&)secureClient : plainClient;
+
+    HTTPClient http;
+    http.useHTTP10(true); // No chunked encoding, so the body can be streamed as-is
+    http.setTimeout(_config.timeout);
+    if (!http.begin(client, _config.url)) {
+        setError("Invalid firmware URL");
+        return Result::FAILED;
+    }
+
+    const char* headerKeys[] = {"ETag", "X-Firmware-Version", "Content-Range", "X-Firmware-SHA256"};
+    http.collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+
+    // An image still awaiting its reboot or validation is not fetched twice
+    String known = installed;
+    if (_stagedETag.length() > 0 && _stagedETag != installed) {
+        if (known.length() > 0) known += ", ";
+        known += _stagedETag;
+    }
+    if (known.length() > 0) {
+        http.addHeader("If-None-Match", known);
+    }
+    if (_config.currentVersion.length() > 0) {
+        http.addHeader("X-Firmware-Version", _config.currentVersion);
+    }
+    if (tryResume) {
+        http.addHeader("Range", "bytes=" + String(resume.offset) + "-");
+        http.addHeader("If-Range", pending);
+    }
+
+    int code = http.GET();
+    if (code == HTTP_CODE_NOT_MODIFIED) {
+        http.end();
+        return Result::NOT_MODIFIED;
+    }
+
+    if (code != HTTP_CODE_OK && code != HTTP_CODE_PARTIAL_CONTENT) {
+        setError("HTTP " + String(code) + " " + http.errorToString(code));
+        http.end();
+        return Result::FAILED;
+    }
+
+    String version = http.header("X-Firmware-Version");
+    if (version.length() > 0 && version == _config.currentVersion) {
+        http.end();
+        return Result::SAME_VERSION;
+    }
+
+    String etag = http.header("ETag");
+    String digest = http.header("X-Firmware-SHA256");
+
+    // The same image may already be running or sit in the other slot
+    if (code == HTTP_CODE_OK && digest.length() > 0) {
+        OTACore::Installed match = OTACore::skipIfInstalled(digest);
+        if (match != OTACore::Installed::NONE) {
+            http.end();
+            saveETag(PREFS_PENDING, "");
+            stageETag(etag, match == OTACore::Installed::RUNNING ? esp_ota_get_running_partition()
+                                                                 : esp_ota_get_boot_partition());
+            return match == OTACore::Installed::RUNNING ? Result::SAME_IMAGE : Result::UPDATED;
+        }
+    }
+
+    int length = http.getSize();
+    size_t total = 0;
+    size_t received = 0;
+
+    if (code == HTTP_CODE_PARTIAL_CONTENT) {
+        // "bytes <start>-<end>/<total>"
+        String range = http.header("Content-Range");
+        int dash = range.indexOf('-');
+        int slash = range.indexOf('/');
+        size_t start = (dash > 6) ? strtoul(range.substring(6, dash).c_str(), nullptr, 10) : 0;
+        total = (slash > 0) ? strtoul(range.substring(slash + 1).c_str(), nullptr, 10) : 0;
+
+        if (!OTACore::resumeUpdate(total, start)) {
+            setError("Resume rejected: " + OTACore::getLastError());
+            saveETag(PREFS_PENDING, "");
+            http.end();
+            return Result::FAILED;
+        }
+        received = start;
+        Serial.println("[OTAFetcher] Resuming download at " + String(start) + "/" + String(total));
+    } else {
+        total = length > 0 ? (size_t)length : OTACore::getAvailableSize();
+        if (!OTACore::startUpdate(total)) {
+            setError("Failed to start OTA update: " + OTACore::getLastError());
+            http.end();
+            return Result::FAILED;
+        }
+        Serial.println("[OTAFetcher] Downloading " + String(total) + " bytes");
+    }
+
+    if (digest.length() > 0 && !OTACore::setExpectedSHA256(digest)) {
+        OTACore::abortUpdate();
+        setError("Invalid X-Firmware-SHA256 header");
+        http.end();
+        return Result::FAILED;
+    }
+
+    saveETag(PREFS_PENDING, etag);
+    sendEvent(Event::DOWNLOAD_STARTED, "Downloading " + _config.url, total);
+
+#if OTA_STATIC_MEMORY
+    uint8_t* buffer = (uint8_t*)OTAArena::claim(_bufferRegion, _config.chunkSize);
+#else
+    uint8_t* buffer = (uint8_t*)malloc(_config.chunkSize);
+#endif
+    if (!buffer) {
+        OTACore::abortUpdate();
+        setError("Failed to allocate download buffer");
+        http.end();
+        return Result::FAILED;
+    }
+
+    WiFiClient* stream = http.getStreamPtr();
+    unsigned long lastData = millis();
+    int lastProgress = -1;
+    bool failed = false;
+
+    while (length < 0 || received < total) {
+        if (_stopRequested) {
+            setError("Download stopped at " + String(received) + "/" + String(total));
+            failed = true;
+            break;
+        }
+
+        int available = stream->available();
+        if (available <= 0) {
+            if (!stream->connected()) {
+                // Unknown length bodies end when the server closes (HTTP/1.0)
+                if (length < 0) break;
+                setError("Connection closed at " + String(received) + "/" + String(total));
+                failed = true;
+                break;
+            }
+            if (millis() - lastData > _config.timeout) {
+                setError("Read timeout at " + String(received) + "/" + String(total));
+                failed = true;
+                break;
+            }
+            delay(1);
+            continue;
+        }
+
+        size_t want = (size_t)available < _config.chunkSize ? available : _config.chunkSize;
+        if (length >= 0 && total - received < want) {
+            want = total - received;
+        }
+
+        int got = stream->read(buffer, want);
+        if (got <= 0) {
+            continue;
+        }
+        lastData = millis();
+        received += got;
+
+        if (OTACore::writeData(buffer, got) != got) {
+            setError("Write error: " + OTACore::getLastError());
+            failed = true;
+            break;
+        }
+
+        int progress = total > 0 ? (received * 100) / total : 0;
+        if (progress != lastProgress) {
+            lastProgress = progress;
+            sendEvent(Event::DOWNLOAD_PROGRESS, "Download progress", progress);
+        }
+    }
+
+#if !OTA_STATIC_MEMORY
+    free(buffer);
+#endif
+    http.end();
+
+    if (failed) {
+        // Network failures stay resumable; write failures are final
+        if (OTACore::isActive()) {
+            OTACore::suspendUpdate();
+        }
+        return Result::FAILED;
+    }
+
+    if (!OTACore::finishUpdate()) {
+        setError("Update failed: " + OTACore::getLastError());
+        saveETag(PREFS_PENDING, "");
+        return Result::FAILED;
+    }
+
+    // Counts as installed only once the new image has been validated
+    saveETag(PREFS_PENDING, "");
+    stageETag(etag, esp_ota_get_boot_partition());
+    Serial.println("[OTAFetcher] Download completed" + (etag.length() > 0 ? ", ETag " + etag : String("")));
+    return Result::UPDATED;
+}
+
+void OTAFetcher::loadETags(String& installed, String& pending) {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, true)) {
+        installed = "";
+        pending = "";
+        return;
+    }
+    installed = prefs.getString(PREFS_ETAG, "");
+    pending = prefs.getString(PREFS_PENDING, "");
+    prefs.end();
+}
+
+void OTAFetcher::saveETag(const char* key, const String& etag) {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putString(key, etag);
+    prefs.end();
+}
+
+void OTAFetcher::stageETag(const String& etag, const esp_partition_t* slot) {
+    Preferences prefs;
+    if (!slot || !prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putString(PREFS_STAGED, etag);
+    prefs.putString(PREFS_STAGED_SLOT, slot->label);
+    prefs.end();
+    _stagedChanged = true; // Picked up by handle() once the task is done
+}
+
+void OTAFetcher::loadStagedETag() {
+    _stagedETag = "";
+    _stagedSlot[0] = '\0';
+
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, true)) {
+        return;
+    }
+    _stagedETag = prefs.getString(PREFS_STAGED, "");
+    prefs.getString(PREFS_STAGED_SLOT, _stagedSlot, sizeof(_stagedSlot));
+    prefs.end();
+}
+
+void OTAFetcher::confirmStagedETag() {
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    const esp_partition_t* boot = esp_ota_get_boot_partition();
+
+    if (running && strcmp(running->label, _stagedSlot) == 0) {
+        if (OTACore::isPendingVerify()) {
+            return; // Still on trial, a rollback would make it unknown again
+        }
+        _etag = _stagedETag;
+        saveETag(PREFS_ETAG, _etag);
+        Serial.println("[OTAFetcher] Image confirmed" + (_etag.length() > 0 ? ", ETag " + _etag : String("")));
+    } else if (boot && strcmp(boot->label, _stagedSlot) == 0) {
+        return; // Waiting for the reboot into the new image
+    } else {
+        Serial.println("[OTAFetcher] Downloaded image was not kept, ETag dropped");
+    }
+
+    Preferences prefs;
+    if (prefs.begin(PREFS_NAMESPACE, false)) {
+        prefs.remove(PREFS_STAGED);
+        prefs.remove(PREFS_STAGED_SLOT);
+        prefs.end();
+    }
+    _stagedETag = "";
+    _stagedSlot[0] = '\0';
+}
+
+void OTAFetcher::sendEvent(Event event, const String& message, int value) {
+    if (_callback) {
+        _callback(event, message, value);
+    }
+}
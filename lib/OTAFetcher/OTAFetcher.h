@@ -0,0 +1,163 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_ota_ops.h>
+#include "OTACore.h"
+
+/**
+ * @brief Pull-mode OTA: downloads firmware over HTTP(S) into OTACore
+ *
+ * Fetches an image from a URL in a background task and streams the
+ * response body into OTACore. ETag and version headers are used to skip
+ * images that are already installed, and interrupted downloads continue
+ * with a Range request.
+ */
+class OTAFetcher {
+public:
+    /**
+     * @brief Fetcher configuration structure
+     */
+    struct Config {
+        String url;                        // Firmware URL (http:// or https://)
+        String currentVersion;             // Running firmware version (optional)
+        unsigned long checkInterval;       // Periodic check interval in ms (0 = on demand only)
+        const char* caCert;                // PEM root CA for https (optional)
+        bool insecure;                     // Skip certificate validation when no CA is set
+        size_t chunkSize;                  // Socket read size
+        unsigned long timeout;             // Read timeout in milliseconds
+        uint32_t taskStackSize;            // Download task stack size
+        UBaseType_t taskPriority;          // Download task priority
+        int taskCore;                      // Core the download task is pinned to
+
+        // Constructor with default values
+        Config() : url(""), currentVersion(""), checkInterval(0), caCert(nullptr),
+                   insecure(false), chunkSize(4096), timeout(15000), taskStackSize(8192),
+                   taskPriority(1), taskCore(ARDUINO_RUNNING_CORE == 0 ? 1 : 0) {}
+    };
+
+    /**
+     * @brief Outcome of the last fetch
+     */
+    enum class Result {
+        NONE,
+        UPDATED,
+        NOT_MODIFIED,
+        SAME_VERSION,
+        SAME_IMAGE,
+        FAILED
+    };
+
+    /**
+     * @brief Fetcher event types
+     */
+    enum class Event {
+        CHECK_STARTED,
+        UP_TO_DATE,
+        DOWNLOAD_STARTED,
+        DOWNLOAD_PROGRESS,
+        DOWNLOAD_COMPLETE,
+        DOWNLOAD_FAILED
+    };
+
+    /**
+     * @brief Fetcher event callback function type
+     */
+    typedef std::function<void(Event event, const String& message, int value)> CallbackFunction;
+
+    /**
+     * @brief Initialize the fetcher
+     * @param config Fetcher configuration
+     * @return true if initialization successful
+     */
+    static bool begin(const Config& config);
+
+    /**
+     * @brief Stop periodic checks and any running download
+     *
+     * A running download is suspended so the next check can resume it;
+     * returns once the download task has exited.
+     */
+    static void stop();
+
+    /**
+     * @brief Set event callback
+     * @param callback Function to call on fetcher events
+     */
+    static void setCallback(CallbackFunction callback);
+
+    /**
+     * @brief Start a background fetch now
+     * @return true if the download task was started
+     */
+    static bool fetchNow();
+
+    /**
+     * @brief Schedule periodic checks (call from loop)
+     */
+    static void handle();
+
+    /**
+     * @brief Check if a fetch is running
+     * @return true while the download task is active
+     */
+    static bool isBusy();
+
+    /**
+     * @brief Get the outcome of the last fetch
+     * @return Last result
+     */
+    static Result getLastResult();
+
+    /**
+     * @brief Get last error message
+     * @return Error message string
+     */
+    static String getLastError();
+
+    /**
+     * @brief Get the ETag of the last installed image
+     *
+     * A downloaded image's ETag only counts as installed once that image
+     * runs and has been validated; a rejected image is fetched again.
+     *
+     * @return ETag string (empty if unknown)
+     */
+    static String getETag();
+
+    /**
+     * @brief Get fetcher configuration
+     * @return Current configuration
+     */
+    static Config getConfig();
+
+private:
+    static Config _config;
+    static CallbackFunction _callback;
+    static bool _initialized;
+    static volatile bool _busy;
+    static volatile bool _stopRequested;
+    static TaskHandle_t _task;
+    static Result _lastResult;
+    static char _lastError[96];
+    static portMUX_TYPE _errorLock;
+    static String _etag;
+    static String _stagedETag;
+    static char _stagedSlot[17];
+    static volatile bool _stagedChanged;
+    static unsigned long _stagedCheck;
+    static OTAArena::Region _bufferRegion;
+    static unsigned long _lastCheck;
+
+    static void fetchTask(void* param);
+    static Result fetch();
+    static void loadETags(String& installed, String& pending);
+    static void saveETag(const char* key, const String& etag);
+    static void stageETag(const String& etag, const esp_partition_t* slot);
+    static void loadStagedETag();
+    static void confirmStagedETag();
+    static void setError(const String& error);
+    static void sendEvent(Event event, const String& message = "", int value = 0);
+};
@@ -0,0 +1,128 @@
+#include "OTAJson.h"
+#include <stdarg.h>
+
+OTAJson::OTAJson(char* buffer, size_t size)
+    : _buffer(buffer), _size(size), _length(0), _overflow(false), _needComma(false) {
+    if (_size > 0) {
+        _buffer[0] = '\0';
+    } else {
+        _overflow = true;
+    }
+}
+
+OTAJson& OTAJson::beginObject(const char* key) {
+    if (key) {
+        appendKey(key);
+    } else if (_needComma) {
+        append(",");
+    }
+    append("{");
+    _needComma = false;
+    return *this;
+}
+
+OTAJson& OTAJson::endObject() {
+    append("}");
+    _needComma = true;
+    return *this;
+}
+
+OTAJson& OTAJson::addString(const char* key, const char* value) {
+    appendKey(key);
+    append("\"");
+
+    // Escape quotes, backslashes and control characters
+    for (const char* p = value ? value : ""; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            append("\\%c", c);
+        } else if (c < 0x20) {
+            append("\\u%04x", c);
+        } else {
+            append("%c", c);
+        }
+    }
+
+    append("\"");
+    return *this;
+}
+
+OTAJson& OTAJson::addBool(const char* key, bool value) {
+    appendKey(key);
+    append(value ? "true" : "false");
+    return *this;
+}
+
+OTAJson& OTAJson::addInt(const char* key, long value) {
+    appendKey(key);
+    append("%ld", value);
+    return *this;
+}
+
+OTAJson& OTAJson::addUInt(const char* key, unsigned long value) {
+    appendKey(key);
+    append("%lu", value);
+    return *this;
+}
+
+OTAJson& OTAJson::addHex(const char* key, uint64_t value) {
+    appendKey(key);
+    append("\"%llx\"", (unsigned long long)value);
+    return *this;
+}
+
+OTAJson& OTAJson::addIP(const char* key, const IPAddress& ip) {
+    appendKey(key);
+    append("\"%u.%u.%u.%u\"", ip[0], ip[1], ip[2], ip[3]);
+    return *this;
+}
+
+OTAJson& OTAJson::addUIntArray(const char* key, const uint32_t* values, size_t count) {
+    appendKey(key);
+    append("[");
+    for (size_t i = 0; i < count; i++) {
+        append(i > 0 ? ",%lu" : "%lu", (unsigned long)values[i]);
+    }
+    append("]");
+    return *this;
+}
+
+const char* OTAJson::c_str() const {
+    return _buffer;
+}
+
+size_t OTAJson::length() const {
+    return _length;
+}
+
+bool OTAJson::overflow() const {
+    return _overflow;
+}
+
+void OTAJson::append(const char* format, ...) {
+    if (_overflow) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(_buffer + _length, _size - _length, format, args);
+    va_end(args);
+
+    if (written < 0 || (size_t)written >= _size - _length) {
+        // Keep the output terminated after the last write that fit; this can
+        // be inside a string or key, so callers must check overflow()
+        _buffer[_length] = '\0';
+        _overflow = true;
+        return;
+    }
+    _length += written;
+}
+
+void OTAJson::appendKey(const char* key) {
+    if (_needComma) {
+        append(",");
+    }
+    append("\"%s\":", key);
+    _needComma = true;
+}
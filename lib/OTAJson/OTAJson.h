@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Arduino.h>
+#include <IPAddress.h>
+
+/**
+ * @brief Fixed-buffer JSON writer
+ *
+ * Renders JSON objects directly into a caller-provided buffer with
+ * snprintf, so status responses need no heap allocation. Output that
+ * does not fit is cut off wherever the buffer ran out, possibly inside a
+ * string, and reported by overflow(); truncated output is not valid JSON.
+ */
+class OTAJson {
+public:
+    /**
+     * @brief Create a writer over a buffer
+     * @param buffer Destination buffer
+     * @param size Buffer size in bytes (including the terminator)
+     */
+    OTAJson(char* buffer, size_t size);
+
+    /**
+     * @brief Open an object, nested under @p key when given
+     * @param key Member name (nullptr for the top-level object)
+     * @return Writer for chaining
+     */
+    OTAJson& beginObject(const char* key = nullptr);
+
+    /**
+     * @brief Close the innermost object
+     * @return Writer for chaining
+     */
+    OTAJson& endObject();
+
+    /**
+     * @brief Add an escaped string member
+     * @param key Member name
+     * @param value String value (nullptr is written as "")
+     * @return Writer for chaining
+     */
+    OTAJson& addString(const char* key, const char* value);
+
+    /**
+     * @brief Add a boolean member
+     * @param key Member name
+     * @param value Boolean value
+     * @return Writer for chaining
+     */
+    OTAJson& addBool(const char* key, bool value);
+
+    /**
+     * @brief Add a signed integer member
+     * @param key Member name
+     * @param value Integer value
+     * @return Writer for chaining
+     */
+    OTAJson& addInt(const char* key, long value);
+
+    /**
+     * @brief Add an unsigned integer member
+     * @param key Member name
+     * @param value Integer value
+     * @return Writer for chaining
+     */
+    OTAJson& addUInt(const char* key, unsigned long value);
+
+    /**
+     * @brief Add a value as a lowercase hex string member
+     * @param key Member name
+     * @param value Value to format
+     * @return Writer for chaining
+     */
+    OTAJson& addHex(const char* key, uint64_t value);
+
+    /**
+     * @brief Add an IPv4 address as a dotted string member
+     * @param key Member name
+     * @param ip Address to format
+     * @return Writer for chaining
+     */
+    OTAJson& addIP(const char* key, const IPAddress& ip);
+
+    /**
+     * @brief Add an array of unsigned integers as a member
+     * @param key Member name
+     * @param values Values to write
+     * @param count Number of values
+     * @return Writer for chaining
+     */
+    OTAJson& addUIntArray(const char* key, const uint32_t* values, size_t count);
+
+    /**
+     * @brief Get the rendered JSON
+     * @return Null-terminated output
+     */
+    const char* c_str() const;
+
+    /**
+     * @brief Get the rendered length
+     * @return Length in bytes, excluding the terminator
+     */
+    size_t length() const;
+
+    /**
+     * @brief Check if output was truncated
+     * @return true if the buffer was too small
+     */
+    bool overflow() const;
+
+private:
+    char* _buffer;
+    size_t _size;
+    size_t _length;
+    bool _overflow;
+    bool _needComma;
+
+    void append(const char* format, ...);
+    void appendKey(const char* key);
+};
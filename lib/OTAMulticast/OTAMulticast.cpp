@@ -0,0 +1,474 @@
+#include "OTAMulticast.h"
+#include "OTAUtil.h"
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_wifi.h>
+#include <mbedtls/md.h>
+
+// Static member definitions
+const uint8_t OTAMulticast::PACKET_MAGIC[4] = {'O', 'M', 'C', '1'};
+OTAMulticast::Config OTAMulticast::_config;
+OTAMulticast::CallbackFunction OTAMulticast::_callback = nullptr;
+WiFiUDP OTAMulticast::_udp;
+volatile bool OTAMulticast::_running = false;
+TaskHandle_t OTAMulticast::_task = nullptr;
+bool OTAMulticast::_sleepChanged = false;
+wifi_ps_type_t OTAMulticast::_savedSleep = WIFI_PS_MIN_MODEM;
+uint8_t OTAMulticast::_packet[OTAMulticast::MAX_PACKET_SIZE] = {0};
+uint32_t OTAMulticast::_sessionId = 0;
+bool OTAMulticast::_sessionActive = false;
+uint8_t OTAMulticast::_sessionResult = OTAMulticast::DONE_OK;
+bool OTAMulticast::_sessionDone = false;
+uint32_t OTAMulticast::_completedId = 0;
+IPAddress OTAMulticast::_coordinator;
+uint16_t OTAMulticast::_coordinatorPort = 0;
+unsigned long OTAMulticast::_replyAt = 0;
+bool OTAMulticast::_replyPending = false;
+unsigned long OTAMulticast::_lastPacket = 0;
+int OTAMulticast::_lastProgress = -1;
+OTAMulticast::Stats OTAMulticast::_stats = {};
+String OTAMulticast::_lastError = "";
+
+static const char* PREFS_NAMESPACE = "ota_mcast";
+static const char* PREFS_COMPLETED = "done";
+
+bool OTAMulticast::begin(const Config& config) {
+    if (_running) {
+        Serial.println("[OTAMulticast] Receiver already running");
+        return false;
+    }
+
+    if (WiFi.status() != WL_CONNECTED) {
+        _lastError = "Network not connected";
+        Serial.println("[OTAMulticast] " + _lastError);
+        return false;
+    }
+
+    if (config.sharedKey.length() == 0) {
+        _lastError = "sharedKey is required";
+        Serial.println("[OTAMulticast] " + _lastError);
+        return false;
+    }
+
+    _config = config;
+    if (!_udp.beginMulticast(_config.group, _config.port)) {
+        _lastError = "Failed to join multicast group";
+        Serial.println("[OTAMulticast] " + _lastError);
+        return false;
+    }
+
+    _sleepChanged = false;
+    if (_config.disableSleep) {
+        // Group frames are only buffered until the next DTIM beacon; stop() restores the mode
+        esp_wifi_get_ps(&_savedSleep);
+        esp_wifi_set_ps(WIFI_PS_NONE);
+        _sleepChanged = true;
+    }
+
+    loadCompleted();
+    _sessionActive = false;
+    _sessionDone = false;
+    _replyPending = false;
+    _lastError = "";
+    _running = true;
+
+    if (!OTAUtil::startTask(receiveTask, "ota_mcast", _config.taskStackSize, _config.taskPriority,
+                            &_task, _config.taskCore)) {
+        _running = false;
+        _udp.stop();
+        if (_sleepChanged) {
+            esp_wifi_set_ps(_savedSleep);
+            _sleepChanged = false;
+        }
+        _lastError = "Failed to start receive task";
+        Serial.println("[OTAMulticast] " + _lastError);
+        return false;
+    }
+
+    Serial.println("[OTAMulticast] Listening on " + _config.group.toString() + ":" + String(_config.port));
+    return true;
+}
+
+void OTAMulticast::stop() {
+    if (!_running) {
+        return;
+    }
+
+    // The task leaves the group and suspends its session on the way out
+    _running = false;
+    while (_task) {
+        delay(10);
+    }
+    if (_sleepChanged) {
+        esp_wifi_set_ps(_savedSleep);
+        _sleepChanged = false;
+    }
+    Serial.println("[OTAMulticast] Receiver stopped");
+}
+
+void OTAMulticast::setCallback(CallbackFunction callback) {
+    _callback = callback;
+}
+
+bool OTAMulticast::isRunning() {
+    return _running;
+}
+
+bool OTAMulticast::isBusy() {
+    return _sessionActive;
+}
+
+OTAMulticast::Stats OTAMulticast::getStats() {
+    Stats stats = _stats;
+    if (_sessionActive) {
+        stats.blocksReceived = OTACore::getBlocksReceived();
+        stats.blockCount = OTACore::getBlockCount();
+    }
+    return stats;
+}
+
+String OTAMulticast::getLastError() {
+    return _lastError;
+}
+
+void OTAMulticast::receiveTask(void* param) {
+    while (_running) {
+        int size = _udp.parsePacket();
+        if (size > 0) {
+            size_t len = _udp.read(_packet, sizeof(_packet));
+            // Oversized datagrams are truncated by read(); drop them
+            if ((size_t)size <= sizeof(_packet)) {
+                handlePacket(len);
+            } else {
+                _stats.invalid++;
+            }
+            continue;
+        }
+
+        if (_replyPending && (long)(millis() - _replyAt) >= 0) {
+            _replyPending = false;
+            sendReply();
+        }
+
+        // Keep what is in flash; a later announce of the same session resumes it
+        if (_sessionActive && millis() - _lastPacket > _config.sessionTimeout) {
+            _sessionActive = false;
+            _stats.blocksReceived = OTACore::getBlocksReceived();
+            _stats.blockCount = OTACore::getBlockCount();
+            if (OTACore::isBlockSession()) {
+                OTACore::suspendUpdate();
+            }
+            Serial.println("[OTAMulticast] Session timed out");
+            sendEvent(Event::SESSION_TIMEOUT, "Multicast session timed out", _stats.blocksReceived);
+        }
+
+        vTaskDelay(1);
+    }
+
+    if (_sessionActive && OTACore::isBlockSession()) {
+        OTACore::suspendUpdate();
+    }
+    _sessionActive = false;
+    _udp.stop();
+
+    _task = nullptr;
+    vTaskDelete(nullptr);
+}
+
+void OTAMulticast::handlePacket(size_t len) {
+    if (len < HEADER_SIZE || memcmp(_packet, PACKET_MAGIC, sizeof(PACKET_MAGIC)) != 0) {
+        _stats.invalid++;
+        return;
+    }
+
+    uint8_t type = _packet[4];
+    uint32_t sessionId = OTAUtil::readLE32(_packet + 8);
+    const uint8_t* body = _packet + HEADER_SIZE;
+    size_t bodyLen = len - HEADER_SIZE;
+    _stats.packets++;
+
+    switch (type) {
+        case PACKET_ANNOUNCE:
+            // Unsigned or forged announces neither start nor cancel a session
+            if (!authenticateAnnounce(len)) {
+                break;
+            }
+            // A replayed announce of the installed image must not cancel a rollout
+            if (_sessionActive && sessionId != _sessionId && sessionId == _completedId) {
+                break;
+            }
+            _coordinator = _udp.remoteIP();
+            _coordinatorPort = _udp.remotePort();
+            if (sessionId != _sessionId || (!_sessionActive && !_sessionDone)) {
+                _sessionId = sessionId;
+                handleAnnounce(body, bodyLen);
+            }
+            break;
+
+        case PACKET_DATA:
+            if (sessionId == _sessionId && _sessionActive) {
+                handleData(body, bodyLen);
+            }
+            break;
+
+        case PACKET_POLL:
+            // Replies go to the coordinator of the signed announce, not the poller
+            if (sessionId == _sessionId && (_sessionActive || _sessionDone)) {
+                scheduleReply();
+            }
+            break;
+
+        default:
+            // NACK and DONE from other devices, if the network loops them back
+            break;
+    }
+}
+
+bool OTAMulticast::authenticateAnnounce(size_t len) {
+    if (len < ANNOUNCE_SIZE) {
+        _stats.invalid++;
+        return false;
+    }
+
+    // Constant-time compare, so the HMAC cannot be guessed byte by byte
+    uint8_t expected[32];
+    if (!signAnnounce(_packet, expected)) {
+        return false;
+    }
+    uint8_t diff = 0;
+    for (size_t i = 0; i < sizeof(expected); i++) {
+        diff |= expected[i] ^ _packet[ANNOUNCE_SIGNED_SIZE + i];
+    }
+    if (diff != 0) {
+        _stats.rejected++;
+        _lastError = "Announce from " + _udp.remoteIP().toString() + " failed authentication";
+        return false;
+    }
+    return true;
+}
+
+bool OTAMulticast::signAnnounce(const uint8_t* packet, uint8_t mac[32]) {
+    const mbedtls_md_info_t* info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    return info && mbedtls_md_hmac(info, (const uint8_t*)_config.sharedKey.c_str(), _config.sharedKey.length(),
+                                   packet, ANNOUNCE_SIGNED_SIZE, mac) == 0;
+}
+
+void OTAMulticast::handleAnnounce(const uint8_t* body, size_t len) {
+    if (len < ANNOUNCE_SIZE - HEADER_SIZE) {
+        _stats.invalid++;
+        return;
+    }
+
+    uint32_t imageSize = OTAUtil::readLE32(body);
+    uint32_t blockSize = OTAUtil::readLE32(body + 4);
+    const uint8_t* digest = body + 12;
+
+    // A new signed announce supersedes the session in progress
+    if (_sessionActive && OTACore::isBlockSession()) {
+        OTACore::abortUpdate();
+    }
+
+    _stats = Stats();
+    _stats.sessionId = _sessionId;
+    _sessionActive = false;
+    _sessionDone = false;
+
+    // Already installed before the last reboot: only report back
+    if (_sessionId == _completedId) {
+        _sessionDone = true;
+        _sessionResult = DONE_OK;
+        return;
+    }
+
+    // Clear the error state a failed earlier session left behind
+    if (OTACore::getStatus() == OTACore::Status::ERROR) {
+        OTACore::abortUpdate();
+    }
+
+    if (blockSize > OTA_MULTICAST_MAX_BLOCK) {
+        _lastError = "Block size exceeds OTA_MULTICAST_MAX_BLOCK";
+    } else if (OTACore::isActive()) {
+        _lastError = "OTA already in progress";
+    } else if (!OTACore::startBlockUpdate(imageSize, blockSize, _sessionId)) {
+        _lastError = OTACore::getLastError();
+    } else {
+        char hex[65];
+        OTAUtil::formatHex(digest, 32, hex);
+        OTACore::setExpectedSHA256(String(hex));
+
+        _sessionActive = true;
+        _lastPacket = millis();
+        _lastProgress = -1;
+        _lastError = "";
+        Serial.println("[OTAMulticast] Joined session " + String(_sessionId, HEX) + ": " +
+                       String(imageSize) + " bytes, " + String(OTACore::getBlockCount()) + " blocks");
+        sendEvent(Event::SESSION_STARTED, "Multicast session started", imageSize);
+
+        // A resumed session may already hold every block
+        if (OTACore::nextMissingBlock(0) == OTACore::getBlockCount()) {
+            finishSession();
+        }
+        return;
+    }
+
+    // Tell the coordinator this device will not take part
+    Serial.println("[OTAMulticast] Cannot join session: " + _lastError);
+    _sessionDone = true;
+    _sessionResult = DONE_FAILED;
+    sendEvent(Event::SESSION_FAILED, _lastError);
+}
+
+void OTAMulticast::handleData(const uint8_t* body, size_t len) {
+    if (len < DATA_HEADER_SIZE - HEADER_SIZE + 1) {
+        _stats.invalid++;
+        return;
+    }
+
+    _lastPacket = millis();
+    uint32_t index = OTAUtil::readLE32(body);
+    int written = OTACore::writeBlock(index, body + 4, len - 4);
+    if (written == 0) {
+        _stats.duplicates++;
+        return;
+    }
+    if (written < 0) {
+        if (OTACore::isBlockSession()) {
+            // Malformed block; the session carries on
+            _stats.invalid++;
+            return;
+        }
+        _sessionActive = false;
+        _sessionDone = true;
+        _sessionResult = DONE_FAILED;
+        _lastError = OTACore::getLastError();
+        sendEvent(Event::SESSION_FAILED, _lastError);
+        scheduleReply();
+        return;
+    }
+
+    int progress = OTACore::getProgress();
+    if (progress != _lastProgress) {
+        _lastProgress = progress;
+        sendEvent(Event::SESSION_PROGRESS, "Multicast progress", progress);
+    }
+
+    if (OTACore::getBlocksReceived() == OTACore::getBlockCount()) {
+        finishSession();
+    }
+}
+
+void OTAMulticast::finishSession() {
+    _stats.blocksReceived = OTACore::getBlocksReceived();
+    _stats.blockCount = OTACore::getBlockCount();
+    _sessionActive = false;
+    _sessionDone = true;
+
+    if (OTACore::finishUpdate()) {
+        _sessionResult = DONE_OK;
+        saveCompleted(_sessionId);
+        Serial.println("[OTAMulticast] Session " + String(_sessionId, HEX) + " complete");
+        sendEvent(Event::SESSION_COMPLETE, "Multicast update complete", 100);
+    } else {
+        _sessionResult = DONE_FAILED;
+        _lastError = OTACore::getLastError();
+        Serial.println("[OTAMulticast] Session failed: " + _lastError);
+        sendEvent(Event::SESSION_FAILED, _lastError);
+    }
+
+    // Report before OTACore reboots into the new image
+    sendDone();
+}
+
+void OTAMulticast::scheduleReply() {
+    if (_replyPending) {
+        return;
+    }
+    // Spread the group's replies so they do not collide at the coordinator
+    _replyAt = millis() + (_config.maxBackoff > 0 ? random(_config.maxBackoff) : 0);
+    _replyPending = true;
+}
+
+void OTAMulticast::sendReply() {
+    if (_sessionDone) {
+        sendDone();
+    } else if (_sessionActive) {
+        sendNack();
+    }
+}
+
+void OTAMulticast::sendNack() {
+    size_t len = writeHeader(PACKET_NACK);
+    uint8_t* count = _packet + len;
+    len += 4;
+
+    uint8_t ranges = 0;
+    uint32_t blockCount = OTACore::getBlockCount();
+    uint32_t first = OTACore::nextMissingBlock(0);
+    while (first < blockCount && ranges < _config.maxRanges && len + 8 <= sizeof(_packet)) {
+        uint32_t last = first;
+        while (last + 1 < blockCount && !OTACore::hasBlock(last + 1)) {
+            last++;
+        }
+        OTAUtil::writeLE32(_packet + len, first);
+        OTAUtil::writeLE32(_packet + len + 4, last - first + 1);
+        len += 8;
+        ranges++;
+        first = OTACore::nextMissingBlock(last + 1);
+    }
+    OTAUtil::writeLE32(count, ranges);
+
+    _udp.beginPacket(_coordinator, _coordinatorPort);
+    _udp.write(_packet, len);
+    _udp.endPacket();
+    _stats.nacksSent++;
+}
+
+void OTAMulticast::sendDone() {
+    size_t len = writeHeader(PACKET_DONE);
+    _packet[len] = _sessionResult;
+    _packet[len + 1] = 0;
+    _packet[len + 2] = 0;
+    _packet[len + 3] = 0;
+    OTAUtil::writeLE32(_packet + len + 4, _stats.blocksReceived);
+    len += 8;
+
+    _udp.beginPacket(_coordinator, _coordinatorPort);
+    _udp.write(_packet, len);
+    _udp.endPacket();
+}
+
+size_t OTAMulticast::writeHeader(uint8_t type) {
+    memcpy(_packet, PACKET_MAGIC, sizeof(PACKET_MAGIC));
+    _packet[4] = type;
+    _packet[5] = 0;
+    _packet[6] = 0;
+    _packet[7] = 0;
+    OTAUtil::writeLE32(_packet + 8, _sessionId);
+    return HEADER_SIZE;
+}
+
+void OTAMulticast::loadCompleted() {
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, true)) {
+        _completedId = 0;
+        return;
+    }
+    _completedId = prefs.getUInt(PREFS_COMPLETED, 0);
+    prefs.end();
+}
+
+void OTAMulticast::saveCompleted(uint32_t sessionId) {
+    _completedId = sessionId;
+    Preferences prefs;
+    if (!prefs.begin(PREFS_NAMESPACE, false)) {
+        return;
+    }
+    prefs.putUInt(PREFS_COMPLETED, sessionId);
+    prefs.end();
+}
+
+void OTAMulticast::sendEvent(Event event, const String& message, int value) {
+    if (_callback) {
+        _callback(event, message, value);
+    }
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <Arduino.h>
+#include <functional>
+#include <WiFiUdp.h>
+#include <esp_wifi_types.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "OTACore.h"
+
+// Largest block carried in one datagram; keeps DATA packets inside one Wi-Fi frame
+#ifndef OTA_MULTICAST_MAX_BLOCK
+#define OTA_MULTICAST_MAX_BLOCK 1024
+#endif
+
+/**
+ * @brief Fleet OTA over UDP multicast
+ *
+ * A coordinator (tools/ota_multicast.py) sends the image once to a multicast
+ * group as numbered blocks. Every listening device writes the blocks it
+ * receives into an OTACore block session, in whatever order they arrive.
+ * After each pass the coordinator polls the group; devices answer, after a
+ * random backoff, with the ranges they are still missing, and only those
+ * blocks are sent again. Airtime scales with the image size, not with the
+ * number of devices.
+ *
+ * Packets start with "OMC1", a type byte and the session id. A session is
+ * announced with the image size, block size and SHA-256, so the image is
+ * verified from flash before the boot partition is switched.
+ *
+ * Announces carry an HMAC-SHA256 of the header and body under a pre-shared
+ * key. Only a valid announce starts a session or supersedes the one in
+ * progress, which makes the announced digest the image the device installs;
+ * forged DATA packets can corrupt a session but never change the image.
+ */
+class OTAMulticast {
+public:
+    /**
+     * @brief Multicast receiver configuration structure
+     */
+    struct Config {
+        IPAddress group;                   // Multicast group address
+        uint16_t port;                     // UDP port of the group
+        String sharedKey;                  // Pre-shared key authenticating announces (required)
+        unsigned long maxBackoff;          // Upper bound of the random reply delay in ms
+        unsigned long sessionTimeout;      // Suspend a session after this long without packets
+        uint8_t maxRanges;                 // Missing ranges reported per NACK
+        bool disableSleep;                 // Keep the radio awake so group frames are not missed
+        uint32_t taskStackSize;            // Receive task stack size
+        UBaseType_t taskPriority;          // Receive task priority
+        int taskCore;                      // Core the receive task is pinned to
+
+        // Constructor with default values
+        Config() : group(239, 255, 42, 99), port(45454), sharedKey(""), maxBackoff(500), sessionTimeout(30000),
+                   maxRanges(32), disableSleep(true), taskStackSize(6144), taskPriority(1),
+                   taskCore(ARDUINO_RUNNING_CORE == 0 ? 1 : 0) {}
+    };
+
+    /**
+     * @brief Receiver event types
+     */
+    enum class Event {
+        SESSION_STARTED,
+        SESSION_PROGRESS,
+        SESSION_COMPLETE,
+        SESSION_FAILED,
+        SESSION_TIMEOUT
+    };
+
+    /**
+     * @brief Receiver statistics
+     */
+    struct Stats {
+        uint32_t sessionId;                // Current or last session
+        uint32_t blocksReceived;           // Blocks in flash
+        uint32_t blockCount;               // Blocks in the image
+        uint32_t packets;                  // Datagrams accepted
+        uint32_t duplicates;               // DATA packets for blocks already written
+        uint32_t invalid;                  // Datagrams dropped as malformed
+        uint32_t rejected;                 // Announces that failed authentication
+        uint32_t nacksSent;                // Repair requests sent
+    };
+
+    /**
+     * @brief Receiver event callback function type
+     */
+    typedef std::function<void(Event event, const String& message, int value)> CallbackFunction;
+
+    /**
+     * @brief Join the group and start the receive task
+     * @param config Receiver configuration
+     * @return true if the receiver was started
+     */
+    static bool begin(const Config& config = Config());
+
+    /**
+     * @brief Leave the group; an unfinished session is suspended
+     */
+    static void stop();
+
+    /**
+     * @brief Set event callback
+     * @param callback Function to call on receiver events
+     */
+    static void setCallback(CallbackFunction callback);
+
+    /**
+     * @brief Check if the receiver is running
+     * @return true while joined to the group
+     */
+    static bool isRunning();
+
+    /**
+     * @brief Check if a multicast session is writing to OTACore
+     * @return true while blocks of a session are being received
+     */
+    static bool isBusy();
+
+    /**
+     * @brief Get receiver statistics
+     * @return Statistics snapshot
+     */
+    static Stats getStats();
+
+    /**
+     * @brief Get last error message
+     * @return Error message string
+     */
+    static String getLastError();
+
+private:
+    // Wire format, little-endian
+    static const uint8_t PACKET_MAGIC[4];
+    static const size_t HEADER_SIZE = 12;          // magic, type, 3 reserved, session id
+    static const size_t ANNOUNCE_SIGNED_SIZE = HEADER_SIZE + 44;
+    static const size_t ANNOUNCE_SIZE = ANNOUNCE_SIGNED_SIZE + 32;
+    static const size_t DATA_HEADER_SIZE = HEADER_SIZE + 4;
+    static const size_t MAX_PACKET_SIZE = DATA_HEADER_SIZE + OTA_MULTICAST_MAX_BLOCK;
+
+    enum : uint8_t {
+        PACKET_ANNOUNCE = 1,                       // size, block size, block count, sha256, hmac-sha256
+        PACKET_DATA = 2,                           // block index, payload
+        PACKET_POLL = 3,                           // repair round
+        PACKET_NACK = 4,                           // device: missing {first, count} ranges
+        PACKET_DONE = 5                            // device: result code
+    };
+
+    enum : uint8_t {
+        DONE_OK = 0,
+        DONE_FAILED = 1
+    };
+
+    static Config _config;
+    static CallbackFunction _callback;
+    static WiFiUDP _udp;
+    static volatile bool _running;
+    static TaskHandle_t _task;
+    static bool _sleepChanged;
+    static wifi_ps_type_t _savedSleep;
+    static uint8_t _packet[MAX_PACKET_SIZE];
+    static uint32_t _sessionId;
+    static bool _sessionActive;
+    static uint8_t _sessionResult;
+    static bool _sessionDone;
+    static uint32_t _completedId;
+    static IPAddress _coordinator;
+    static uint16_t _coordinatorPort;
+    static unsigned long _replyAt;
+    static bool _replyPending;
+    static unsigned long _lastPacket;
+    static int _lastProgress;
+    static Stats _stats;
+    static String _lastError;
+
+    static void receiveTask(void* param);
+    static void handlePacket(size_t len);
+    static bool authenticateAnnounce(size_t len);
+    static bool signAnnounce(const uint8_t* packet, uint8_t mac[32]);
+    static void handleAnnounce(const uint8_t* body, size_t len);
+    static void handleData(const uint8_t* body, size_t len);
+    static void finishSession();
+    static void scheduleReply();
+    static void sendReply();
+    static void sendNack();
+    static void sendDone();
+    static size_t writeHeader(uint8_t type);
+    static void loadCompleted();
+    static void saveCompleted(uint32_t sessionId);
+    static void sendEvent(Event event, const String& message = "", int value = 0);
+};
@@ -1,5 +1,14 @@
 #include "OTAWebServer.h"
 #include "NetworkManager.h"
+#include "OTAJson.h"
+#include "OTAUtil.h"
+#include "OTAWebUI.h"
+#include <lwip/sockets.h>
+#include <new>
+
+#ifdef OTA_ASYNC_WEBSERVER
+#include <ESPAsyncWebServer.h>
+#endif
 
 // Static member definitions
 WebServer* OTAWebServer::_server = nullptr;
@@ -7,9 +16,106 @@ OTAWebServer::Config OTAWebServer::_config;
 OTAWebServer::CallbackFunction OTAWebServer::_callback = nullptr;
 bool OTAWebServer::_running = false;
 int OTAWebServer::_clientCount = 0;
+bool OTAWebServer::_uploadActive = false;
+bool OTAWebServer::_uploadSkipped = false;
+uint32_t OTAWebServer::_rejectedUploads = 0;
 unsigned long OTAWebServer::_uploadStartTime = 0;
 size_t OTAWebServer::_uploadSize = 0;
 size_t OTAWebServer::_uploadReceived = 0;
+int OTAWebServer::_uploadProgress = -1;
+int OTAWebServer::_uploadStatusCode = 200;
+String OTAWebServer::_uploadMessage = "";
+uint8_t* OTAWebServer::_rawBuffer = nullptr;
+OTAArena::Region OTAWebServer::_serverRegion;
+OTAArena::Region OTAWebServer::_rawRegion;
+OTAWebServer::PendingClient OTAWebServer::_pendingClients[OTAWebServer::MAX_PENDING_CLIENTS];
+WiFiClient OTAWebServer::_eventClients[OTAWebServer::MAX_EVENT_CLIENTS];
+int OTAWebServer::_eventClientCount = 0;
+unsigned long OTAWebServer::_lastEventTime = 0;
+unsigned long OTAWebServer::_lastHeartbeat = 0;
+int OTAWebServer::_lastEventStatus = -1;
+int OTAWebServer::_lastEventProgress = -1;
+
+/**
+ * @brief Streams PUT <path>/raw bodies straight from the client socket
+ *
+ * WebServer only hands raw bodies to handlers in small HTTPRaw chunks, so
+ * the body is consumed directly from the WiFiClient at RAW_START and the
+ * HTTPRaw counters are advanced past it.
+ */
+class RawUploadHandler : public RequestHandler {
+public:
+    explicit RawUploadHandler(const String& uri) : _uri(uri) {}
+
+    bool canHandle(HTTPMethod method, String uri) override {
+        return method == HTTP_PUT && uri == _uri;
+    }
+
+    bool canRaw(String uri) override {
+        return uri == _uri;
+    }
+
+    void raw(WebServer& server, String requestUri, HTTPRaw& raw) override {
+        if (raw.status != RAW_START) {
+            return;
+        }
+
+        size_t contentLength = server.header("Content-Length").toInt();
+        WiFiClient client = server.client();
+        OTAWebServer::handleRawUpload(client, contentLength);
+
+        // Everything has been read; let WebServer skip straight to RAW_END
+        raw.totalSize = contentLength;
+        raw.currentSize = 0;
+    }
+
+    bool handle(WebServer& server, HTTPMethod requestMethod, String requestUri) override {
+        if (!canHandle(requestMethod, requestUri)) {
+            return false;
+        }
+        OTAWebServer::handleUpdatePost();
+        return true;
+    }
+
+private:
+    String _uri;
+};
+
+/**
+ * @brief WebServer with access to its listening socket
+ *
+ * WebServer serves one client at a time, so while an upload runs other
+ * connections wait in the accept queue; servePendingClient() takes them
+ * from there directly.
+ */
+class OTAHTTPServer : public WebServer {
+public:
+    explicit OTAHTTPServer(int port) : WebServer(port) {}
+
+    WiFiServer& listener() {
+        return _server;
+    }
+};
+
+bool OTAWebServer::createServer() {
+#if OTA_STATIC_MEMORY
+    // Constructed in the same arena slice on every begin()
+    void* memory = OTAArena::claim(_serverRegion, sizeof(OTAHTTPServer), alignof(OTAHTTPServer));
+    _server = memory ? new (memory) OTAHTTPServer(_config.port) : nullptr;
+#else
+    _server = new OTAHTTPServer(_config.port);
+#endif
+    return _server != nullptr;
+}
+
+void OTAWebServer::destroyServer() {
+#if OTA_STATIC_MEMORY
+    static_cast<OTAHTTPServer*>(_server)->~OTAHTTPServer();
+#else
+    delete _server;
+#endif
+    _server = nullptr;
+}
 
 bool OTAWebServer::begin(const Config& config) {
     if (_running) {
@@ -18,13 +124,44 @@ bool OTAWebServer::begin(const Config& config) {
     }
 
     _config = config;
+    _rejectedUploads = 0;
+
+    if (_config.backend == Backend::ASYNC) {
+#ifdef OTA_ASYNC_WEBSERVER
+        if (!beginAsync()) {
+            return false;
+        }
+        _running = true;
+
+        Serial.println("[OTAWebServer] Async OTA Web Server started on port " + String(_config.port));
+        Serial.println("[OTAWebServer] OTA endpoint: " + _config.path);
+        sendEvent(Event::STARTED, "OTA Web Server started on port " + String(_config.port));
+        return true;
+#else
+        Serial.println("[OTAWebServer] Async backend not built (define OTA_ASYNC_WEBSERVER)");
+        return false;
+#endif
+    }
     
     // Create web server instance
-    _server = new WebServer(_config.port);
-    if (!_server) {
+    if (!createServer()) {
         Serial.println("[OTAWebServer] Failed to create server instance");
         return false;
     }
+    OTAArena::reserve(_uploadMessage);
+
+    if (_config.enableRawUpload) {
+#if OTA_STATIC_MEMORY
+        _rawBuffer = (uint8_t*)OTAArena::claim(_rawRegion, _config.rawBlockSize);
+#else
+        _rawBuffer = (uint8_t*)malloc(_config.rawBlockSize);
+#endif
+        if (!_rawBuffer) {
+            Serial.println("[OTAWebServer] Failed to allocate raw upload buffer");
+            destroyServer();
+            return false;
+        }
+    }
 
     // Setup routes
     setupRoutes();
@@ -45,15 +182,28 @@ bool OTAWebServer::begin(const Config& config) {
 }
 
 void OTAWebServer::stop() {
-    if (!_running || !_server) {
+    if (!_running) {
         return;
     }
 
-    _server->stop();
-    delete _server;
-    _server = nullptr;
+    closeEventClients();
+    closePendingClients();
+#ifdef OTA_ASYNC_WEBSERVER
+    stopAsync();
+#endif
+    if (_server) {
+        _server->stop();
+        destroyServer();
+    }
     _running = false;
 
+#if !OTA_STATIC_MEMORY
+    if (_rawBuffer) {
+        free(_rawBuffer);
+    }
+#endif
+    _rawBuffer = nullptr;
+
     Serial.println("[OTAWebServer] OTA Web Server stopped");
     sendEvent(Event::STOPPED, "OTA Web Server stopped");
 }
@@ -63,9 +213,16 @@ void OTAWebServer::setCallback(CallbackFunction callback) {
 }
 
 void OTAWebServer::handle() {
-    if (_running && _server) {
+    if (!_running) {
+        return;
+    }
+
+    // The async backend serves requests on its own task; only events are polled
+    if (_server) {
         _server->handleClient();
     }
+    pushEvents();
+    updateClientCount();
 }
 
 bool OTAWebServer::isRunning() {
@@ -99,13 +256,23 @@ int OTAWebServer::getClientCount() {
     return _clientCount;
 }
 
+uint32_t OTAWebServer::getRejectedUploads() {
+    return _rejectedUploads;
+}
+
 void OTAWebServer::addCustomEndpoint(const String& path, std::function<void()> handler) {
     if (_server) {
         _server->on(path, handler);
         Serial.println("[OTAWebServer] Added custom endpoint: " + path);
+    } else if (_running) {
+        Serial.println("[OTAWebServer] Custom endpoints need the sync backend: " + path);
     }
 }
 
+WebServer* OTAWebServer::getServer() {
+    return _server;
+}
+
 void OTAWebServer::setAuthentication(const String& username, const String& password) {
     _config.username = username;
     _config.password = password;
@@ -123,53 +290,44 @@ void OTAWebServer::setupRoutes() {
 
     // Main OTA upload page
     _server->on(_config.path, HTTP_GET, handleUpdate);
-    _server->on(_config.path, HTTP_POST, handleUpdatePost, []() {
-        HTTPUpload& upload = _server->upload();
-        
-        if (upload.status == UPLOAD_FILE_START) {
-            _uploadStartTime = millis();
-            _uploadSize = upload.totalSize;
-            _uploadReceived = 0;
-            
-            Serial.println("[OTAWebServer] Upload started: " + upload.filename);
-            sendEvent(Event::UPLOAD_START, "Upload started: " + upload.filename, upload.totalSize);
-            
-            if (!OTACore::startUpdate(upload.totalSize)) {
-                _server->send(500, "text/plain", "Failed to start OTA update");
-                return;
-            }
-        } else if (upload.status == UPLOAD_FILE_WRITE) {
-            _uploadReceived += upload.currentSize;
-            
-            if (OTACore::writeData(upload.buf, upload.currentSize) != upload.currentSize) {
-                _server->send(500, "text/plain", "Write error: " + OTACore::getLastError());
-                return;
-            }
-            
-            int progress = (_uploadReceived * 100) / _uploadSize;
-            sendEvent(Event::UPLOAD_PROGRESS, "Upload progress", progress);
-        } else if (upload.status == UPLOAD_FILE_END) {
-            if (OTACore::finishUpdate()) {
-                Serial.println("[OTAWebServer] Upload completed successfully");
-                sendEvent(Event::UPLOAD_COMPLETE, "Upload completed successfully", 100);
-            } else {
-                Serial.println("[OTAWebServer] Upload failed: " + OTACore::getLastError());
-                sendEvent(Event::UPLOAD_ERROR, "Upload failed: " + OTACore::getLastError());
-            }
-        }
-    });
+    _server->on(_config.path, HTTP_POST, handleUpdatePost, handleUpload);
+
+    // Raw binary upload, read straight from the socket
+    if (_config.enableRawUpload) {
+        _server->addHandler(new RawUploadHandler(_config.path + "/raw"));
+    }
+
+    // Headers needed by the upload, resume and page cache handling
+    const char* headerKeys[] = {"Content-Range", "Content-Length", "Content-Encoding", "X-Firmware-SHA256",
+                                "If-None-Match"};
+    _server->collectHeaders(headerKeys, sizeof(headerKeys) / sizeof(headerKeys[0]));
+
+    // Resume endpoint
+    _server->on(_config.path + "/resume", HTTP_GET, handleResume);
 
     // Progress endpoint
     if (_config.enableProgress) {
         _server->on(_config.path + "/progress", HTTP_GET, handleProgress);
     }
 
+    // Progress event stream
+    if (_config.enableEvents) {
+        _server->on(_config.path + "/events", HTTP_GET, handleEvents);
+    }
+
     // Status endpoint
     _server->on(_config.path + "/status", HTTP_GET, handleStatus);
 
     // Reboot endpoint
     _server->on(_config.path + "/reboot", HTTP_POST, handleReboot);
 
+    // Application slots and rollback to the previous image
+    _server->on(_config.path + "/slots", HTTP_GET, handleSlots);
+    _server->on(_config.path + "/rollback", HTTP_POST, handleRollback);
+
+    // Pre-erase the inactive slot ahead of an announced upload
+    _server->on(_config.path + "/prepare", HTTP_POST, handlePrepare);
+
     // 404 handler
     _server->onNotFound(handleNotFound);
 }
@@ -178,137 +336,593 @@ void OTAWebServer::handleUpdate() {
     if (!authenticate()) return;
 
     sendCORSHeaders();
+    sendUI(*_server);
+}
+
+void OTAWebServer::sendUI(WebServer& server) {
+    // Revalidated on every load, so a firmware update never leaves a stale page
+    server.sendHeader("ETag", OTA_UI_ETAG);
+    server.sendHeader("Cache-Control", "no-cache");
+
+    if (server.header("If-None-Match").indexOf(OTA_UI_ETAG) >= 0) {
+        server.send(304);
+        return;
+    }
+
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, "text/html", (PGM_P)OTA_UI_HTML_GZ, OTA_UI_HTML_GZ_LEN);
+}
+
+#ifdef OTA_ASYNC_WEBSERVER
+// Kept next to the sync variant so the page is embedded only once
+void OTAWebServer::sendUI(AsyncWebServerRequest* request) {
+    AsyncWebServerResponse* response;
+    if (request->hasHeader("If-None-Match") &&
+        request->getHeader("If-None-Match")->value().indexOf(OTA_UI_ETAG) >= 0) {
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse_P(200, "text/html", OTA_UI_HTML_GZ, OTA_UI_HTML_GZ_LEN);
+        response->addHeader("Content-Encoding", "gzip");
+    }
+
+    // Revalidated on every load, so a firmware update never leaves a stale page
+    response->addHeader("ETag", OTA_UI_ETAG);
+    response->addHeader("Cache-Control", "no-cache");
+    sendAsyncCORSHeaders(response);
+    request->send(response);
+}
+#endif
+
+void OTAWebServer::handleUpdatePost() {
+    if (!authenticate()) return;
+
+    sendCORSHeaders();
+    if (_uploadStatusCode == 409) {
+        _server->sendHeader("Retry-After", String(retryAfter()));
+    }
+    if (_uploadStatusCode != 200 || _uploadSkipped) {
+        _server->send(_uploadStatusCode, "text/plain", _uploadMessage);
+        return;
+    }
+    _server->send(200, "text/plain", "Update completed");
+}
+
+void OTAWebServer::handleUpload() {
+    HTTPUpload& upload = _server->upload();
+
+    if (upload.status == UPLOAD_FILE_START) {
+        _uploadStartTime = millis();
+        _uploadSize = upload.totalSize;
+        _uploadReceived = 0;
+        _uploadProgress = -1;
+        _uploadStatusCode = 200;
+        _uploadMessage = "";
+        _uploadSkipped = false;
+
+        // Continuation uploads carry "Content-Range: bytes <start>-<end>/<total>"
+        size_t rangeStart = 0;
+        size_t rangeTotal = 0;
+        bool ranged = _server->hasHeader("Content-Range") &&
+                      parseContentRange(_server->header("Content-Range"), rangeStart, rangeTotal);
+        if (ranged) {
+            _uploadSize = rangeTotal;
+            _uploadReceived = rangeStart;
+        } else if (_uploadSize == 0) {
+            // totalSize is not known yet for multipart bodies; the request
+            // length is a close upper bound (file plus multipart framing)
+            _uploadSize = _server->header("Content-Length").toInt();
+        }
+
+        WiFiClient client = _server->client();
+        tuneSocket(client);
 
-    String html = R"HTML(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>ESP32 OTA Update</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body { font-family: Arial, sans-serif; margin: 40px; background-color: #f0f0f0; }
-        .container { max-width: 600px; margin: 0 auto; background: white; padding: 30px; border-radius: 10px; box-shadow: 0 4px 6px rgba(0,0,0,0.1); }
-        h1 { color: #333; text-align: center; }
-        .upload-area { border: 2px dashed #ccc; border-radius: 10px; padding: 40px; text-align: center; margin: 20px 0; }
-        .upload-area:hover { border-color: #007bff; }
-        input[type="file"] { margin: 20px 0; }
-        button { background-color: #007bff; color: white; padding: 10px 20px; border: none; border-radius: 5px; cursor: pointer; font-size: 16px; }
-        button:hover { background-color: #0056b3; }
-        button:disabled { background-color: #ccc; cursor: not-allowed; }
-        .progress { width: 100%; background-color: #f0f0f0; border-radius: 10px; margin: 20px 0; height: 20px; overflow: hidden; }
-        .progress-bar { height: 100%; background-color: #007bff; width: 0%; transition: width 0.3s; }
-        .status { margin: 20px 0; padding: 10px; border-radius: 5px; }
-        .status.success { background-color: #d4edda; color: #155724; border: 1px solid #c3e6cb; }
-        .status.error { background-color: #f8d7da; color: #721c24; border: 1px solid #f5c6cb; }
-        .status.info { background-color: #d1ecf1; color: #0c5460; border: 1px solid #bee5eb; }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>ESP32 OTA Update</h1>
-        <div class="upload-area">
-            <p>Select firmware file (.bin) to upload</p>
-            <form method="POST" action="#" enctype="multipart/form-data" id="uploadForm">
-                <input type="file" name="update" accept=".bin" id="fileInput" required>
-                <br>
-                <button type="submit" id="uploadBtn">Upload Firmware</button>
-            </form>
-        </div>
-        <div class="progress" id="progressContainer" style="display: none;">
-            <div class="progress-bar" id="progressBar"></div>
-        </div>
-        <div id="status"></div>
-    </div>
-
-    <script>
-        document.getElementById('uploadForm').addEventListener('submit', function(e) {
-            e.preventDefault();
-            uploadFile();
-        });
-
-        function uploadFile() {
-            const fileInput = document.getElementById('fileInput');
-            const file = fileInput.files[0];
-            
-            if (!file) {
-                showStatus('Please select a file', 'error');
+        // Refused, skipped or oversized: answer now instead of reading the body
+        size_t declared = ranged ? rangeTotal
+                        : _uploadSize > MULTIPART_OVERHEAD ? _uploadSize - MULTIPART_OVERHEAD : 0;
+        if (!admitUpload() || (!ranged && skipInstalled(requestDigest())) ||
+            !enforceUploadLimit(declared)) {
+            dropUpload();
+            return;
+        }
+
+        Serial.println("[OTAWebServer] Upload started: " + upload.filename +
+                       (ranged ? " (from offset " + String(rangeStart) + ")" : ""));
+        sendEvent(Event::UPLOAD_START, "Upload started: " + upload.filename, _uploadSize);
+
+        bool started;
+        if (ranged && rangeStart > 0) {
+            started = OTACore::resumeUpdate(rangeTotal, rangeStart);
+            if (!started) {
+                failUpload(416, OTACore::getLastError());
                 return;
             }
+        } else {
+            started = OTACore::startUpdate(_uploadSize);
+        }
+
+        if (!started) {
+            failUpload(500, "Failed to start OTA update: " + OTACore::getLastError());
+        } else if (!applyExpectedDigest(requestDigest())) {
+            OTACore::abortUpdate();
+        } else {
+            setUploadActive(true);
+        }
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+        if (_uploadStatusCode != 200 || _uploadSkipped) return;
+
+        // Checked before the chunk reaches flash
+        if (!enforceUploadLimit(_uploadReceived + upload.currentSize)) {
+            dropUpload();
+            return;
+        }
+        _uploadReceived += upload.currentSize;
+
+        if (OTACore::writeData(upload.buf, upload.currentSize) != (int)upload.currentSize) {
+            failUpload(500, "Write error: " + OTACore::getLastError());
+            return;
+        }
+
+        reportUploadProgress();
+
+        // The loop is blocked in handleClient for the whole upload
+        pushEvents();
+        servePendingClient();
+    } else if (upload.status == UPLOAD_FILE_END) {
+        if (_uploadStatusCode != 200 || _uploadSkipped) return;
+
+        setUploadActive(false);
+        if (OTACore::finishUpdate()) {
+            Serial.println("[OTAWebServer] Upload completed successfully");
+            sendEvent(Event::UPLOAD_COMPLETE, "Upload completed successfully", 100);
+        } else {
+            failUpload(500, "Upload failed: " + OTACore::getLastError());
+        }
+    } else if (upload.status == UPLOAD_FILE_ABORTED) {
+        // A refused upload must not suspend the session that refused it
+        if (!_uploadActive) return;
+
+        // Keep what reached flash so the client can resume from /resume
+        setUploadActive(false);
+        OTACore::suspendUpdate();
+        Serial.println("[OTAWebServer] Upload interrupted at offset " +
+                       String(OTACore::getResumeInfo().offset));
+        sendEvent(Event::UPLOAD_ERROR, "Upload interrupted", OTACore::getResumeInfo().offset);
+    }
+}
 
-            const formData = new FormData();
-            formData.append('update', file);
+void OTAWebServer::handleRawUpload(WiFiClient& client, size_t contentLength) {
+    _uploadStartTime = millis();
+    _uploadSize = contentLength;
+    _uploadReceived = 0;
+    _uploadProgress = -1;
+    _uploadStatusCode = 200;
+    _uploadMessage = "";
+    _uploadSkipped = false;
 
-            const uploadBtn = document.getElementById('uploadBtn');
-            const progressContainer = document.getElementById('progressContainer');
-            const progressBar = document.getElementById('progressBar');
+    if (_config.username.length() > 0 &&
+        !_server->authenticate(_config.username.c_str(), _config.password.c_str())) {
+        failUpload(401, "Authentication required");
+        return;
+    }
 
-            uploadBtn.disabled = true;
-            uploadBtn.textContent = 'Uploading...';
-            progressContainer.style.display = 'block';
-            progressBar.style.width = '0%';
+    if (contentLength == 0) {
+        failUpload(411, "Content-Length required");
+        return;
+    }
+    tuneSocket(client);
 
-            const xhr = new XMLHttpRequest();
+    // Continuations use the same Content-Range header as multipart uploads
+    size_t rangeStart = 0;
+    size_t rangeTotal = 0;
+    bool ranged = _server->hasHeader("Content-Range") &&
+                  parseContentRange(_server->header("Content-Range"), rangeStart, rangeTotal);
 
-            xhr.upload.addEventListener('progress', function(e) {
-                if (e.lengthComputable) {
-                    const percentComplete = (e.loaded / e.total) * 100;
-                    progressBar.style.width = percentComplete + '%';
-                }
-            });
+    // Refused or skipped before any of the body is read
+    if (!admitUpload() || !enforceUploadLimit(ranged ? rangeTotal : contentLength) ||
+        (!ranged && skipInstalled(requestDigest()))) {
+        return;
+    }
+
+    Serial.println("[OTAWebServer] Raw upload started: " + String(contentLength) + " bytes" +
+                   (ranged ? " (from offset " + String(rangeStart) + ")" : ""));
+    sendEvent(Event::UPLOAD_START, "Raw upload started", ranged ? rangeTotal : contentLength);
 
-            xhr.addEventListener('load', function() {
-                if (xhr.status === 200) {
-                    progressBar.style.width = '100%';
-                    showStatus('Upload successful! Device will reboot...', 'success');
-                    setTimeout(function() {
-                        window.location.reload();
-                    }, 3000);
-                } else {
-                    showStatus('Upload failed: ' + xhr.responseText, 'error');
-                }
-                uploadBtn.disabled = false;
-                uploadBtn.textContent = 'Upload Firmware';
-            });
+    if (ranged && rangeStart > 0) {
+        if (!OTACore::resumeUpdate(rangeTotal, rangeStart)) {
+            failUpload(416, OTACore::getLastError());
+            return;
+        }
+        _uploadSize = rangeTotal;
+        _uploadReceived = rangeStart;
+    } else if (!OTACore::startUpdate(ranged ? rangeTotal : contentLength, "",
+                                     _server->header("Content-Encoding").equalsIgnoreCase("gzip")
+                                     ? OTACore::Encoding::GZIP : OTACore::Encoding::AUTO)) {
+        failUpload(500, "Failed to start OTA update: " + OTACore::getLastError());
+        return;
+    }
+
+    if (!applyExpectedDigest(requestDigest())) {
+        OTACore::abortUpdate();
+        return;
+    }
+    setUploadActive(true);
+
+    size_t remaining = contentLength;
+    unsigned long lastData = millis();
+    while (remaining > 0) {
+        size_t want = remaining < _config.rawBlockSize ? remaining : _config.rawBlockSize;
+        if (_config.backpressure) {
+            // Bytes left unread stay in the socket and close the TCP window
+            size_t capacity = OTACore::getWriteCapacity();
+            if (capacity < want) want = capacity;
+        }
+
+        int available = want > 0 ? client.available() : 0;
+        if (available <= 0) {
+            if (!client.connected() || millis() - lastData > RAW_READ_TIMEOUT_MS) {
+                OTACore::suspendUpdate();
+                failUpload(408, "Upload interrupted at offset " + String(OTACore::getResumeInfo().offset));
+                return;
+            }
+            servePendingClient();
+            delay(1);
+            continue;
+        }
 
-            xhr.addEventListener('error', function() {
-                showStatus('Upload failed: Network error', 'error');
-                uploadBtn.disabled = false;
-                uploadBtn.textContent = 'Upload Firmware';
-            });
+        if ((size_t)available < want) want = available;
 
-            xhr.open('POST', '')
-            xhr.send(formData);
+        int got = client.read(_rawBuffer, want);
+        if (got <= 0) {
+            continue;
         }
+        lastData = millis();
+        remaining -= got;
 
-        function showStatus(message, type) {
-            const status = document.getElementById('status');
-            status.innerHTML = '<div class="status ' + type + '">' + message + '</div>';
+        // A continuation may claim more than the image it resumes
+        if (!enforceUploadLimit(_uploadReceived + got)) {
+            return;
         }
-    </script>
-</body>
-</html>
-)HTML";
+        _uploadReceived += got;
 
-    _server->send(200, "text/html", html);
+        if (OTACore::writeData(_rawBuffer, got) != got) {
+            failUpload(500, "Write error: " + OTACore::getLastError());
+            return;
+        }
+
+        reportUploadProgress();
+        pushEvents();
+        servePendingClient();
+    }
+
+    setUploadActive(false);
+    if (OTACore::finishUpdate()) {
+        Serial.println("[OTAWebServer] Raw upload completed successfully");
+        sendEvent(Event::UPLOAD_COMPLETE, "Upload completed successfully", 100);
+    } else {
+        failUpload(500, "Upload failed: " + OTACore::getLastError());
+    }
 }
 
-void OTAWebServer::handleUpdatePost() {
-    if (!authenticate()) return;
+void OTAWebServer::tuneSocket(WiFiClient& client) {
+    int fd = client.fd();
+    if (fd < 0) {
+        return;
+    }
 
-    sendCORSHeaders();
-    _server->send(200, "text/plain", "Update completed");
+    if (_config.socketRxBuffer > 0) {
+        int size = _config.socketRxBuffer;
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) != 0) {
+            Serial.println("[OTAWebServer] SO_RCVBUF not supported by this lwIP build");
+        }
+    }
+    client.setNoDelay(_config.noDelay);
+}
+
+void OTAWebServer::failUpload(int code, const String& message) {
+    _uploadStatusCode = code;
+    _uploadMessage = message;
+    setUploadActive(false);
+    Serial.println("[OTAWebServer] " + message);
+    sendEvent(Event::UPLOAD_ERROR, message);
+}
+
+size_t OTAWebServer::getUploadLimit() {
+    size_t limit = OTACore::getAvailableSize();
+    if (_config.maxUploadSize > 0 && _config.maxUploadSize < limit) {
+        limit = _config.maxUploadSize;
+    }
+    return limit;
+}
+
+bool OTAWebServer::enforceUploadLimit(size_t size) {
+    size_t limit = getUploadLimit();
+    if (size <= limit) {
+        return true;
+    }
+
+    // Oversized images are never resumable
+    if (OTACore::isActive()) {
+        OTACore::abortUpdate();
+    }
+    failUpload(413, "Upload exceeds the " + String(limit) + " byte limit");
+    return false;
+}
+
+void OTAWebServer::dropUpload() {
+    // Answer now and close so the client stops sending the rest of the body
+    WiFiClient client = _server->client();
+    sendDirect(client, _uploadStatusCode, "text/plain", _uploadMessage.c_str(), _uploadMessage.length());
+    client.stop();
+}
+
+bool OTAWebServer::admitUpload() {
+    if (!OTACore::isActive()) {
+        return true;
+    }
+
+    _rejectedUploads++;
+    failUpload(409, "Another update is in progress");
+    return false;
+}
+
+bool OTAWebServer::skipInstalled(const String& digest) {
+    if (digest.length() == 0) {
+        return false;
+    }
+
+    OTACore::Installed installed = OTACore::skipIfInstalled(digest);
+    if (installed == OTACore::Installed::NONE) {
+        return false;
+    }
+
+    _uploadSkipped = true;
+    _uploadMessage = installed == OTACore::Installed::RUNNING
+                     ? "Firmware already installed" : "Firmware already in flash, rebooting";
+    Serial.println("[OTAWebServer] " + _uploadMessage);
+    sendEvent(Event::UPLOAD_COMPLETE, _uploadMessage, 100);
+    return true;
+}
+
+void OTAWebServer::setUploadActive(bool active) {
+    if (_uploadActive == active) {
+        return;
+    }
+    _uploadActive = active;
+    if (!active) {
+        // Queued clients still waiting for headers would never be answered
+        closePendingClients();
+    }
+    updateClientCount();
+}
+
+void OTAWebServer::updateClientCount() {
+    int count = getEventClientCount() + (_uploadActive ? 1 : 0);
+    if (count == _clientCount) {
+        return;
+    }
+
+    Event event = count > _clientCount ? Event::CLIENT_CONNECTED : Event::CLIENT_DISCONNECTED;
+    _clientCount = count;
+    sendEvent(event, "Clients: " + String(count), count);
+}
+
+uint32_t OTAWebServer::retryAfter() {
+    // Time left for the running upload at its rate so far
+    unsigned long elapsed = millis() - _uploadStartTime;
+    if (_uploadActive && elapsed > 0 && _uploadReceived > 0 && _uploadSize > _uploadReceived) {
+        uint64_t remaining = (uint64_t)(_uploadSize - _uploadReceived) * elapsed / _uploadReceived;
+        uint32_t seconds = remaining / 1000 + 1;
+        return seconds < MAX_RETRY_AFTER ? seconds : MAX_RETRY_AFTER;
+    }
+    return _config.retryAfter;
+}
+
+void OTAWebServer::servePendingClient() {
+    if (!_server || !_uploadActive) {
+        return;
+    }
+
+    // Take at most one new connection per call; the rest wait in the accept queue
+    for (int i = 0; i < MAX_PENDING_CLIENTS; i++) {
+        PendingClient& pending = _pendingClients[i];
+        if (pending.client) {
+            continue;
+        }
+        pending.client = static_cast<OTAHTTPServer*>(_server)->listener().available();
+        pending.acceptedAt = millis();
+        pending.lineLength = 0;
+        pending.lineDone = false;
+        pending.lineEmpty = true;
+        pending.received = 0;
+        break;
+    }
+
+    // Answer only clients whose whole header block is already here; idle
+    // and slow ones are given up on without ever blocking the upload
+    for (int i = 0; i < MAX_PENDING_CLIENTS; i++) {
+        PendingClient& pending = _pendingClients[i];
+        if (!pending.client) {
+            continue;
+        }
+        if (readPendingClient(pending)) {
+            answerPendingClient(pending.client, pending.line);
+            pending.client.stop();
+        } else if (pending.received >= PENDING_HEADER_LIMIT ||
+                   millis() - pending.acceptedAt > PENDING_HEADER_TIMEOUT_MS) {
+            pending.client.stop();
+        }
+    }
+}
+
+bool OTAWebServer::readPendingClient(PendingClient& pending) {
+    int available = pending.client.available();
+    while (available-- > 0 && pending.received < PENDING_HEADER_LIMIT) {
+        int c = pending.client.read();
+        if (c < 0) {
+            break;
+        }
+        pending.received++;
+
+        if (c == '\n') {
+            // A blank line after the request line ends the headers
+            if (pending.lineDone && pending.lineEmpty) {
+                return true;
+            }
+            pending.line[pending.lineLength] = '\0';
+            pending.lineDone = true;
+            pending.lineEmpty = true;
+        } else if (c != '\r') {
+            pending.lineEmpty = false;
+            if (!pending.lineDone && pending.lineLength < sizeof(pending.line) - 1) {
+                pending.line[pending.lineLength++] = (char)c;
+            }
+        }
+    }
+    return false;
+}
+
+void OTAWebServer::closePendingClients() {
+    for (int i = 0; i < MAX_PENDING_CLIENTS; i++) {
+        _pendingClients[i].client.stop();
+    }
+}
+
+void OTAWebServer::answerPendingClient(WiFiClient& client, char* line) {
+    char* uri = strchr(line, ' ');
+    if (!uri) {
+        return;
+    }
+
+    // "<method> <uri> HTTP/1.1", query string dropped
+    *uri++ = '\0';
+    uri[strcspn(uri, " ?")] = '\0';
+
+    String path(uri);
+    bool get = strcmp(line, "GET") == 0;
+    if (get && path == _config.path + "/status") {
+        char json[OTA_STATUS_JSON_SIZE];
+        size_t length = writeStatusJSON(json, sizeof(json));
+        if (length > 0) {
+            sendDirect(client, 200, "application/json", json, length);
+        } else {
+            static const char message[] = "Response too large";
+            sendDirect(client, 500, "text/plain", message, sizeof(message) - 1);
+        }
+    } else if (get && _config.enableProgress && _config.username.length() == 0 &&
+               path == _config.path + "/progress") {
+        char json[OTA_SMALL_JSON_SIZE];
+        sendDirect(client, 200, "application/json", json, writeProgressJSON(json, sizeof(json)));
+    } else if ((strcmp(line, "POST") == 0 && path == _config.path) ||
+               (strcmp(line, "PUT") == 0 && path == _config.path + "/raw")) {
+        static const char message[] = "Another upload is in progress";
+        _rejectedUploads++;
+        sendDirect(client, 409, "text/plain", message, sizeof(message) - 1);
+    } else {
+        static const char message[] = "Upload in progress";
+        sendDirect(client, 503, "text/plain", message, sizeof(message) - 1);
+    }
+}
+
+const char* OTAWebServer::reasonPhrase(int code) {
+    // Every status the hand-written responses can carry
+    static const struct {
+        int code;
+        const char* reason;
+    } REASONS[] = {
+        {200, "OK"},
+        {400, "Bad Request"},
+        {401, "Unauthorized"},
+        {409, "Conflict"},
+        {413, "Payload Too Large"},
+        {416, "Range Not Satisfiable"},
+        {500, "Internal Server Error"},
+        {503, "Service Unavailable"},
+    };
+
+    for (size_t i = 0; i < sizeof(REASONS) / sizeof(REASONS[0]); i++) {
+        if (REASONS[i].code == code) {
+            return REASONS[i].reason;
+        }
+    }
+    return code >= 500 ? "Server Error" : "Client Error";
+}
+
+void OTAWebServer::sendDirect(WiFiClient& client, int code, const char* type, const char* body, size_t length) {
+    const char* reason = reasonPhrase(code);
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n",
+                     code, reason, type, (unsigned)length);
+    if (code == 409 || code == 503) {
+        n += snprintf(header + n, sizeof(header) - n, "Retry-After: %u\r\n", (unsigned)retryAfter());
+    }
+    if (_config.enableCORS) {
+        n += snprintf(header + n, sizeof(header) - n, "Access-Control-Allow-Origin: *\r\n");
+    }
+    n += snprintf(header + n, sizeof(header) - n, "\r\n");
+
+    client.write((const uint8_t*)header, n);
+    client.write((const uint8_t*)body, length);
+}
+
+String OTAWebServer::requestDigest() {
+    // Digest from the X-Firmware-SHA256 header or a ?sha256= query argument
+    String digest = _server->header("X-Firmware-SHA256");
+    if (digest.length() == 0) {
+        digest = _server->arg("sha256");
+    }
+    return digest;
+}
+
+bool OTAWebServer::applyExpectedDigest(const String& digest) {
+    if (digest.length() == 0) {
+        return true;
+    }
+
+    if (!OTACore::setExpectedSHA256(digest)) {
+        failUpload(400, OTACore::getLastError());
+        return false;
+    }
+    return true;
+}
+
+void OTAWebServer::reportUploadProgress() {
+    // Only whole-percent changes are reported, not every chunk
+    int progress = _uploadSize > 0 ? (_uploadReceived * 100) / _uploadSize : 0;
+    if (progress == _uploadProgress) {
+        return;
+    }
+
+    _uploadProgress = progress;
+    sendEvent(Event::UPLOAD_PROGRESS, "Upload progress", progress);
+}
+
+bool OTAWebServer::parseContentRange(const String& header, size_t& start, size_t& total) {
+    // Format: "bytes <start>-<end>/<total>"
+    int unit = header.indexOf("bytes ");
+    int dash = header.indexOf('-');
+    int slash = header.indexOf('/');
+    if (unit != 0 || dash < 0 || slash < dash) {
+        return false;
+    }
+
+    start = strtoul(header.substring(6, dash).c_str(), nullptr, 10);
+    total = strtoul(header.substring(slash + 1).c_str(), nullptr, 10);
+    return total > 0 && start < total;
 }
 
 void OTAWebServer::handleProgress() {
     if (!authenticate()) return;
 
+    char json[OTA_SMALL_JSON_SIZE];
     sendCORSHeaders();
-    _server->send(200, "application/json", getProgressJSON());
+    sendJSON(json, writeProgressJSON(json, sizeof(json)));
 }
 
 void OTAWebServer::handleStatus() {
+    char json[OTA_STATUS_JSON_SIZE];
     sendCORSHeaders();
-    _server->send(200, "application/json", getStatusJSON());
+    sendJSON(json, writeStatusJSON(json, sizeof(json)));
 }
 
 void OTAWebServer::handleReboot() {
@@ -316,9 +930,179 @@ void OTAWebServer::handleReboot() {
 
     sendCORSHeaders();
     _server->send(200, "text/plain", "Rebooting...");
-    
-    delay(1000);
-    ESP.restart();
+
+    // Restarted from OTACore::handle() once the response has gone out
+    OTACore::scheduleReboot(REBOOT_RESPONSE_MS);
+}
+
+void OTAWebServer::handleSlots() {
+    if (!authenticate()) return;
+
+    char json[OTA_SLOTS_JSON_SIZE];
+    sendCORSHeaders();
+    sendJSON(json, writeSlotsJSON(json, sizeof(json)));
+}
+
+void OTAWebServer::handleRollback() {
+    if (!authenticate()) return;
+
+    sendCORSHeaders();
+    if (!OTACore::rollback(false)) {
+        _server->send(409, "text/plain", OTACore::getLastError());
+        return;
+    }
+    _server->send(200, "text/plain", "Rolling back...");
+
+    // Restarted from OTACore::handle() once the response has gone out
+    OTACore::scheduleReboot(REBOOT_RESPONSE_MS);
+}
+
+void OTAWebServer::handlePrepare() {
+    if (!authenticate()) return;
+
+    sendCORSHeaders();
+    size_t size = _server->hasArg("size") ? strtoul(_server->arg("size").c_str(), nullptr, 10) : 0;
+    if (!OTACore::prepareUpdate(size)) {
+        _server->send(409, "text/plain", OTACore::getLastError());
+        return;
+    }
+    _server->send(202, "text/plain", "Erasing");
+}
+
+void OTAWebServer::handleResume() {
+    if (!authenticate()) return;
+
+    char json[OTA_SMALL_JSON_SIZE];
+    sendCORSHeaders();
+    sendJSON(json, writeResumeJSON(json, sizeof(json)));
+}
+
+void OTAWebServer::handleEvents() {
+    if (!authenticate()) return;
+
+    int slot = -1;
+    for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+        if (!_eventClients[i].connected()) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        _server->send(503, "text/plain", "Too many event clients");
+        return;
+    }
+
+    WiFiClient client = _server->client();
+    client.setNoDelay(true);
+    client.print("HTTP/1.1 200 OK\r\n"
+                 "Content-Type: text/event-stream\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Connection: keep-alive\r\n");
+    if (_config.enableCORS) {
+        client.print("Access-Control-Allow-Origin: *\r\n");
+    }
+    client.print("\r\nretry: 2000\n\n");
+
+    // Current state first, then only changes
+    char json[OTA_SMALL_JSON_SIZE * 2];
+    size_t length = writeEventJSON(json, sizeof(json));
+    client.print("event: progress\ndata: ");
+    client.write((const uint8_t*)json, length);
+    client.print("\n\n");
+
+    // Keep the socket and let WebServer drop its reference, so it does not
+    // hold the connection open waiting for the client to close
+    _eventClients[slot] = client;
+    _server->client().stop();
+
+    _eventClientCount = 0;
+    for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+        if (_eventClients[i].connected()) _eventClientCount++;
+    }
+}
+
+void OTAWebServer::pushEvents() {
+    if (getEventClientCount() == 0) {
+        return;
+    }
+
+    // Status changes go out at once; progress is coalesced to eventInterval
+    unsigned long now = millis();
+    int status = (int)OTACore::getStatus();
+    int progress = OTACore::getProgress();
+    bool statusChanged = status != _lastEventStatus;
+    bool progressDue = progress != _lastEventProgress && now - _lastEventTime >= _config.eventInterval;
+
+    if (statusChanged || progressDue) {
+#ifdef OTA_ASYNC_WEBSERVER
+        if (_asyncEvents) {
+            // AsyncEventSource adds the SSE framing itself
+            char json[OTA_SMALL_JSON_SIZE * 2];
+            writeEventJSON(json, sizeof(json));
+            _asyncEvents->send(json, "progress", now);
+
+            _lastEventStatus = status;
+            _lastEventProgress = progress;
+            _lastEventTime = now;
+            _lastHeartbeat = now;
+            return;
+        }
+#endif
+        char message[OTA_SMALL_JSON_SIZE * 2 + 32];
+        int header = snprintf(message, sizeof(message), "event: progress\ndata: ");
+        size_t length = header + writeEventJSON(message + header, sizeof(message) - header - 2);
+        message[length++] = '\n';
+        message[length++] = '\n';
+        broadcastEvent(message, length);
+
+        _lastEventStatus = status;
+        _lastEventProgress = progress;
+        _lastEventTime = now;
+        _lastHeartbeat = now;
+    } else if (now - _lastHeartbeat >= EVENT_HEARTBEAT_MS) {
+        // Comment line keeps proxies from timing out and detects dead clients
+        broadcastEvent(":\n\n", 3);
+        _lastHeartbeat = now;
+    }
+}
+
+void OTAWebServer::broadcastEvent(const char* message, size_t length) {
+    int count = 0;
+    for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+        if (!_eventClients[i].connected()) {
+            continue;
+        }
+
+        // WiFiClient::write() retries until the peer drains its window, which
+        // would stall the upload loop; a client that cannot take the whole
+        // event into its send buffer at once is dropped instead
+        int fd = _eventClients[i].fd();
+        ssize_t sent = fd >= 0 ? send(fd, message, length, MSG_DONTWAIT) : -1;
+        if (sent != (ssize_t)length) {
+            _eventClients[i].stop();
+            continue;
+        }
+        count++;
+    }
+    _eventClientCount = count;
+}
+
+void OTAWebServer::closeEventClients() {
+    for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+        _eventClients[i].stop();
+    }
+    _eventClientCount = 0;
+    _lastEventStatus = -1;
+    _lastEventProgress = -1;
+}
+
+int OTAWebServer::getEventClientCount() {
+#ifdef OTA_ASYNC_WEBSERVER
+    if (_asyncEvents) {
+        return _asyncEvents->count();
+    }
+#endif
+    return _eventClientCount;
 }
 
 void OTAWebServer::handleNotFound() {
@@ -329,8 +1113,8 @@ void OTAWebServer::handleNotFound() {
 void OTAWebServer::sendCORSHeaders() {
     if (_config.enableCORS) {
         _server->sendHeader("Access-Control-Allow-Origin", "*");
-        _server->sendHeader("Access-Control-Allow-Methods", "GET, POST, OPTIONS");
-        _server->sendHeader("Access-Control-Allow-Headers", "Content-Type, Authorization");
+        _server->sendHeader("Access-Control-Allow-Methods", "GET, POST, PUT, OPTIONS");
+        _server->sendHeader("Access-Control-Allow-Headers", "Content-Type, Authorization, Content-Range, Content-Encoding, X-Firmware-SHA256");
     }
 }
 
@@ -353,30 +1137,151 @@ void OTAWebServer::sendEvent(Event event, const String& message, int value) {
     }
 }
 
-String OTAWebServer::getStatusJSON() {
-    String json = "{";
-    json += "\"status\":\"" + String((int)OTACore::getStatus()) + "\",";
-    json += "\"progress\":" + String(OTACore::getProgress()) + ",";
-    json += "\"error\":\"" + OTACore::getLastError() + "\",";
-    json += "\"uptime\":" + String(millis()) + ",";
-    json += "\"freeHeap\":" + String(ESP.getFreeHeap()) + ",";
-    json += "\"chipId\":\"" + String(ESP.getEfuseMac(), HEX) + "\",";
-    json += "\"flashSize\":" + String(ESP.getFlashChipSize()) + ",";
-    json += "\"network\":{";
-    json += "\"connected\":" + String(NetworkManager::isConnected() ? "true" : "false") + ",";
-    json += "\"ip\":\"" + NetworkManager::getIPAddress() + "\",";
-    json += "\"ssid\":\"" + NetworkManager::getSSID() + "\",";
-    json += "\"rssi\":" + String(NetworkManager::getRSSI());
-    json += "}";
-    json += "}";
-    return json;
-}
-
-String OTAWebServer::getProgressJSON() {
-    String json = "{";
-    json += "\"status\":\"" + String((int)OTACore::getStatus()) + "\",";
-    json += "\"progress\":" + String(OTACore::getProgress()) + ",";
-    json += "\"active\":" + String(OTACore::isActive() ? "true" : "false");
-    json += "}";
-    return json;
+void OTAWebServer::sendJSON(const char* json, size_t length) {
+    // Writers return 0 for a document that did not fit the buffer
+    if (length == 0) {
+        _server->send(500, "text/plain", "Response too large");
+        return;
+    }
+
+    // send_P takes the buffer as-is with a known length, without a String copy
+    _server->send_P(200, "application/json", json, length);
+}
+
+size_t OTAWebServer::writeStatusJSON(char* buffer, size_t size) {
+    char status[8];
+    snprintf(status, sizeof(status), "%d", (int)OTACore::getStatus());
+    OTACore::Metrics metrics = OTACore::getMetrics();
+    OTACore::PrepareInfo prepare = OTACore::getPrepareInfo();
+
+    OTAJson json(buffer, size);
+    json.beginObject()
+        .addString("status", status)
+        .addInt("progress", OTACore::getProgress())
+        .addString("error", OTACore::getLastErrorCStr())
+        .beginObject("metrics")
+            .addUInt("duration", metrics.duration)
+            .addUInt("bytesReceived", metrics.bytesReceived)
+            .addUInt("bytesWritten", metrics.bytesWritten)
+            .addUInt("averageRate", metrics.averageRate)
+            .addUInt("currentRate", metrics.currentRate)
+            .addUInt("chunks", metrics.chunkCount)
+            .addUInt("receiveWaitUs", metrics.receiveWaitUs)
+            .addUInt("processTimeUs", metrics.processTimeUs)
+            .addUInt("writes", metrics.writeCount)
+            .addUInt("writeTimeUs", metrics.writeTimeUs)
+            .addUInt("maxWriteUs", metrics.maxWriteUs)
+            .addUInt("eraseTimeUs", metrics.eraseTimeUs)
+            .addUInt("minFreeHeap", metrics.minFreeHeap)
+            .addUIntArray("writeHistogram", metrics.writeHistogram, OTA_METRICS_BUCKETS)
+            .addUIntArray("chunkHistogram", metrics.chunkHistogram, OTA_METRICS_BUCKETS)
+        .endObject()
+        .addUInt("uptime", millis())
+        .addUInt("freeHeap", ESP.getFreeHeap())
+        .addHex("chipId", ESP.getEfuseMac())
+        .addUInt("flashSize", ESP.getFlashChipSize())
+        .beginObject("server")
+            .addInt("clients", _clientCount)
+            .addUInt("rejectedUploads", _rejectedUploads)
+        .endObject()
+        .beginObject("prepare")
+            .addBool("running", prepare.running)
+            .addUInt("erased", prepare.erased)
+            .addUInt("target", prepare.target)
+            .addString("error", prepare.error ? prepare.error : "")
+        .endObject()
+        .beginObject("network")
+            .addBool("connected", NetworkManager::isConnected())
+            .addIP("ip", NetworkManager::getLocalIP())
+            .addString("ssid", NetworkManager::getSSIDCStr())
+            .addInt("rssi", NetworkManager::getRSSI())
+        .endObject()
+    .endObject();
+    return finishJSON(json, buffer, "Status");
+}
+
+size_t OTAWebServer::writeProgressJSON(char* buffer, size_t size) {
+    char status[8];
+    snprintf(status, sizeof(status), "%d", (int)OTACore::getStatus());
+
+    OTAJson json(buffer, size);
+    json.beginObject()
+        .addString("status", status)
+        .addInt("progress", OTACore::getProgress())
+        .addBool("active", OTACore::isActive())
+    .endObject();
+    return json.length();
+}
+
+size_t OTAWebServer::writeEventJSON(char* buffer, size_t size) {
+    // The error is optional; a long one is left out rather than sent truncated
+    for (int withError = 1; withError >= 0; withError--) {
+        OTAJson json(buffer, size);
+        json.beginObject()
+            .addInt("status", (int)OTACore::getStatus())
+            .addInt("progress", OTACore::getProgress())
+            .addBool("active", OTACore::isActive());
+        if (withError) {
+            json.addString("error", OTACore::getLastErrorCStr());
+        }
+        json.endObject();
+        if (!json.overflow()) {
+            return json.length();
+        }
+    }
+    buffer[0] = '\0';
+    return 0;
+}
+
+size_t OTAWebServer::writeSlotsJSON(char* buffer, size_t size) {
+    OTACore::SlotInfo slots[4];
+    uint8_t count = OTACore::getSlots(slots, 4);
+
+    OTAJson json(buffer, size);
+    json.beginObject()
+        .addBool("pendingVerify", OTACore::isPendingVerify())
+        .addBool("canRollback", OTACore::canRollback())
+        .beginObject("slots");
+    for (uint8_t i = 0; i < count; i++) {
+        char digest[65] = "";
+        if (slots[i].valid) {
+            OTAUtil::formatHex(slots[i].sha256, sizeof(slots[i].sha256), digest);
+        }
+        json.beginObject(slots[i].label)
+            .addBool("running", slots[i].running)
+            .addBool("boot", slots[i].boot)
+            .addBool("valid", slots[i].valid)
+            .addInt("state", (long)slots[i].state)
+            .addUInt("size", slots[i].imageSize)
+            .addString("version", slots[i].version)
+            .addString("project", slots[i].project)
+            .addString("sha256", digest)
+        .endObject();
+    }
+    json.endObject()
+    .endObject();
+    return finishJSON(json, buffer, "Slots");
+}
+
+size_t OTAWebServer::finishJSON(const OTAJson& json, char* buffer, const char* name) {
+    if (!json.overflow()) {
+        return json.length();
+    }
+
+    // A truncated document is not valid JSON; callers answer 500 instead
+    Serial.println("[OTAWebServer] " + String(name) + " JSON exceeds its buffer");
+    buffer[0] = '\0';
+    return 0;
+}
+
+size_t OTAWebServer::writeResumeJSON(char* buffer, size_t size) {
+    OTACore::ResumeInfo info = OTACore::getResumeInfo();
+    OTAJson json(buffer, size);
+    json.beginObject()
+        .addBool("resumable", info.available)
+        .addUInt("offset", info.offset)
+        .addUInt("size", info.imageSize)
+        .addHex("crc", info.imageCRC)
+    .endObject();
+    return json.length();
 }
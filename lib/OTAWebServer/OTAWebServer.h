@@ -5,6 +5,29 @@
 #include <functional>
 #include "OTACore.h"
 
+class RawUploadHandler;
+class OTAJson;
+
+// The AsyncWebServer backend needs ESPAsyncWebServer and AsyncTCP in lib_deps
+// and -DOTA_ASYNC_WEBSERVER in build_flags
+#ifdef OTA_ASYNC_WEBSERVER
+class AsyncWebServer;
+class AsyncWebServerRequest;
+class AsyncWebServerResponse;
+class AsyncEventSource;
+#endif
+
+// Response buffers for the JSON endpoints (rendered on the stack); a document
+// that still does not fit, e.g. from escaped control characters, gets a 500
+#define OTA_STATUS_JSON_SIZE 1152
+#define OTA_SMALL_JSON_SIZE 128
+
+// Slots worst case: 54 bytes of header, 3 of closing and terminator, and per
+// slot 21 (16-char label key) + 43 (three bools) + 20 (state) + 18 (size)
+// + 2 * 44 (31-char version and project) + 75 (sha256) + 1 = 266;
+// 57 + 4 * 266 = 1121 for four slots
+#define OTA_SLOTS_JSON_SIZE 1152
+
 /**
  * @brief Web server interface for OTA updates
  * 
@@ -13,21 +36,44 @@
  */
 class OTAWebServer {
 public:
+    // Content-Length slack for multipart framing
+    static const size_t MULTIPART_OVERHEAD = 1024;
+
+    /**
+     * @brief HTTP server implementation serving the OTA endpoints
+     */
+    enum class Backend {
+        SYNC,                              // WebServer, polled from handle()
+        ASYNC                              // AsyncWebServer, runs on the AsyncTCP task
+    };
+
     /**
      * @brief Server configuration structure
      */
     struct Config {
+        Backend backend;                   // Server implementation
         int port;                          // OTA server port
         String path;                       // OTA endpoint path
         String username;                   // HTTP auth username (optional)
         String password;                   // HTTP auth password (optional)
         bool enableCORS;                   // Enable CORS headers
         bool enableProgress;               // Enable progress endpoint
-        size_t maxUploadSize;              // Max upload size (1MB default)
+        size_t maxUploadSize;              // Largest accepted upload body (0 = update partition size)
+        bool enableRawUpload;              // Enable PUT <path>/raw octet-stream endpoint
+        size_t rawBlockSize;               // Socket read size for raw uploads
+        size_t socketRxBuffer;             // SO_RCVBUF of the upload socket (0 = lwIP default)
+        bool noDelay;                      // TCP_NODELAY on the upload socket
+        bool backpressure;                 // Raw uploads read only what the flash writer can take
+        uint32_t retryAfter;               // Retry-After seconds when no estimate is available
+        bool enableEvents;                 // Enable GET <path>/events progress stream (SSE)
+        unsigned long eventInterval;       // Minimum ms between progress events
         
         // Constructor with default values
-        Config() : port(3232), path("/update"), username(""), password(""), 
-                   enableCORS(true), enableProgress(true), maxUploadSize(1048576) {}
+        Config() : backend(Backend::SYNC), port(3232), path("/update"), username(""), password(""), 
+                   enableCORS(true), enableProgress(true), maxUploadSize(0),
+                   enableRawUpload(true), rawBlockSize(4096),
+                   socketRxBuffer(0), noDelay(true), backpressure(true), retryAfter(10),
+                   enableEvents(true), eventInterval(500) {}
     };
 
     /**
@@ -99,10 +145,31 @@ public:
 
     /**
      * @brief Get connected clients count
+     *
+     * Counts the connection of a running upload and open event streams.
+     *
      * @return Number of connected clients
      */
     static int getClientCount();
 
+    /**
+     * @brief Get number of uploads refused because another update was running
+     * @return Rejected upload count since begin()
+     */
+    static uint32_t getRejectedUploads();
+
+    /**
+     * @brief Get the largest upload body accepted
+     * @return maxUploadSize, capped at the update partition size
+     */
+    static size_t getUploadLimit();
+
+    /**
+     * @brief Get number of open progress event streams
+     * @return Number of connected SSE clients
+     */
+    static int getEventClientCount();
+
     /**
      * @brief Add custom endpoint to OTA server
      * @param path Endpoint path
@@ -110,6 +177,12 @@ public:
      */
     static void addCustomEndpoint(const String& path, std::function<void()> handler);
 
+    /**
+     * @brief Get the underlying server, e.g. to read arguments in a custom endpoint
+     * @return Sync backend server (nullptr when stopped or on the async backend)
+     */
+    static WebServer* getServer();
+
     /**
      * @brief Enable/disable authentication
      * @param username HTTP auth username
@@ -122,15 +195,77 @@ public:
      */
     static void removeAuthentication();
 
+    /**
+     * @brief Send the gzip-compressed upload page stored in flash
+     *
+     * Answers 304 when the request carries a matching If-None-Match
+     * (the header must be collected by @p server).
+     *
+     * @param server Server handling the current request
+     */
+    static void sendUI(WebServer& server);
+
+#ifdef OTA_ASYNC_WEBSERVER
+    /**
+     * @brief Send the upload page on an AsyncWebServer request
+     * @param request Request to answer
+     */
+    static void sendUI(AsyncWebServerRequest* request);
+#endif
+
 private:
+    friend class RawUploadHandler;
+
     static WebServer* _server;
     static Config _config;
     static CallbackFunction _callback;
     static bool _running;
     static int _clientCount;
+    static bool _uploadActive;
+    static bool _uploadSkipped;
+    static uint32_t _rejectedUploads;
     static unsigned long _uploadStartTime;
     static size_t _uploadSize;
     static size_t _uploadReceived;
+    static int _uploadProgress;
+    static int _uploadStatusCode;
+    static String _uploadMessage;
+    static uint8_t* _rawBuffer;
+    static OTAArena::Region _serverRegion;
+    static OTAArena::Region _rawRegion;
+    static const unsigned long RAW_READ_TIMEOUT_MS = 5000;
+    static const unsigned long PENDING_HEADER_TIMEOUT_MS = 2000;  // Time a queued client has to send its headers
+    static const size_t PENDING_HEADER_LIMIT = 2048;             // Request bytes read before giving up on one
+    static const uint32_t MAX_RETRY_AFTER = 300;
+    static const unsigned long REBOOT_RESPONSE_MS = 1000;
+
+    /**
+     * @brief Connection taken from the accept queue during an upload
+     *
+     * Only bytes that have already arrived are read, so a client that
+     * trickles its headers never holds up the upload loop.
+     */
+    struct PendingClient {
+        WiFiClient client;
+        unsigned long acceptedAt;
+        char line[128];                    // Request line
+        uint8_t lineLength;
+        bool lineDone;                     // Request line complete, skipping headers
+        bool lineEmpty;                    // Nothing but CR so far on the current line
+        size_t received;                   // Request bytes read
+    };
+
+    static const int MAX_PENDING_CLIENTS = 4;
+    static PendingClient _pendingClients[MAX_PENDING_CLIENTS];
+
+    static const int MAX_EVENT_CLIENTS = 4;
+    static const unsigned long EVENT_HEARTBEAT_MS = 15000;
+    static WiFiClient _eventClients[MAX_EVENT_CLIENTS];
+    static int _eventClientCount;
+    static unsigned long _lastEventTime;
+    static unsigned long _lastHeartbeat;
+    static int _lastEventStatus;
+    static int _lastEventProgress;
 
     static void setupRoutes();
     static void handleUpdate();
@@ -138,10 +273,68 @@ private:
     static void handleProgress();
     static void handleStatus();
     static void handleReboot();
+    static void handleResume();
+    static void handleSlots();
+    static void handleRollback();
+    static void handlePrepare();
+    static bool createServer();
+    static void destroyServer();
+    static void handleEvents();
+    static void pushEvents();
+    static void broadcastEvent(const char* message, size_t length);
+    static void closeEventClients();
+    static void handleUpload();
+    static void handleRawUpload(WiFiClient& client, size_t contentLength);
+    static void tuneSocket(WiFiClient& client);
+    static void failUpload(int code, const String& message);
+    static bool admitUpload();
+    static bool skipInstalled(const String& digest);
+    static bool enforceUploadLimit(size_t size);
+    static void dropUpload();
+    static void setUploadActive(bool active);
+    static void updateClientCount();
+    static uint32_t retryAfter();
+    static void servePendingClient();
+    static bool readPendingClient(PendingClient& pending);
+    static void answerPendingClient(WiFiClient& client, char* line);
+    static void closePendingClients();
+    static const char* reasonPhrase(int code);
+    static void sendDirect(WiFiClient& client, int code, const char* type, const char* body, size_t length);
+    static void reportUploadProgress();
+    static bool parseContentRange(const String& header, size_t& start, size_t& total);
+    static bool applyExpectedDigest(const String& digest);
     static void handleNotFound();
     static void sendCORSHeaders();
     static bool authenticate();
     static void sendEvent(Event event, const String& message = "", int value = 0);
-    static String getStatusJSON();
-    static String getProgressJSON();
+    static void sendJSON(const char* json, size_t length);
+    static String requestDigest();
+    static size_t writeStatusJSON(char* buffer, size_t size);
+    static size_t writeProgressJSON(char* buffer, size_t size);
+    static size_t writeResumeJSON(char* buffer, size_t size);
+    static size_t writeSlotsJSON(char* buffer, size_t size);
+    static size_t writeEventJSON(char* buffer, size_t size);
+    static size_t finishJSON(const OTAJson& json, char* buffer, const char* name);
+
+#ifdef OTA_ASYNC_WEBSERVER
+    static AsyncWebServer* _asyncServer;
+    static OTAArena::Region _asyncServerRegion;
+    static AsyncEventSource* _asyncEvents;
+    static AsyncWebServerRequest* _asyncUpload;
+
+    static bool beginAsync();
+    static void stopAsync();
+    static void dropAsyncUpload(AsyncWebServerRequest* request, int code, const char* message);
+    static void setupAsyncRoutes();
+    static bool authenticateAsync(AsyncWebServerRequest* request);
+    static void sendAsyncCORSHeaders(AsyncWebServerResponse* response);
+    static void sendAsyncJSON(AsyncWebServerRequest* request, const char* json);
+    static void sendAsyncResult(AsyncWebServerRequest* request);
+    static bool startAsyncUpload(AsyncWebServerRequest* request, size_t contentLength, bool raw);
+    static void writeAsyncUpload(AsyncWebServerRequest* request, uint8_t* data, size_t len, bool final);
+    static void handleAsyncUpload(AsyncWebServerRequest* request, const String& filename,
+                                  size_t index, uint8_t* data, size_t len, bool final);
+    static void handleAsyncBody(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                                size_t index, size_t total);
+#endif
 };
@@ -0,0 +1,400 @@
+#include "OTAWebServer.h"
+
+#ifdef OTA_ASYNC_WEBSERVER
+
+#include <ESPAsyncWebServer.h>
+#include <new>
+
+// Static member definitions
+AsyncWebServer* OTAWebServer::_asyncServer = nullptr;
+OTAArena::Region OTAWebServer::_asyncServerRegion;
+AsyncEventSource* OTAWebServer::_asyncEvents = nullptr;
+AsyncWebServerRequest* OTAWebServer::_asyncUpload = nullptr;
+
+/*
+ * AsyncWebServer backend
+ *
+ * Requests are parsed on the AsyncTCP task and upload chunks are handed to
+ * OTACore as they arrive, so an update keeps going while loop() is busy or
+ * blocked. Only one upload is accepted at a time; the request that started
+ * it owns the session until its response is sent or the client drops.
+ */
+
+bool OTAWebServer::beginAsync() {
+#if OTA_STATIC_MEMORY
+    void* memory = OTAArena::claim(_asyncServerRegion, sizeof(AsyncWebServer), alignof(AsyncWebServer));
+    _asyncServer = memory ? new (memory) AsyncWebServer(_config.port) : nullptr;
+#else
+    _asyncServer = new AsyncWebServer(_config.port);
+#endif
+    if (!_asyncServer) {
+        Serial.println("[OTAWebServer] Failed to create async server instance");
+        return false;
+    }
+
+    setupAsyncRoutes();
+    _asyncServer->begin();
+    return true;
+}
+
+void OTAWebServer::stopAsync() {
+    if (!_asyncServer) {
+        return;
+    }
+
+    if (_asyncUpload && OTACore::isActive()) {
+        OTACore::suspendUpdate();
+    }
+    _asyncUpload = nullptr;
+
+    // The event source is owned by the server and freed with it
+    _asyncServer->end();
+#if OTA_STATIC_MEMORY
+    _asyncServer->~AsyncWebServer();
+#else
+    delete _asyncServer;
+#endif
+    _asyncServer = nullptr;
+    _asyncEvents = nullptr;
+}
+
+void OTAWebServer::dropAsyncUpload(AsyncWebServerRequest* request, int code, const char* message) {
+    // Answer now and close so the client stops sending the rest of the body
+    const char* reason = reasonPhrase(code);
+    size_t length = strlen(message);
+    char header[192];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\n"
+                     "Content-Length: %u\r\nConnection: close\r\n",
+                     code, reason, (unsigned)length);
+    if (code == 409) {
+        n += snprintf(header + n, sizeof(header) - n, "Retry-After: %u\r\n", (unsigned)retryAfter());
+    }
+    n += snprintf(header + n, sizeof(header) - n, "\r\n");
+    request->client()->write(header, n);
+    request->client()->write(message, length);
+    request->client()->close();
+}
+
+void OTAWebServer::setupAsyncRoutes() {
+    // Main OTA upload page
+    _asyncServer->on(_config.path.c_str(), HTTP_GET, [](AsyncWebServerRequest* request) {
+        if (!authenticateAsync(request)) return;
+        sendUI(request);
+    });
+
+    // Multipart upload; the request handler runs once the body is complete
+    _asyncServer->on(_config.path.c_str(), HTTP_POST, sendAsyncResult, handleAsyncUpload);
+
+    // Raw binary upload, passed through as body chunks
+    if (_config.enableRawUpload) {
+        _asyncServer->on((_config.path + "/raw").c_str(), HTTP_PUT, sendAsyncResult, nullptr, handleAsyncBody);
+    }
+
+    // Application slots; verifying and hashing both images takes a few hundred ms
+    _asyncServer->on((_config.path + "/slots").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) {
+        if (!authenticateAsync(request)) return;
+
+        char json[OTA_SLOTS_JSON_SIZE];
+        writeSlotsJSON(json, sizeof(json));
+        sendAsyncJSON(request, json);
+    });
+
+    // Rollback; restart once the response has gone out
+    _asyncServer->on((_config.path + "/rollback").c_str(), HTTP_POST, [](AsyncWebServerRequest* request) {
+        if (!authenticateAsync(request)) return;
+
+        AsyncWebServerResponse* response;
+        if (OTACore::rollback(false)) {
+            request->onDisconnect([]() {
+                OTACore::restart();
+            });
+            response = request->beginResponse(200, "text/plain", "Rolling back...");
+            response->addHeader("Connection", "close");
+        } else {
+            response = request->beginResponse(409, "text/plain", OTACore::getLastError());
+        }
+        sendAsyncCORSHeaders(response);
+        request->send(response);
+    });
+
+    // Pre-erase the inactive slot ahead of an announced upload
+    _asyncServer->on((_config.path + "/prepare").c_str(), HTTP_POST, [](AsyncWebServerRequest* request) {
+        if (!authenticateAsync(request)) return;
+
+        size_t size = request->hasParam("size") ? strtoul(request->getParam("size")->value().c_str(), nullptr, 10) : 0;
+        AsyncWebServerResponse* response = OTACore::prepareUpdate(size)
+            ? request->beginResponse(202, "text/plain", "Erasing")
+            : request->beginResponse(409, "text/plain", OTACore::getLastError());
+        sendAsyncCORSHeaders(response);
+        request->send(response);
+    });
+
+    // Resume endpoint
+    _asyncServer->on((_config.path + "/resume").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) {
+        if (!authenticateAsync(request)) return;
+
+        char json[OTA_SMALL_JSON_SIZE];
+        writeResumeJSON(json, sizeof(json));
+        sendAsyncJSON(request, json);
+    });
+
+    // Progress endpoint
+    if (_config.enableProgress) {
+        _asyncServer->on((_config.path + "/progress").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) {
+            if (!authenticateAsync(request)) return;
+
+            char json[OTA_SMALL_JSON_SIZE];
+            writeProgressJSON(json, sizeof(json));
+            sendAsyncJSON(request, json);
+        });
+    }
+
+    // Progress event stream
+    if (_config.enableEvents) {
+        _asyncEvents = new AsyncEventSource(_config.path + "/events");
+        if (_config.username.length() > 0) {
+            _asyncEvents->setAuthentication(_config.username.c_str(), _config.password.c_str());
+        }
+        _asyncEvents->onConnect([](AsyncEventSourceClient* client) {
+            // Current state first, then only changes
+            char json[OTA_SMALL_JSON_SIZE * 2];
+            writeEventJSON(json, sizeof(json));
+            client->send(json, "progress", millis(), 2000);
+        });
+        _asyncServer->addHandler(_asyncEvents);
+    }
+
+    // Status endpoint
+    _asyncServer->on((_config.path + "/status").c_str(), HTTP_GET, [](AsyncWebServerRequest* request) {
+        char json[OTA_STATUS_JSON_SIZE];
+        writeStatusJSON(json, sizeof(json));
+        sendAsyncJSON(request, json);
+    });
+
+    // Reboot endpoint; restart once the response has gone out
+    _asyncServer->on((_config.path + "/reboot").c_str(), HTTP_POST, [](AsyncWebServerRequest* request) {
+        if (!authenticateAsync(request)) return;
+
+        request->onDisconnect([]() {
+            OTACore::scheduleReboot();
+        });
+        AsyncWebServerResponse* response = request->beginResponse(200, "text/plain", "Rebooting...");
+        sendAsyncCORSHeaders(response);
+        response->addHeader("Connection", "close");
+        request->send(response);
+    });
+
+    // 404 handler
+    _asyncServer->onNotFound([](AsyncWebServerRequest* request) {
+        AsyncWebServerResponse* response = request->beginResponse(404, "text/plain", "Not found");
+        sendAsyncCORSHeaders(response);
+        request->send(response);
+    });
+}
+
+bool OTAWebServer::authenticateAsync(AsyncWebServerRequest* request) {
+    if (_config.username.length() == 0) {
+        return true; // No authentication required
+    }
+
+    if (!request->authenticate(_config.username.c_str(), _config.password.c_str())) {
+        request->requestAuthentication();
+        return false;
+    }
+
+    return true;
+}
+
+void OTAWebServer::sendAsyncCORSHeaders(AsyncWebServerResponse* response) {
+    if (_config.enableCORS) {
+        response->addHeader("Access-Control-Allow-Origin", "*");
+        response->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT, OPTIONS");
+        response->addHeader("Access-Control-Allow-Headers", "Content-Type, Authorization, Content-Range, Content-Encoding, X-Firmware-SHA256");
+    }
+}
+
+void OTAWebServer::sendAsyncJSON(AsyncWebServerRequest* request, const char* json) {
+    // The response is sent after the handler returns, so the stack buffer is copied;
+    // writers leave the buffer empty for a document that did not fit
+    AsyncWebServerResponse* response = json[0] != '\0'
+        ? request->beginResponse(200, "application/json", json)
+        : request->beginResponse(500, "text/plain", "Response too large");
+    sendAsyncCORSHeaders(response);
+    request->send(response);
+}
+
+void OTAWebServer::sendAsyncResult(AsyncWebServerRequest* request) {
+    bool owner = request == _asyncUpload;
+    if (owner) {
+        _asyncUpload = nullptr;
+    }
+    if (!authenticateAsync(request)) return;
+
+    int code;
+    String message;
+    if (owner) {
+        code = _uploadStatusCode;
+        message = _uploadStatusCode == 200 && !_uploadSkipped ? String("Update completed") : _uploadMessage;
+    } else if (OTACore::isActive()) {
+        _rejectedUploads++;
+        code = 409;
+        message = "Another upload is in progress";
+    } else {
+        code = 400;
+        message = "No firmware received";
+    }
+
+    AsyncWebServerResponse* response = request->beginResponse(code, "text/plain", message);
+    if (code == 409) {
+        response->addHeader("Retry-After", String(retryAfter()));
+    }
+    sendAsyncCORSHeaders(response);
+    request->send(response);
+}
+
+bool OTAWebServer::startAsyncUpload(AsyncWebServerRequest* request, size_t contentLength, bool raw) {
+    if (_asyncUpload) {
+        // Refused on its first chunk; the shared upload state stays with the owner
+        _rejectedUploads++;
+        Serial.println("[OTAWebServer] Upload refused: another upload is in progress");
+        dropAsyncUpload(request, 409, "Another upload is in progress");
+        return false;
+    }
+
+    _asyncUpload = request;
+    _uploadStartTime = millis();
+    _uploadSize = contentLength;
+    _uploadReceived = 0;
+    _uploadProgress = -1;
+    _uploadStatusCode = 200;
+    _uploadMessage = "";
+    _uploadSkipped = false;
+
+    // A dropped connection keeps what reached flash so the client can resume
+    request->onDisconnect([request]() {
+        if (_asyncUpload != request) return;
+        _asyncUpload = nullptr;
+        setUploadActive(false);
+        if (OTACore::isActive()) {
+            OTACore::suspendUpdate();
+            Serial.println("[OTAWebServer] Upload interrupted at offset " +
+                           String(OTACore::getResumeInfo().offset));
+            sendEvent(Event::UPLOAD_ERROR, "Upload interrupted", OTACore::getResumeInfo().offset);
+        }
+    });
+
+    if (_config.username.length() > 0 &&
+        !request->authenticate(_config.username.c_str(), _config.password.c_str())) {
+        failUpload(401, "Authentication required");
+        return false;
+    }
+
+    size_t rangeStart = 0;
+    size_t rangeTotal = 0;
+    bool ranged = request->hasHeader("Content-Range") &&
+                  parseContentRange(request->getHeader("Content-Range")->value(), rangeStart, rangeTotal);
+    if (ranged) {
+        _uploadSize = rangeTotal;
+        _uploadReceived = rangeStart;
+    }
+
+    Serial.println(String("[OTAWebServer] ") + (raw ? "Raw upload" : "Upload") + " started: " +
+                   String(contentLength) + " bytes" +
+                   (ranged ? " (from offset " + String(rangeStart) + ")" : ""));
+    sendEvent(Event::UPLOAD_START, raw ? "Raw upload started" : "Upload started", _uploadSize);
+
+    bool gzip = request->hasHeader("Content-Encoding") &&
+                request->getHeader("Content-Encoding")->value().equalsIgnoreCase("gzip");
+
+    String digest;
+    if (request->hasHeader("X-Firmware-SHA256")) {
+        digest = request->getHeader("X-Firmware-SHA256")->value();
+    } else if (request->hasParam("sha256")) {
+        digest = request->getParam("sha256")->value();
+    }
+
+    // Refused, skipped or oversized: answer now instead of taking the body
+    size_t declared = ranged ? rangeTotal
+                    : raw ? contentLength
+                    : contentLength > MULTIPART_OVERHEAD ? contentLength - MULTIPART_OVERHEAD : 0;
+    if (!admitUpload() || (!ranged && skipInstalled(digest)) || !enforceUploadLimit(declared)) {
+        dropAsyncUpload(request, _uploadStatusCode, _uploadMessage.c_str());
+        return false;
+    }
+
+    if (ranged && rangeStart > 0) {
+        if (!OTACore::resumeUpdate(rangeTotal, rangeStart)) {
+            failUpload(416, OTACore::getLastError());
+            return false;
+        }
+    } else if (!OTACore::startUpdate(_uploadSize, "",
+                                     raw && gzip ? OTACore::Encoding::GZIP : OTACore::Encoding::AUTO)) {
+        failUpload(500, "Failed to start OTA update: " + OTACore::getLastError());
+        return false;
+    }
+
+    if (!applyExpectedDigest(digest)) {
+        OTACore::abortUpdate();
+        return false;
+    }
+
+    setUploadActive(true);
+    return true;
+}
+
+void OTAWebServer::writeAsyncUpload(AsyncWebServerRequest* request, uint8_t* data, size_t len, bool final) {
+    if (request != _asyncUpload || _uploadStatusCode != 200 || _uploadSkipped) return;
+
+    if (len > 0) {
+        // Checked before the chunk reaches flash
+        if (!enforceUploadLimit(_uploadReceived + len)) {
+            dropAsyncUpload(request, _uploadStatusCode, _uploadMessage.c_str());
+            return;
+        }
+        _uploadReceived += len;
+        if (OTACore::writeData(data, len) != (int)len) {
+            failUpload(500, "Write error: " + OTACore::getLastError());
+            return;
+        }
+        reportUploadProgress();
+        pushEvents();
+    }
+
+    if (final) {
+        setUploadActive(false);
+        if (OTACore::finishUpdate()) {
+            Serial.println("[OTAWebServer] Upload completed successfully");
+            sendEvent(Event::UPLOAD_COMPLETE, "Upload completed successfully", 100);
+        } else {
+            failUpload(500, "Upload failed: " + OTACore::getLastError());
+        }
+        pushEvents();
+    }
+}
+
+void OTAWebServer::handleAsyncUpload(AsyncWebServerRequest* request, const String& filename,
+                                     size_t index, uint8_t* data, size_t len, bool final) {
+    if (index == 0) {
+        // The file size is not known yet for multipart bodies; the request
+        // length is a close upper bound (file plus multipart framing)
+        Serial.println("[OTAWebServer] Receiving " + filename);
+        if (!startAsyncUpload(request, request->contentLength(), false)) return;
+    }
+
+    writeAsyncUpload(request, data, len, final);
+}
+
+void OTAWebServer::handleAsyncBody(AsyncWebServerRequest* request, uint8_t* data, size_t len,
+                                   size_t index, size_t total) {
+    if (index == 0) {
+        if (total == 0) {
+            return;
+        }
+        if (!startAsyncUpload(request, total, true)) return;
+    }
+
+    writeAsyncUpload(request, data, len, index + len >= total);
+}
+
+#endif
@@ -0,0 +1,107 @@
+#pragma once
+
+// Generated by tools/embed_ui.py from ui/index.html - do not edit
+
+#include <Arduino.h>
+
+#define OTA_UI_ETAG "\"80e7d181c04a01a7\""
+
+static const size_t OTA_UI_HTML_GZ_LEN = 1533;
+static const uint8_t OTA_UI_HTML_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xc5, 0x58, 0xdb, 0x6e, 0xdb, 0x46,
+    0x10, 0x7d, 0xcf, 0x57, 0x6c, 0x18, 0x04, 0x94, 0x5b, 0x8b, 0xa2, 0x2c, 0x5f, 0x0a, 0x5d, 0x0c,
+    0x24, 0xb6, 0x83, 0x04, 0x48, 0x1a, 0xa3, 0x76, 0x80, 0x16, 0x41, 0x1e, 0x96, 0xe4, 0x50, 0x5c,
+    0x84, 0xe2, 0xb2, 0xcb, 0xa5, 0x65, 0x37, 0xf0, 0xbf, 0x77, 0x86, 0x37, 0x91, 0xd4, 0x52, 0xcd,
+    0x5b, 0x29, 0x18, 0x22, 0x57, 0x33, 0x67, 0xcf, 0x5c, 0x77, 0xe8, 0xe5, 0xcb, 0xeb, 0xcf, 0x57,
+    0xf7, 0x7f, 0xdd, 0xde, 0xb0, 0x48, 0x6f, 0xe2, 0xcb, 0x17, 0xcb, 0xfa, 0x0b, 0x78, 0x70, 0xf9,
+    0x82, 0xe1, 0xb5, 0xd4, 0x42, 0xc7, 0x70, 0x79, 0x73, 0x77, 0x3b, 0x3b, 0x61, 0x9f, 0xef, 0xdf,
+    0xb0, 0x2f, 0x69, 0xc0, 0x35, 0x2c, 0x27, 0xe5, 0x7a, 0x29, 0xb3, 0x01, 0xcd, 0x59, 0xc2, 0x37,
+    0xb0, 0xb2, 0x1e, 0x04, 0x6c, 0x53, 0xa9, 0xb4, 0xc5, 0x7c, 0x99, 0x68, 0x48, 0xf4, 0xca, 0xda,
+    0x8a, 0x40, 0x47, 0xab, 0x00, 0x1e, 0x84, 0x0f, 0xe3, 0xe2, 0xe1, 0x98, 0x89, 0x44, 0x68, 0xc1,
+    0xe3, 0x71, 0xe6, 0xf3, 0x18, 0x56, 0x53, 0xab, 0x02, 0xca, 0xf4, 0x53, 0x0d, 0x4a, 0x97, 0x27,
+    0x83, 0x27, 0xf6, 0x83, 0x85, 0x88, 0x34, 0x0e, 0xf9, 0x46, 0xc4, 0x4f, 0x73, 0xf6, 0x46, 0xa1,
+    0xde, 0x31, 0xcb, 0x78, 0x92, 0x8d, 0x33, 0x50, 0x22, 0x5c, 0xb0, 0x0d, 0x57, 0x6b, 0x91, 0xcc,
+    0xd9, 0xa9, 0x9b, 0x3e, 0x2e, 0x98, 0xc7, 0xfd, 0xef, 0x6b, 0x25, 0xf3, 0x24, 0x18, 0xfb, 0x32,
+    0x96, 0x6a, 0xce, 0x5e, 0x85, 0x2e, 0x7d, 0x16, 0xec, 0xb9, 0x41, 0x76, 0x88, 0x1d, 0x17, 0x09,
+    0x28, 0xc4, 0xdf, 0xf0, 0xc7, 0x92, 0xd7, 0x9c, 0x9d, 0xbb, 0x05, 0x46, 0x8d, 0xe8, 0x32, 0x9e,
+    0x6b, 0xd9, 0xc6, 0x9c, 0xb3, 0x6d, 0x24, 0x34, 0x2c, 0x58, 0xca, 0x83, 0x40, 0x24, 0xeb, 0x39,
+    0x9b, 0x95, 0xbb, 0x4a, 0x15, 0x80, 0x1a, 0x2b, 0x1e, 0x88, 0x3c, 0x9b, 0xb3, 0x69, 0xb5, 0xf8,
+    0x38, 0xce, 0x22, 0x1e, 0xc8, 0x2d, 0x41, 0x9d, 0xa6, 0x8f, 0xec, 0x1c, 0xff, 0xd4, 0xda, 0xe3,
+    0x23, 0xf7, 0xb8, 0xf8, 0x38, 0xd3, 0xa3, 0x36, 0xad, 0x68, 0x8a, 0x74, 0x6a, 0xd6, 0xb3, 0xd9,
+    0x6c, 0xc1, 0x34, 0x3c, 0xea, 0x31, 0x8f, 0xc5, 0x1a, 0xd9, 0xf8, 0xe8, 0x4e, 0x50, 0x1d, 0x33,
+    0xf2, 0x34, 0x96, 0x3c, 0x18, 0x73, 0x05, 0x1c, 0x35, 0x4b, 0x12, 0x73, 0x76, 0x82, 0xbb, 0x04,
+    0x3c, 0x8b, 0x20, 0x60, 0xaf, 0x7c, 0xdf, 0x1f, 0x60, 0xd7, 0x58, 0x50, 0xfa, 0xcd, 0xb4, 0x53,
+    0xed, 0x87, 0x13, 0x94, 0x60, 0xee, 0xd0, 0xce, 0xf3, 0x48, 0x3e, 0x14, 0x8e, 0xac, 0xb6, 0xa9,
+    0x0d, 0x70, 0xdd, 0x0b, 0x2f, 0x0c, 0xdb, 0x5a, 0x22, 0x49, 0x73, 0xfd, 0x55, 0x3f, 0xa5, 0x98,
+    0x29, 0xa1, 0x88, 0xc1, 0xfa, 0x56, 0xb8, 0x7f, 0x68, 0x13, 0x2f, 0xd7, 0x5a, 0x26, 0x04, 0xbc,
+    0x1f, 0xd3, 0x1a, 0xbc, 0x7a, 0xee, 0x47, 0x85, 0x4c, 0x2c, 0x10, 0x17, 0x8d, 0x57, 0x12, 0x99,
+    0xc0, 0x9e, 0x2b, 0xce, 0x48, 0xc2, 0xcf, 0x55, 0x46, 0x20, 0xa9, 0x14, 0xa5, 0xdd, 0x45, 0xc6,
+    0x65, 0xe2, 0x1f, 0x40, 0xa0, 0x73, 0x92, 0xe8, 0x73, 0xda, 0x99, 0x6c, 0x62, 0x76, 0x76, 0xee,
+    0xcd, 0x0c, 0x3a, 0x81, 0xc8, 0xb8, 0x17, 0x63, 0x50, 0x8c, 0x6a, 0x45, 0xa0, 0x6a, 0x26, 0x89,
+    0xa4, 0x58, 0xc4, 0x72, 0x0b, 0x41, 0xc7, 0xeb, 0xa9, 0x92, 0x6b, 0x05, 0x59, 0x86, 0x10, 0x55,
+    0xc6, 0x4e, 0x5d, 0xf7, 0xf5, 0xc1, 0xa4, 0x37, 0xc6, 0xbe, 0xef, 0xf3, 0x08, 0xc4, 0x3a, 0xd2,
+    0xf3, 0xca, 0x63, 0x64, 0x5b, 0x18, 0x53, 0xd6, 0x46, 0x22, 0x08, 0x20, 0x31, 0x52, 0x18, 0x7b,
+    0x9c, 0x1c, 0x50, 0x6b, 0x0e, 0xf2, 0xa8, 0x03, 0x55, 0xf1, 0x25, 0x29, 0xad, 0xb0, 0x7a, 0xb1,
+    0x01, 0xa0, 0x4f, 0xca, 0x65, 0xe6, 0x3a, 0xb3, 0xac, 0xb3, 0x4b, 0xa6, 0xb9, 0xce, 0x33, 0x43,
+    0x76, 0x74, 0x22, 0x6c, 0x0e, 0xe7, 0x1e, 0x8c, 0x93, 0xe5, 0xbe, 0x5f, 0x7a, 0xcd, 0x40, 0x30,
+    0x38, 0x85, 0x20, 0xe0, 0x4d, 0x26, 0xbd, 0x9a, 0x9e, 0x9d, 0x5d, 0x9c, 0x9c, 0xee, 0xf2, 0x66,
+    0x8a, 0x1b, 0x67, 0x32, 0x16, 0x54, 0x4c, 0x33, 0x38, 0xf7, 0x3d, 0xd3, 0x0e, 0xa0, 0x94, 0x1c,
+    0xc8, 0x87, 0xf0, 0xb7, 0xe0, 0xa2, 0x8d, 0x7f, 0x71, 0x32, 0xf5, 0x07, 0xf0, 0xc3, 0x33, 0x7f,
+    0x00, 0x5f, 0x24, 0xa1, 0x1c, 0xa0, 0x3f, 0x05, 0x3f, 0x9c, 0xee, 0xe0, 0x5d, 0xff, 0xec, 0xf4,
+    0xdc, 0x35, 0xc2, 0x7b, 0x00, 0x67, 0xd0, 0xc0, 0x2f, 0x27, 0x55, 0xbb, 0x5d, 0x4e, 0xca, 0x7e,
+    0xbf, 0xa4, 0x7e, 0x5b, 0x75, 0xe2, 0x40, 0x3c, 0x30, 0x3f, 0xe6, 0x59, 0xb6, 0xb2, 0x9a, 0x56,
+    0x69, 0xed, 0x3a, 0xf3, 0x32, 0x9a, 0x1a, 0xce, 0x04, 0x5c, 0xdc, 0x49, 0xb4, 0x10, 0x5a, 0xbd,
+    0xa2, 0x85, 0x51, 0x48, 0xa5, 0x97, 0x77, 0x10, 0x83, 0xaf, 0x59, 0x28, 0xd4, 0x66, 0x8b, 0x12,
+    0x8c, 0xfa, 0x02, 0x1b, 0x39, 0x9e, 0x48, 0x8e, 0x98, 0x96, 0xac, 0xd4, 0x5d, 0x4e, 0xd2, 0x9e,
+    0x62, 0x28, 0xd5, 0x86, 0xe1, 0xc1, 0x13, 0xc9, 0x60, 0x65, 0xdd, 0x7e, 0xbe, 0xbb, 0xb7, 0x18,
+    0xf7, 0x29, 0xa5, 0x56, 0xd6, 0x2b, 0x8b, 0x41, 0xe2, 0x97, 0x5d, 0x66, 0x93, 0xc7, 0x5a, 0xa4,
+    0x5c, 0xe9, 0x09, 0x29, 0x8c, 0x91, 0x27, 0xb7, 0x98, 0x08, 0x6a, 0x4e, 0xef, 0x70, 0xb1, 0x47,
+    0xa9, 0x40, 0x2f, 0x1a, 0x15, 0x6b, 0x35, 0xaa, 0xea, 0x78, 0xcb, 0x0b, 0x4b, 0x69, 0x2b, 0x1f,
+    0x52, 0x3c, 0xdb, 0x88, 0x66, 0x89, 0x47, 0x52, 0x1f, 0x48, 0xcb, 0x62, 0x0a, 0xfe, 0xce, 0x85,
+    0x82, 0xc0, 0x80, 0xeb, 0x29, 0xd3, 0x62, 0xd9, 0xe6, 0xca, 0xdd, 0xb2, 0xdc, 0xdb, 0x08, 0xdd,
+    0xe6, 0xf8, 0x56, 0x27, 0xd6, 0xe5, 0x97, 0xe2, 0x96, 0xbd, 0xab, 0xbc, 0xb4, 0x9c, 0x94, 0x4a,
+    0x3d, 0xa7, 0x14, 0x46, 0xb6, 0x62, 0x30, 0xc1, 0x20, 0x98, 0x43, 0x52, 0x57, 0x71, 0xb9, 0x51,
+    0xfd, 0x74, 0xd5, 0x84, 0x9a, 0x15, 0xb9, 0xb1, 0xb2, 0xb0, 0x67, 0xa5, 0x31, 0x7f, 0xaa, 0xba,
+    0x67, 0x3f, 0x7a, 0x06, 0x40, 0x6a, 0x0b, 0x5d, 0xd0, 0xb7, 0xb8, 0x70, 0xd9, 0xa7, 0x62, 0x60,
+    0x46, 0x3a, 0x65, 0xb6, 0x77, 0xc4, 0xab, 0xdb, 0x6a, 0x40, 0xf0, 0x95, 0x48, 0xf5, 0x4e, 0x31,
+    0x90, 0x7e, 0xbe, 0xc1, 0xc3, 0xca, 0x59, 0x83, 0xbe, 0x89, 0x81, 0x6e, 0xdf, 0x3e, 0x7d, 0x08,
+    0x46, 0xf6, 0x2e, 0xbc, 0xf6, 0x91, 0x83, 0x2d, 0xe3, 0xe6, 0x01, 0x7f, 0xfa, 0x28, 0x32, 0x1c,
+    0x49, 0x40, 0x8d, 0xec, 0xd2, 0xcb, 0xf6, 0x31, 0x0b, 0xf3, 0xa4, 0xc8, 0x9a, 0x11, 0x1c, 0xb1,
+    0x1f, 0x1d, 0xe3, 0x00, 0x3b, 0x1d, 0x90, 0xd6, 0x35, 0x84, 0x1c, 0xb3, 0x68, 0x74, 0xb4, 0xe8,
+    0xfc, 0x5e, 0xed, 0x80, 0x61, 0x6f, 0xff, 0xf2, 0x8c, 0xf7, 0xcd, 0x43, 0x0d, 0xde, 0x91, 0xed,
+    0x6d, 0x83, 0xd5, 0x95, 0x69, 0xd6, 0x64, 0x0f, 0x5b, 0x0d, 0xdb, 0xd4, 0x08, 0xd9, 0x3d, 0x2a,
+    0x3b, 0x0c, 0x54, 0x6f, 0xa4, 0x1c, 0xba, 0xcb, 0xbe, 0xba, 0xdf, 0xba, 0xc2, 0x9d, 0x07, 0x11,
+    0xb2, 0xd1, 0x4b, 0x92, 0xeb, 0xd3, 0xa2, 0x2b, 0x8b, 0xe4, 0xf6, 0xae, 0x08, 0xc8, 0xc8, 0xbe,
+    0x8d, 0x81, 0x67, 0xc0, 0xb2, 0xb2, 0x58, 0x79, 0xb1, 0x0b, 0xba, 0xcf, 0x2e, 0xfa, 0x5e, 0x9f,
+    0x0f, 0x5d, 0x0a, 0x74, 0xae, 0x92, 0xee, 0xfa, 0xf3, 0x0b, 0x13, 0x6d, 0x8c, 0xd1, 0x35, 0x96,
+    0x25, 0x52, 0x4f, 0x60, 0xcb, 0xde, 0x55, 0x8f, 0x7d, 0x77, 0xd7, 0x62, 0x0e, 0x4f, 0x53, 0x48,
+    0x8a, 0x08, 0x53, 0x29, 0x52, 0x08, 0x89, 0xfe, 0xc2, 0x04, 0xdd, 0xd4, 0xcf, 0x21, 0xaf, 0x36,
+    0x42, 0x66, 0xaf, 0xee, 0x95, 0xc6, 0x21, 0xac, 0x3d, 0xe1, 0xc3, 0x98, 0x58, 0x19, 0x3f, 0x83,
+    0x86, 0x62, 0x76, 0xdf, 0xc0, 0x86, 0xb5, 0xd3, 0x4c, 0x15, 0x2b, 0x3c, 0x57, 0x73, 0x58, 0x0c,
+    0x88, 0xd1, 0x78, 0x77, 0x55, 0x8e, 0xe4, 0x28, 0x69, 0x97, 0xfd, 0x04, 0x0f, 0x52, 0xc7, 0x71,
+    0xec, 0xae, 0xce, 0x9e, 0x11, 0x4e, 0xd1, 0x0b, 0x9c, 0xaa, 0x15, 0x90, 0xb6, 0x17, 0x4b, 0xff,
+    0xfb, 0x80, 0x1a, 0xb2, 0xad, 0x14, 0xca, 0xa3, 0x1d, 0xc5, 0xdd, 0xd7, 0xb6, 0x31, 0x3e, 0x8f,
+    0x91, 0xaa, 0xa2, 0xfe, 0xe7, 0xa7, 0x8f, 0xef, 0xb5, 0x4e, 0xff, 0xc0, 0xce, 0x09, 0x59, 0x51,
+    0x6a, 0x1d, 0x71, 0x14, 0xac, 0x06, 0x4e, 0x43, 0x2d, 0xd7, 0x1b, 0x1f, 0xac, 0xe6, 0x3a, 0xd9,
+    0xc1, 0x89, 0x21, 0x59, 0xeb, 0xe8, 0x4a, 0x6e, 0xb0, 0x44, 0xc8, 0x71, 0x26, 0xc9, 0x56, 0xa8,
+    0x40, 0xd1, 0x30, 0x4c, 0xe2, 0x31, 0x68, 0xaa, 0x2f, 0x82, 0x40, 0x22, 0xe8, 0xf0, 0x09, 0xf6,
+    0x08, 0x2d, 0x35, 0x8f, 0x8f, 0xd8, 0x2f, 0x34, 0xff, 0x2c, 0x8c, 0x38, 0xc3, 0x7e, 0xe9, 0x63,
+    0xff, 0xca, 0xec, 0xd7, 0xf6, 0x3e, 0xc8, 0x73, 0xb7, 0x86, 0x4c, 0xbe, 0xd9, 0x77, 0x0a, 0x51,
+    0x6c, 0x3b, 0x64, 0xc8, 0x1f, 0xa4, 0x5d, 0xcd, 0x5a, 0xab, 0xd5, 0x0a, 0xa7, 0x2c, 0x77, 0xc8,
+    0x1f, 0x07, 0xe2, 0x4b, 0xb3, 0x9f, 0x6d, 0xb6, 0xbe, 0xdd, 0x43, 0xaa, 0x33, 0xac, 0x1a, 0xc6,
+    0xc2, 0x3c, 0x7e, 0xc9, 0xae, 0x8b, 0xb7, 0x42, 0x1c, 0x02, 0xe3, 0x18, 0x3b, 0x86, 0x27, 0xa5,
+    0xa6, 0x7c, 0xc4, 0xbe, 0x52, 0x09, 0x99, 0x3a, 0x4b, 0x01, 0x0b, 0xfa, 0x5e, 0x6c, 0x40, 0xe6,
+    0x7a, 0x74, 0xd0, 0xc4, 0xfa, 0xda, 0x8a, 0x04, 0xdf, 0xc2, 0x30, 0x70, 0x3e, 0x27, 0x59, 0x47,
+    0x01, 0x51, 0x19, 0x0d, 0xa0, 0x3f, 0x1f, 0xe3, 0x5b, 0x1d, 0x7a, 0xc2, 0x10, 0x0b, 0x06, 0x31,
+    0xb6, 0xc1, 0x1f, 0x3f, 0x6b, 0x6b, 0xc8, 0xb1, 0x39, 0xe1, 0x4b, 0xa3, 0x8d, 0xc1, 0x25, 0x57,
+    0xa3, 0x03, 0x53, 0xcc, 0x2b, 0xb8, 0xc7, 0x6a, 0x3c, 0xd4, 0x3d, 0x9f, 0xf7, 0x56, 0x8c, 0x05,
+    0x1f, 0x72, 0x64, 0xb3, 0x38, 0x20, 0x6b, 0xac, 0xfa, 0x66, 0x8a, 0xe8, 0xc5, 0xec, 0x27, 0x53,
+    0xab, 0x24, 0xfd, 0x1f, 0xb9, 0x75, 0xc0, 0x17, 0xbf, 0x83, 0xde, 0x4a, 0xf5, 0x9d, 0xd5, 0x38,
+    0xc3, 0x5e, 0xf8, 0xbf, 0x6c, 0x96, 0x78, 0xc2, 0xe0, 0x91, 0x87, 0x43, 0x25, 0xd1, 0xeb, 0x33,
+    0x2b, 0x4a, 0x86, 0x8e, 0xa0, 0xfa, 0x48, 0x6a, 0x1f, 0xff, 0x86, 0xc3, 0xbf, 0xe5, 0x8a, 0x0d,
+    0xa6, 0x34, 0x5f, 0xc3, 0x71, 0x31, 0xeb, 0x99, 0x27, 0x81, 0xba, 0x18, 0x87, 0x8f, 0x85, 0x52,
+    0xa2, 0xcf, 0xaa, 0x79, 0x4f, 0xc0, 0x18, 0xbd, 0xbf, 0xff, 0xf4, 0x91, 0x4c, 0x6f, 0xcf, 0x67,
+    0x15, 0x2e, 0x25, 0x22, 0x6d, 0x4e, 0xcd, 0xc6, 0xba, 0xa4, 0xa7, 0x8a, 0x13, 0x2d, 0x94, 0xa3,
+    0x96, 0xdd, 0x36, 0xa7, 0x7a, 0x51, 0xa8, 0xc6, 0x2e, 0x1c, 0x3b, 0x8b, 0x57, 0x04, 0x1c, 0xf5,
+    0x8b, 0x7f, 0x14, 0xfd, 0x0b, 0xce, 0xce, 0xdd, 0x89, 0x40, 0x12, 0x00, 0x00,
+};
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Compress the OTA web UI into a PROGMEM header.
+
+Reads lib/OTAWebServer/ui/index.html, gzips it and writes
+lib/OTAWebServer/OTAWebUI.h with the compressed bytes and an ETag derived
+from their SHA-256. Runs as a PlatformIO pre-build script
+(extra_scripts = pre:tools/embed_ui.py) or standalone:
+
+    python tools/embed_ui.py
+"""
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(PROJECT_DIR, "lib", "OTAWebServer", "ui", "index.html")
+OUTPUT = os.path.join(PROJECT_DIR, "lib", "OTAWebServer", "OTAWebUI.h")
+
+
+def render(html):
+    # mtime=0 keeps the output (and the ETag) stable across builds
+    data = gzip.compress(html, 9, mtime=0)
+    etag = hashlib.sha256(data).hexdigest()[:16]
+
+    lines = [
+        "#pragma once",
+        "",
+        "// Generated by tools/embed_ui.py from ui/index.html - do not edit",
+        "",
+        "#include <Arduino.h>",
+        "",
+        '#define OTA_UI_ETAG "\\"%s\\""' % etag,
+        "",
+        "static const size_t OTA_UI_HTML_GZ_LEN = %d;" % len(data),
+        "static const uint8_t OTA_UI_HTML_GZ[] PROGMEM = {",
+    ]
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n", len(html), len(data)
+
+
+def main():
+    with open(SOURCE, "rb") as f:
+        header, raw_size, gz_size = render(f.read())
+
+    try:
+        with open(OUTPUT, "r") as f:
+            if f.read() == header:
+                return
+    except IOError:
+        pass
+
+    with open(OUTPUT, "w") as f:
+        f.write(header)
+    print("OTAWebUI.h: %d -> %d bytes" % (raw_size, gz_size))
+
+
+main()
@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+"""Benchmark OTA ingestion paths against a device running the benchmark env.
+
+Flash the target with `pio run -e benchmark -t upload`, then point this
+driver at it. Every combination of path, image size, device buffer size,
+writer mode and chunk size is pushed through the device; the image is
+written and hashed, then discarded by the benchmark sketch, so the device
+never reboots. Each run is read back from GET /update/status and printed
+as one JSON object per line:
+
+    python tools/ota_bench.py 192.168.1.50 --paths raw,multipart,gzip \\
+        --sizes 256K,1M --buffers 4096,16384 --output results.jsonl
+
+Paths: multipart (POST /update), raw (PUT /update/raw), gzip (raw with
+Content-Encoding: gzip) and pull (device downloads from a server started
+by this script; needs --local-ip when it cannot be guessed).
+
+Compare against an earlier run to catch regressions; the exit status is 1
+when any matching run is slower than the baseline by more than
+--tolerance percent:
+
+    python tools/ota_bench.py 192.168.1.50 --baseline results.jsonl
+"""
+
+import argparse
+import gzip
+import http.client
+import http.server
+import itertools
+import json
+import random
+import socket
+import sys
+import threading
+import time
+
+# Must match OTACore's Metrics histogram bounds
+WRITE_LATENCY_BOUNDS_MS = [1, 2, 5, 10, 20, 50, 100]
+REJECTED = "rejected by verifier"
+PATHS = ("multipart", "raw", "gzip", "pull")
+
+
+def parse_size(text):
+    text = text.strip().upper()
+    scale = 1
+    if text.endswith("K"):
+        scale, text = 1024, text[:-1]
+    elif text.endswith("M"):
+        scale, text = 1024 * 1024, text[:-1]
+    return int(text) * scale
+
+
+def parse_list(text, convert=str):
+    return [convert(item) for item in text.split(",") if item]
+
+
+def synthetic_image(size, seed):
+    """Image with a valid magic byte and about 2:1 compressible content."""
+    rng = random.Random(seed)
+    out = bytearray(b"\xe9")
+    while len(out) < size:
+        # Alternate random runs and repeated runs, like code and padding
+        out += bytes(rng.getrandbits(8) for _ in range(64))
+        out += bytes([rng.getrandbits(8)]) * 64
+    return bytes(out[:size])
+
+
+class Device:
+    def __init__(self, host, port, path, timeout):
+        self.host = host
+        self.port = port
+        self.path = path
+        self.timeout = timeout
+
+    def request(self, method, url, body=None, headers=None):
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+        try:
+            conn.request(method, url, body=body, headers=headers or {})
+            response = conn.getresponse()
+            return response.status, response.read()
+        finally:
+            conn.close()
+
+    def get_json(self, url):
+        status, body = self.request("GET", url)
+        if status != 200:
+            raise RuntimeError("GET %s: HTTP %d" % (url, status))
+        return json.loads(body)
+
+    def configure(self, buffer_size, async_write, writers):
+        url = "/bench/config?buffer=%d&async=%d&writers=%d" % (buffer_size, async_write, writers)
+        status, body = self.request("POST", url)
+        if status != 200:
+            raise RuntimeError("configure: HTTP %d %s" % (status, body[:200]))
+        return json.loads(body)
+
+    def stream(self, method, url, chunks, length, headers):
+        """Send a body in the given chunks, like a client with that write size."""
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+        try:
+            conn.putrequest(method, url)
+            conn.putheader("Content-Length", str(length))
+            for key, value in headers.items():
+                conn.putheader(key, value)
+            conn.endheaders()
+            for chunk in chunks:
+                conn.send(chunk)
+            response = conn.getresponse()
+            return response.status, response.read()
+        finally:
+            conn.close()
+
+
+def split(data, size):
+    for pos in range(0, len(data), size):
+        yield data[pos:pos + size]
+
+
+def push_raw(device, image, chunk, encoding=None):
+    headers = {"Content-Type": "application/octet-stream"}
+    if encoding:
+        headers["Content-Encoding"] = encoding
+    return device.stream("PUT", device.path + "/raw", split(image, chunk), len(image), headers)
+
+
+def push_multipart(device, image, chunk):
+    boundary = "----otabench%08x" % random.getrandbits(32)
+    head = ("--%s\r\nContent-Disposition: form-data; name=\"firmware\"; filename=\"bench.bin\"\r\n"
+            "Content-Type: application/octet-stream\r\n\r\n" % boundary).encode()
+    tail = ("\r\n--%s--\r\n" % boundary).encode()
+    headers = {"Content-Type": "multipart/form-data; boundary=" + boundary}
+    body = itertools.chain([head], split(image, chunk), [tail])
+    return device.stream("POST", device.path, body, len(head) + len(image) + len(tail), headers)
+
+
+class ImageServer:
+    """Serves one image at a time for the pull path."""
+
+    def __init__(self, bind, port):
+        owner = self
+
+        class Handler(http.server.BaseHTTPRequestHandler):
+            protocol_version = "HTTP/1.0"
+
+            def do_GET(self):
+                data = owner.image
+                self.send_response(200)
+                self.send_header("Content-Type", "application/octet-stream")
+                self.send_header("Content-Length", str(len(data)))
+                self.end_headers()
+                for chunk in split(data, owner.chunk):
+                    self.wfile.write(chunk)
+
+            def log_message(self, *args):
+                pass
+
+        self.image = b""
+        self.chunk = 4096
+        self.httpd = http.server.ThreadingHTTPServer((bind, port), Handler)
+        self.port = self.httpd.server_address[1]
+        threading.Thread(target=self.httpd.serve_forever, daemon=True).start()
+
+
+def pull(device, server, local_ip, image, chunk, timeout):
+    server.image = image
+    server.chunk = chunk
+    url = "http://%s:%d/bench.bin" % (local_ip, server.port)
+    status, body = device.request("POST", "/bench/fetch?url=%s&chunk=%d" % (url, chunk))
+    if status != 202:
+        return status, body
+
+    deadline = time.time() + timeout
+    time.sleep(0.2)
+    while time.time() < deadline:
+        state = device.get_json("/bench/state")
+        if not state["fetching"]:
+            return 200, state["error"].encode()
+        time.sleep(0.2)
+    return 408, b"pull timed out"
+
+
+def percentile(histogram, fraction):
+    """Upper bucket bound (ms) below which `fraction` of commits finished.
+
+    None means the percentile falls in the open-ended >=100 ms bucket.
+    """
+    total = sum(histogram)
+    if total == 0:
+        return None
+    seen = 0
+    for index, count in enumerate(histogram):
+        seen += count
+        if seen >= fraction * total:
+            return WRITE_LATENCY_BOUNDS_MS[index] if index < len(WRITE_LATENCY_BOUNDS_MS) else None
+    return None
+
+
+def run_case(device, server, args, case, image):
+    path, size, buffer_size, async_write, chunk = case
+    config = device.configure(buffer_size, async_write, args.writers)
+    heap_before = config["freeHeap"]
+
+    payload = gzip.compress(image, 6) if path == "gzip" else image
+    started = time.time()
+    if path == "raw":
+        status, body = push_raw(device, payload, chunk)
+    elif path == "gzip":
+        status, body = push_raw(device, payload, chunk, "gzip")
+    elif path == "multipart":
+        status, body = push_multipart(device, payload, chunk)
+    else:
+        status, body = pull(device, server, args.local_ip, payload, chunk, args.timeout)
+    wall = time.time() - started
+
+    report = device.get_json(device.path + "/status")
+    metrics = report.get("metrics", {})
+    ok = REJECTED in report.get("error", "")
+
+    duration = metrics.get("duration", 0)
+    histogram = metrics.get("writeHistogram", [])
+    return {
+        "path": path,
+        "imageSize": size,
+        "payloadSize": len(payload),
+        "bufferSize": config["bufferSize"],
+        "asyncWrite": config["asyncWrite"],
+        "chunkSize": chunk,
+        "ok": ok,
+        "httpStatus": status,
+        "error": None if ok else (report.get("error") or body.decode(errors="replace")[:200]),
+        "wallSeconds": round(wall, 3),
+        "durationMs": duration,
+        "throughput": metrics.get("averageRate", 0),
+        "imageThroughput": int(metrics.get("bytesWritten", 0) * 1000 / duration) if duration else 0,
+        "receiveWaitMs": metrics.get("receiveWaitUs", 0) // 1000,
+        "processMs": metrics.get("processTimeUs", 0) // 1000,
+        "writeMs": metrics.get("writeTimeUs", 0) // 1000,
+        "eraseMs": metrics.get("eraseTimeUs", 0) // 1000,
+        "maxWriteMs": round(metrics.get("maxWriteUs", 0) / 1000.0, 2),
+        "writeP50Ms": percentile(histogram, 0.50),
+        "writeP90Ms": percentile(histogram, 0.90),
+        "writeP99Ms": percentile(histogram, 0.99),
+        "chunkHistogram": metrics.get("chunkHistogram", []),
+        "heapBefore": heap_before,
+        "minFreeHeap": metrics.get("minFreeHeap", 0),
+        "peakHeapUse": heap_before - metrics.get("minFreeHeap", heap_before),
+    }
+
+
+def case_key(result):
+    return (result["path"], result["imageSize"], result["bufferSize"],
+            result["asyncWrite"], result["chunkSize"])
+
+
+def load_baseline(baseline_file):
+    baseline = {}
+    with open(baseline_file) as f:
+        for line in f:
+            if line.strip():
+                entry = json.loads(line)
+                if entry.get("ok"):
+                    baseline.setdefault(case_key(entry), []).append(entry["throughput"])
+    return baseline
+
+
+def compare(results, baseline, tolerance):
+    regressions = 0
+    for result in results:
+        before = baseline.get(case_key(result))
+        if not before or not result["ok"]:
+            continue
+        reference = sum(before) / len(before)
+        change = 100.0 * (result["throughput"] - reference) / reference if reference else 0.0
+        if change < -tolerance:
+            regressions += 1
+            sys.stderr.write("REGRESSION %s: %d B/s vs %d B/s (%.1f%%)\n"
+                             % (case_key(result), result["throughput"], reference, change))
+    return regressions
+
+
+def guess_local_ip(host):
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as s:
+        s.connect((host, 80))
+        return s.getsockname()[0]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host", help="device address")
+    parser.add_argument("--port", type=int, default=3232, help="OTA server port")
+    parser.add_argument("--path", default="/update", help="OTA endpoint path")
+    parser.add_argument("--paths", default=",".join(PATHS), help="ingestion paths to run")
+    parser.add_argument("--sizes", default="256K,1M", help="image sizes")
+    parser.add_argument("--buffers", default="4096,16384", help="OTACore buffer sizes")
+    parser.add_argument("--async-write", default="0,1", help="writer task modes (0/1)")
+    parser.add_argument("--writers", type=int, default=2, help="buffers shared with the writer")
+    parser.add_argument("--chunks", default="1460,4096", help="client write / fetch chunk sizes")
+    parser.add_argument("--repeat", type=int, default=1, help="runs per combination")
+    parser.add_argument("--local-ip", help="address the device can reach this host at (pull)")
+    parser.add_argument("--serve-port", type=int, default=0, help="port for the pull server")
+    parser.add_argument("--timeout", type=float, default=120, help="per-run timeout in seconds")
+    parser.add_argument("--output", help="append JSON lines here as well as stdout")
+    parser.add_argument("--baseline", help="JSON lines from an earlier run to compare against")
+    parser.add_argument("--tolerance", type=float, default=10.0, help="allowed slowdown in percent")
+    args = parser.parse_args()
+
+    paths = parse_list(args.paths)
+    for path in paths:
+        if path not in PATHS:
+            parser.error("unknown path %r" % path)
+
+    # Read before running, --output may append to the same file
+    baseline = load_baseline(args.baseline) if args.baseline else None
+
+    device = Device(args.host, args.port, args.path, args.timeout)
+    server = None
+    if "pull" in paths:
+        args.local_ip = args.local_ip or guess_local_ip(args.host)
+        server = ImageServer("0.0.0.0", args.serve_port)
+
+    images = {}
+    cases = itertools.product(paths, parse_list(args.sizes, parse_size),
+                              parse_list(args.buffers, int), parse_list(args.async_write, int),
+                              parse_list(args.chunks, int))
+
+    output = open(args.output, "a") if args.output else None
+    results = []
+    for case in cases:
+        size = case[1]
+        if size not in images:
+            images[size] = synthetic_image(size, size)
+        for _ in range(args.repeat):
+            result = run_case(device, server, args, case, images[size])
+            results.append(result)
+            line = json.dumps(result, sort_keys=True)
+            print(line)
+            sys.stdout.flush()
+            if output:
+                output.write(line + "\n")
+                output.flush()
+            sys.stderr.write("%-9s %8d B buf %5d %-5s chunk %5d: %s %7d B/s wait %5d ms flash %5d ms\n"
+                             % (result["path"], size, result["bufferSize"],
+                                "async" if result["asyncWrite"] else "sync", result["chunkSize"],
+                                "ok  " if result["ok"] else "FAIL", result["throughput"],
+                                result["receiveWaitMs"], result["writeMs"] + result["eraseMs"]))
+    if output:
+        output.close()
+
+    failed = sum(1 for result in results if not result["ok"])
+    regressions = compare(results, baseline, args.tolerance) if baseline is not None else 0
+    if failed:
+        sys.stderr.write("%d run(s) failed\n" % failed)
+    sys.exit(1 if failed or regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Build an OTACore delta patch (ODP1) from two firmware images.
+
+The patch is computed with bsdiff (pip install bsdiff4) and rewritten into
+the streaming layout OTACore applies on the device:
+
+    header  : "ODP1", u32 source size, u32 target size,
+              sha256(source), sha256(target)
+    records : u32 diff length, u32 extra length, i32 seek,
+              diff bytes (added to the source), extra bytes (copied)
+
+All integers are little-endian. Upload the result like a normal image;
+add --gzip to compress it for devices built with enableCompression.
+
+    python tools/ota_delta.py old.bin new.bin update.odp --gzip
+"""
+
+import argparse
+import bz2
+import gzip
+import hashlib
+import struct
+import sys
+
+try:
+    import bsdiff4
+except ImportError:
+    sys.exit("bsdiff4 is required: pip install bsdiff4")
+
+
+def offtin(buf):
+    """Decode a bsdiff sign-magnitude 64-bit integer."""
+    value = struct.unpack("<Q", buf)[0]
+    if value & (1 << 63):
+        return -(value & ~(1 << 63))
+    return value
+
+
+def build_patch(source, target):
+    raw = bsdiff4.diff(source, target)
+    if raw[:8] != b"BSDIFF40":
+        raise ValueError("unexpected bsdiff output")
+
+    ctrl_len = offtin(raw[8:16])
+    diff_len = offtin(raw[16:24])
+    new_size = offtin(raw[24:32])
+    if new_size != len(target):
+        raise ValueError("bsdiff size mismatch")
+
+    pos = 32
+    ctrl = bz2.decompress(raw[pos:pos + ctrl_len])
+    pos += ctrl_len
+    diff = bz2.decompress(raw[pos:pos + diff_len])
+    pos += diff_len
+    extra = bz2.decompress(raw[pos:])
+
+    out = bytearray()
+    out += b"ODP1"
+    out += struct.pack("<II", len(source), len(target))
+    out += hashlib.sha256(source).digest()
+    out += hashlib.sha256(target).digest()
+
+    diff_pos = 0
+    extra_pos = 0
+    for i in range(0, len(ctrl), 24):
+        add = offtin(ctrl[i:i + 8])
+        copy = offtin(ctrl[i + 8:i + 16])
+        seek = offtin(ctrl[i + 16:i + 24])
+        if not -(1 << 31) <= seek < (1 << 31):
+            raise ValueError("seek out of range")
+        out += struct.pack("<IIi", add, copy, seek)
+        out += diff[diff_pos:diff_pos + add]
+        out += extra[extra_pos:extra_pos + copy]
+        diff_pos += add
+        extra_pos += copy
+
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source", help="image currently running on the device")
+    parser.add_argument("target", help="new image")
+    parser.add_argument("output", help="patch file to write")
+    parser.add_argument("--gzip", action="store_true", help="gzip the patch")
+    args = parser.parse_args()
+
+    with open(args.source, "rb") as f:
+        source = f.read()
+    with open(args.target, "rb") as f:
+        target = f.read()
+
+    patch = build_patch(source, target)
+    if args.gzip:
+        patch = gzip.compress(patch, 9)
+
+    with open(args.output, "wb") as f:
+        f.write(patch)
+
+    print("%s: %d bytes (target %d bytes, %.1f%%)"
+          % (args.output, len(patch), len(target), 100.0 * len(patch) / len(target)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Send one firmware image to a fleet over UDP multicast (OTAMulticast).
+
+The image is sent once to the group as numbered blocks, then repaired in
+rounds: the group is polled, devices answer with the ranges they are still
+missing, and only the union of those ranges is sent again. It stops when a
+poll gets no repair requests, or when every --expect device reported done.
+
+    packet  : "OMC1", u8 type, 3 reserved, u32 session id, body
+    ANNOUNCE: u32 image size, u32 block size, u32 block count, sha256(image),
+              hmac-sha256(key, header + body so far)
+    DATA    : u32 block index, block bytes
+    POLL    : u32 round
+    NACK    : u32 range count, {u32 first, u32 count} * n   (device -> here)
+    DONE    : u8 result (0 = installed), 3 reserved, u32 blocks (device -> here)
+
+All integers are little-endian. Devices answer to the address and port the
+last valid ANNOUNCE came from, so run this on the same network. The key must
+match the devices' sharedKey; it is read from OTA_MULTICAST_KEY when --key
+is not given.
+
+    python tools/ota_multicast.py firmware.bin --key "$FLEET_KEY" --expect 300 --rate 400
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import random
+import socket
+import struct
+import sys
+import time
+
+MAGIC = b"OMC1"
+ANNOUNCE, DATA, POLL, NACK, DONE = 1, 2, 3, 4, 5
+HEADER = struct.Struct("<4sB3xI")
+
+
+def packet(kind, session, body=b""):
+    return HEADER.pack(MAGIC, kind, session) + body
+
+
+class Coordinator:
+    def __init__(self, args, image):
+        self.args = args
+        self.image = image
+        self.session = args.session if args.session is not None else random.getrandbits(32)
+        self.count = (len(image) + args.block_size - 1) // args.block_size
+        self.group = (args.group, args.port)
+        self.done = {}
+
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+        self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, args.ttl)
+        if args.interface:
+            self.sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF,
+                                 socket.inet_aton(args.interface))
+        self.sock.bind(("", 0))
+
+        digest = hashlib.sha256(image).digest()
+        announce = packet(ANNOUNCE, self.session,
+                          struct.pack("<III", len(image), args.block_size, self.count) + digest)
+        self.announce = announce + hmac.new(args.key.encode(), announce, hashlib.sha256).digest()
+        self.sent = 0
+
+    def send(self, data):
+        self.sock.sendto(data, self.group)
+        self.sent += len(data)
+
+    def send_blocks(self, blocks):
+        """Send blocks at --rate packets/s, re-announcing for late joiners."""
+        interval = 1.0 / self.args.rate if self.args.rate > 0 else 0
+        next_at = time.monotonic()
+        for n, index in enumerate(blocks):
+            if n % self.args.announce_every == 0:
+                self.send(self.announce)
+            start = index * self.args.block_size
+            self.send(packet(DATA, self.session, struct.pack("<I", index) +
+                             self.image[start:start + self.args.block_size]))
+            next_at += interval
+            delay = next_at - time.monotonic()
+            if delay > 0:
+                time.sleep(delay)
+
+    def poll(self, round_no):
+        """Poll the group and collect replies for the backoff window."""
+        self.send(self.announce)
+        self.send(packet(POLL, self.session, struct.pack("<I", round_no)))
+
+        missing = set()
+        nacks = 0
+        deadline = time.monotonic() + self.args.window
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                break
+            self.sock.settimeout(remaining)
+            try:
+                data, addr = self.sock.recvfrom(2048)
+            except socket.timeout:
+                break
+            if len(data) < HEADER.size:
+                continue
+            magic, kind, session = HEADER.unpack_from(data)
+            if magic != MAGIC or session != self.session:
+                continue
+
+            body = data[HEADER.size:]
+            if kind == NACK and len(body) >= 4:
+                nacks += 1
+                self.done.pop(addr[0], None)
+                ranges = struct.unpack_from("<I", body)[0]
+                for i in range(min(ranges, (len(body) - 4) // 8)):
+                    first, count = struct.unpack_from("<II", body, 4 + 8 * i)
+                    missing.update(range(first, min(first + count, self.count)))
+            elif kind == DONE and len(body) >= 8:
+                self.done[addr[0]] = body[0]
+        return missing, nacks
+
+    def run(self):
+        print("session %08x: %d bytes, %d blocks of %d to %s:%d" %
+              (self.session, len(self.image), self.count, self.args.block_size,
+               self.args.group, self.args.port))
+        started = time.monotonic()
+        self.send_blocks(range(self.count))
+
+        for round_no in range(1, self.args.rounds + 1):
+            missing, nacks = self.poll(round_no)
+            installed = sum(1 for result in self.done.values() if result == 0)
+            print("round %d: %d repair requests, %d blocks missing, %d done (%d installed)" %
+                  (round_no, nacks, len(missing), len(self.done), installed))
+
+            if self.args.expect and len(self.done) >= self.args.expect:
+                break
+            if not missing:
+                if nacks == 0 and not self.args.expect:
+                    break
+                continue
+            self.send_blocks(sorted(missing))
+
+        elapsed = time.monotonic() - started
+        failed = sorted(addr for addr, result in self.done.items() if result != 0)
+        print("sent %d bytes (%.2fx the image) in %.1fs" %
+              (self.sent, self.sent / len(self.image), elapsed))
+        for addr in failed:
+            print("failed: %s" % addr)
+
+        if failed or (self.args.expect and len(self.done) < self.args.expect):
+            return 1
+        return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="firmware .bin to send")
+    parser.add_argument("--group", default="239.255.42.99", help="multicast group")
+    parser.add_argument("--port", type=int, default=45454, help="group UDP port")
+    parser.add_argument("--interface", help="local address of the interface to send on")
+    parser.add_argument("--ttl", type=int, default=1, help="multicast TTL")
+    parser.add_argument("--block-size", type=int, default=1024,
+                        help="block size, a power of two from 256 to 1024")
+    parser.add_argument("--rate", type=float, default=300, help="DATA packets per second (0 = unpaced)")
+    parser.add_argument("--announce-every", type=int, default=256,
+                        help="repeat the announce every N data packets")
+    parser.add_argument("--rounds", type=int, default=20, help="maximum repair rounds")
+    parser.add_argument("--window", type=float, default=1.0,
+                        help="seconds to collect replies after a poll (above the device maxBackoff)")
+    parser.add_argument("--expect", type=int, default=0, help="stop once this many devices report done")
+    parser.add_argument("--session", type=lambda v: int(v, 0), help="session id (default random)")
+    parser.add_argument("--key", default=os.environ.get("OTA_MULTICAST_KEY"),
+                        help="pre-shared key signing the announce (default $OTA_MULTICAST_KEY)")
+    args = parser.parse_args()
+
+    if not args.key:
+        parser.error("--key (or OTA_MULTICAST_KEY) is required")
+
+    if args.block_size < 256 or args.block_size > 1024 or args.block_size & (args.block_size - 1):
+        parser.error("--block-size must be a power of two from 256 to 1024")
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if not image or image[0] != 0xE9:
+        sys.exit("%s is not an ESP32 application image" % args.image)
+
+    sys.exit(Coordinator(args, image).run())
+
+
+if __name__ == "__main__":
+    main()